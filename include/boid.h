@@ -1,18 +1,53 @@
 #ifndef BOID_H
 #define BOID_H
 
+#include <math.h>
 #include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
 
 typedef struct {
     Vector2 position;
     Vector2 velocity;
 } Boid;
 
+// Structure-of-arrays storage for a set of boids. Each array starts on a cache line so that loops that only need some
+// of the components (e.g. distance checks only need positions) don't pull the rest through the cache.
+struct BoidArrays {
+    float *positionsX;
+    float *positionsY;
+    float *velocitiesX;
+    float *velocitiesY;
+};
+
+#define BOID_ARRAYS_ALIGNMENT 64
+
+// Compact structure-of-arrays storage for a set of boids, 8 bytes per boid instead of 16. Positions are 16-bit fixed
+// point steps of positionScale from positionOrigin, and velocities are half-precision floats. See PackBoidPosition and
+// PackBoidVelocity.
+struct CompactBoidArrays {
+    uint16_t *positionsX;
+    uint16_t *positionsY;
+    uint16_t *velocitiesX;
+    uint16_t *velocitiesY;
+
+    Vector2 positionOrigin;
+    Vector2 positionScale;
+};
+
+// Largest fixed point step of a compact position
+#define COMPACT_BOID_POSITION_MAX 65535
+
 #ifdef DEBUG
 struct Debug_BoidData {
     Vector2 separationVector;
     Vector2 alignmentVector;
     Vector2 cohesionVector;
+    Vector2 obstacleVector;
 
     float collisionTime;
 };
@@ -21,6 +56,93 @@ struct Debug_BoidData {
 #define BOID_LENGTH 10.f
 #define BOID_WIDTH 7.5f
 
-void DrawBoid(const Boid *boid);
+// Allocates all the arrays in a single aligned block, must be freed with FreeBoidArrays
+bool AllocateBoidArrays(struct BoidArrays *arrays, int capacity);
+
+// Moves the arrays to a new block with room for newCapacity boids, keeping the first boidsCount boids. On failure the
+// arrays are left unchanged.
+bool ResizeBoidArrays(struct BoidArrays *arrays, int boidsCount, int newCapacity);
+
+void FreeBoidArrays(struct BoidArrays *arrays);
+
+// Gets the space arrays for the given number of boids take up in an arena
+size_t GetBoidArraysArenaSize(int capacity);
+
+// Carves the arrays out of the arena instead, they are freed along with the arena and not by FreeBoidArrays
+bool AllocateBoidArraysFromArena(struct BoidArrays *arrays, struct Arena *arena, int capacity);
+
+// Points the compact arrays into the memory of the position arrays, which have room for all four compact arrays at the
+// same capacity. The arrays can then only hold one kind of copy at a time, but compact copies leave the velocity
+// arrays untouched.
+void OverlayCompactBoidArrays(struct CompactBoidArrays *compactArrays, const struct BoidArrays *arrays, int capacity);
+
+// Gets the smallest rectangle containing the positions of the first boidsCount boids, empty if there are none
+Rectangle GetBoidArraysExtent(const struct BoidArrays *arrays, int boidsCount);
+
+static inline Boid GetBoidFromArrays(const struct BoidArrays *arrays, const int index) {
+    return (Boid){
+        .position = {.x = arrays->positionsX[index], .y = arrays->positionsY[index]},
+        .velocity = {.x = arrays->velocitiesX[index], .y = arrays->velocitiesY[index]},
+    };
+}
+
+static inline void SetBoidInArrays(struct BoidArrays *arrays, const int index, const Boid boid) {
+    arrays->positionsX[index] = boid.position.x;
+    arrays->positionsY[index] = boid.position.y;
+    arrays->velocitiesX[index] = boid.velocity.x;
+    arrays->velocitiesY[index] = boid.velocity.y;
+}
+
+// Rounds the coordinate to the nearest fixed point step of scale from origin (inverseScale is 1 / scale), clamping it
+// to the steps a compact position can hold
+static inline uint16_t PackBoidPosition(const float value, const float origin, const float inverseScale) {
+    const float steps = ((value - origin) * inverseScale) + 0.5F;
+    // Also catches NaN
+    if (!(steps > 0.F)) {
+        return 0;
+    }
+    if (steps >= (float)COMPACT_BOID_POSITION_MAX) {
+        return COMPACT_BOID_POSITION_MAX;
+    }
+    return (uint16_t)steps;
+}
+
+static inline float UnpackBoidPosition(const uint16_t steps, const float origin, const float scale) {
+    return origin + ((float)steps * scale);
+}
+
+// Rounds the velocity component to the nearest half-precision float, values beyond the largest half (65504) are clamped
+// to it
+static inline uint16_t PackBoidVelocity(const float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000U;
+
+    // Scaling by 2^-112 moves the exponent bias from 127 to 15, values too small for a normal half become float
+    // denormals, which then line up with the half denormals
+    const float magnitude = fabsf(value) * 0x1p-112F;
+    memcpy(&bits, &magnitude, sizeof(bits));
+    // Round to nearest on the 13 mantissa bits that are dropped, a carry into the exponent is still the right value
+    bits = (bits + 0x1000U) >> 13;
+    // Also catches NaN
+    if (!(bits <= 0x7BFFU)) {
+        bits = 0x7BFFU;
+    }
+    return (uint16_t)(sign | bits);
+}
+
+static inline float UnpackBoidVelocity(const uint16_t half) {
+    const uint32_t bits = (uint32_t)(half & 0x7FFFU) << 13;
+    float magnitude;
+    memcpy(&magnitude, &bits, sizeof(magnitude));
+    magnitude *= 0x1p112F;
+    return (half & 0x8000U) != 0 ? -magnitude : magnitude;
+}
+
+// Gets the colour boids of the given species are drawn in, species past the end of the palette reuse its colours
+Color GetBoidSpeciesColor(int species);
+
+// Draws the boid pointing along its velocity, in the colour of its species
+void DrawBoid(Vector2 position, Vector2 velocity, int species);
 
 #endif /* ifdef BOID_H */
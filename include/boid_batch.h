@@ -0,0 +1,34 @@
+#ifndef BOID_BATCH_H
+#define BOID_BATCH_H
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "boid.h"
+
+// Draws a whole flock with one draw call. The triangles of every boid are written into a single dynamic mesh which is
+// uploaded and drawn once per frame, instead of submitting one DrawTriangle per boid.
+struct BoidBatch {
+    Mesh mesh;
+    Material material;
+    // Number of boids the mesh buffers can hold, grown by doubling when a larger flock is drawn
+    int capacity;
+    // Set when the colours were last written per species, rather than all in the first species' colour
+    bool hasSpeciesColors;
+};
+
+// Must be called after the window is created since it uploads the mesh
+bool InitializeBoidBatch(struct BoidBatch *batch, int capacity);
+
+// Draws the boids, each moved along its velocity by timeOffset seconds (see GetFlockTimeSinceStep). Only boids inside
+// view (the part of the world on screen) are drawn. zoom is the number of pixels per world unit, when a boid would be
+// only a few pixels long it is drawn as a single pixel instead. Boids are coloured by their species (see
+// GetBoidSpeciesColor), boidSpecies may be NULL when every boid is of the first species, which saves uploading the
+// colours each frame.
+void DrawBoidBatch(struct BoidBatch *batch, const struct BoidArrays *boids, const uint8_t *boidSpecies, int boidsCount,
+                   float timeOffset, Rectangle view, float zoom);
+
+void DestroyBoidBatch(struct BoidBatch *batch);
+
+#endif /* ifdef BOID_BATCH_H */
@@ -0,0 +1,119 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+
+#include "flock.h"
+
+// Flock checkpoint files (see SaveFlockCheckpoint and InitializeFlockFromCheckpoint in flock.h). A checkpoint is a
+// FlockCheckpointHeader followed by the four boid arrays and the boids' IDs (int32_t), each starting on a
+// FLOCK_CHECKPOINT_ALIGNMENT boundary, in the order positionsX, positionsY, velocitiesX, velocitiesY, boidIds, then
+// the obstacles as FlockCheckpointObstacles on the next boundary. The boids are stored in the flock's memory order,
+// which the grid's cell order (and so the order forces are summed in) depends on. Everything is stored in the byte
+// order of the machine that wrote it, files from a machine with a different byte order are rejected.
+
+#define FLOCK_CHECKPOINT_MAGIC "BOIDCKPT"
+// Increased whenever the layout of the header or the config changes, older checkpoints are rejected. Trajectory files
+// store the config too, so TRAJECTORY_VERSION has to be increased along with it.
+#define FLOCK_CHECKPOINT_VERSION 10
+#define FLOCK_CHECKPOINT_BYTE_ORDER_MARK 0x01020304U
+// The arrays are aligned to the boid arrays' alignment so they can be used straight from the mapping
+#define FLOCK_CHECKPOINT_ALIGNMENT 64
+// Number of per boid arrays, all the same size
+#define FLOCK_CHECKPOINT_ARRAYS_COUNT 5
+
+// FlockConfig with fixed size fields, so the file doesn't depend on the compiler's struct layout
+struct FlockCheckpointConfig {
+    float boundsX;
+    float boundsY;
+    float boundsWidth;
+    float boundsHeight;
+    uint8_t useOpenWorld;
+
+    int32_t numberOfBoids;
+
+    float separationFactor;
+    float alignmentFactor;
+    float cohesionFactor;
+
+    float separationRange;
+    float cohesionRange;
+    float alignmentRange;
+
+    float obstacleAvoidanceFactor;
+    float obstacleAvoidanceRange;
+
+    uint8_t normalizeForces;
+    uint8_t clampSpeed;
+    uint8_t useQuadtree;
+    uint8_t useNeighbourLists;
+    float minimumSpeed;
+    float maximumSpeed;
+
+    int32_t threadCount;
+    uint32_t seed;
+
+    float timeStep;
+    int32_t maxStepsPerFrame;
+
+    float quadtreeOpeningAngle;
+    float neighbourListSkin;
+    int32_t steeringInterval;
+    int32_t sortInterval;
+    uint8_t useCompactStorage;
+
+    // Changing FLOCK_MAX_SPECIES changes the layout too
+    int32_t speciesCount;
+    float speciesSpeedFactors[FLOCK_MAX_SPECIES];
+    // Row s holds the weights of species s
+    float speciesSeparationWeights[FLOCK_MAX_SPECIES][FLOCK_MAX_SPECIES];
+    float speciesAlignmentWeights[FLOCK_MAX_SPECIES][FLOCK_MAX_SPECIES];
+    float speciesCohesionWeights[FLOCK_MAX_SPECIES][FLOCK_MAX_SPECIES];
+};
+
+struct FlockCheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    // Size of this header, the arrays start after it
+    uint64_t headerSize;
+    uint64_t fileSize;
+
+    struct FlockCheckpointConfig config;
+
+    // Clock
+    uint64_t stepsCount;
+    double time;
+    double droppedTime;
+    float accumulator;
+
+    uint32_t boidsCount;
+    uint64_t randomState;
+
+    // Offset of positionsX from the start of the file and the distance between the starts of consecutive arrays
+    uint64_t arraysOffset;
+    uint64_t arrayStride;
+
+    uint32_t obstaclesCount;
+    // Offset of the first obstacle from the start of the file
+    uint64_t obstaclesOffset;
+};
+
+// FlockObstacle with fixed size fields, only the fields of the obstacle's shape are used
+struct FlockCheckpointObstacle {
+    uint32_t shape;
+    float centerX;
+    float centerY;
+    float radius;
+    float rectangleX;
+    float rectangleY;
+    float rectangleWidth;
+    float rectangleHeight;
+};
+
+// Converts a flock config to and from its checkpoint form. Fields the checkpoint doesn't store are left at their
+// defaults.
+struct FlockCheckpointConfig CreateFlockCheckpointConfig(const struct FlockConfig *config);
+struct FlockConfig ReadFlockCheckpointConfig(const struct FlockCheckpointConfig *checkpointConfig);
+
+#endif /* ifdef CHECKPOINT_H */
@@ -3,13 +3,45 @@
 
 #include <raylib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
+#include "arena.h"
 #include "boid.h"
+#include "grid.h"
+#include "morton_sort.h"
+#include "neighbour_list.h"
+#include "obstacle_field.h"
+#include "profiler.h"
+#include "quadtree.h"
+#include "steering.h"
+#include "worker_pool.h"
+
+struct TrajectoryRecorder;
+
+// Most species a flock can have, each species is a layer of the flock's grid
+#define FLOCK_MAX_SPECIES SPATIAL_GRID_MAX_LAYERS
+
+// Parameters of one species of boid
+struct FlockSpeciesConfig {
+    // Multiplies the minimum and maximum speed of boids of this species
+    float speedFactor;
+    // How strongly boids of this species steer away from, align with and move towards boids of each species, on top of
+    // the force factors. The forces from each species are found separately, then added up with these weights, so a
+    // weight of 0 ignores a species and negative weights steer the other way (e.g. a negative cohesion weight flees).
+    float separationWeights[FLOCK_MAX_SPECIES];
+    float alignmentWeights[FLOCK_MAX_SPECIES];
+    float cohesionWeights[FLOCK_MAX_SPECIES];
+};
 
 // Configuration for boid flock
 struct FlockConfig {
     // Bounds
     Rectangle flockBounds;
+    // Lets boids fly on past the bounds instead of wrapping around to the other side, the bounds are then only where
+    // boids spawn. The grid only makes cells where there are boids (see BuildSparseSpatialGrid), so the memory and time
+    // taken by each update don't grow as the flock spreads out. Compact storage isn't used in an open world, as it
+    // packs positions across the bounds.
+    bool useOpenWorld;
 
     // Boids
     int numberOfBoids;
@@ -18,11 +50,16 @@ struct FlockConfig {
     float separationFactor;
     float alignmentFactor;
     float cohesionFactor;
+    // Steering away from obstacles (see SetFlockObstacles)
+    float obstacleAvoidanceFactor;
 
     // Force ranges
     float separationRange;
     float cohesionRange;
     float alignmentRange;
+    // Distance from an obstacle's edge at which boids start steering away from it, the closer they get the harder
+    // they steer
+    float obstacleAvoidanceRange;
 
     bool normalizeForces;
 
@@ -30,35 +67,246 @@ struct FlockConfig {
     bool clampSpeed;
     float minimumSpeed;
     float maximumSpeed;
+
+    // Species
+    // Number of species the boids are split between, boids take turns by ID so each species gets an even share. All
+    // the species share the flock's grid, so the neighbours of every species are found in a single search. The
+    // quadtree and the neighbour lists aren't used with more than one species.
+    int speciesCount;
+    // The first speciesCount are used
+    struct FlockSpeciesConfig species[FLOCK_MAX_SPECIES];
+
+    // Performance
+    // Number of threads that update the flock, including the thread calling UpdateFlock
+    int threadCount;
+    // Finds alignment and cohesion with a Barnes-Hut quadtree instead of the grid, which is much faster when their
+    // ranges cover many boids. Separation is always exact.
+    bool useQuadtree;
+    // Largest size of a quadtree node over its distance for it to be counted as a whole when it is only partly in
+    // range, 0 is exact and larger angles are faster but less accurate (see AccumulateQuadtreeSteering)
+    float quadtreeOpeningAngle;
+    // Keeps a list of the nearby boids of each boid (see NeighbourLists) and only searches the grid again once the
+    // boids have moved more than half the skin, instead of searching it every update
+    bool useNeighbourLists;
+    // Distance beyond the interaction range that the neighbour lists cover, larger skins are rebuilt less often but
+    // the lists are longer
+    float neighbourListSkin;
+    // Each update only recomputes the steering forces of 1 in this many boids, taking turns in a fixed order, and the
+    // rest keep their last force. 1 recomputes every boid every update.
+    int steeringInterval;
+    // Re-sorts the boids in memory by the Morton (Z-order) key of their position every this many steps, so boids that
+    // are close in the flock stay close in memory as they move around. 0 never re-sorts.
+    int sortInterval;
+    // Packs the grid's cell order copy of the boids, which the steering kernels read for every neighbour, into 16-bit
+    // fixed point positions across the bounds and half-precision velocities. This halves the memory read per neighbour,
+    // at the cost of rounding neighbour positions to 1/65535 of the bounds and velocities to 11 significant bits.
+    // With a steering interval of 1 each boid is also moved as soon as its force is found, so forces are never stored.
+    // Neighbour lists aren't used with compact storage.
+    bool useCompactStorage;
+
+    // Seed for the random spawn positions and directions, the same config and seed always give the same flock
+    unsigned int seed;
+
+    // Simulation clock
+    // Seconds simulated by each step of AdvanceFlock, independent of the frame rate
+    float timeStep;
+    // Most steps AdvanceFlock takes in one call, frame time beyond this is dropped so a slow frame can't make the next
+    // frames slower
+    int maxStepsPerFrame;
+};
+
+// Fixed timestep clock of a flock
+struct FlockClock {
+    // Frame time that hasn't been simulated yet, always less than one time step after AdvanceFlock
+    float accumulator;
+    // Frame time dropped because AdvanceFlock hit the steps per frame limit
+    double droppedTime;
+
+    // Steps and simulated time since the flock was initialised (including steps from UpdateFlock)
+    uint64_t stepsCount;
+    double time;
 };
 
 // State of boids flock
 struct FlockState {
-    Boid *boids;
+    // Holds the per boid buffers (boids, steeringForces, debug_boidData, the IDs and species, the grid and the sort
+    // buffers), so they are allocated and freed together
+    struct Arena arena;
+
+    // Boid positions and velocities, stored as separate arrays
+    struct BoidArrays boids;
     int boidsCount;
+    // Number of boids the per boid buffers have room for, only grows until the flock is destroyed
+    int boidsCapacity;
 
     Vector2 *steeringForces;
+    // Number of boids, from the first, that have a steering force from an earlier update. The rest are always
+    // recomputed, whatever the steering interval.
+    int steeringForcesCount;
+
+    // Boids are moved to other indices when they are re-sorted, so each boid also has an ID that it keeps. The IDs are
+    // always [0, boidsCount), the boids removed by shrinking the flock are the ones with the highest IDs.
+    // ID of the boid at each index
+    int *boidIds;
+    // Index of the boid with each ID
+    int *boidIndices;
+    // Species of the boid at each index, set from its ID
+    uint8_t *boidSpecies;
+    // Key and order buffers for re-sorting the boids
+    struct MortonSortBuffers sortBuffers;
+    // Room for one per boid buffer while it is moved into the new order
+    void *sortScratch;
+
+    // Spatial index for neighbour queries, rebuilt every update
+    struct SpatialGrid grid;
+    // Only built when the config uses it
+    struct FlockQuadtree quadtree;
+    // Only built when the config uses them, the grid is then only rebuilt along with the lists
+    struct NeighbourLists neighbourLists;
+
+    // Obstacles the boids steer around, owned by the flock
+    struct FlockObstacle *obstacles;
+    int obstaclesCount;
+    int obstaclesCapacity;
+    // The obstacles baked over the flock's bounds, only baked again when the obstacles or the bounds change
+    struct ObstacleField obstacleField;
+    // Neighbour accumulation kernel picked for the CPU when the flock was initialised
+    SteeringKernel steeringKernel;
+    // Matching kernel for neighbours that aren't contiguous
+    SteeringIndexedKernel steeringIndexedKernel;
+    // Matching kernel for the grid when it is built compact
+    CompactSteeringKernel compactSteeringKernel;
+    // Threads that the steering and integration loops are split across
+    struct WorkerPool workerPool;
+
+    uint64_t randomState;
+
+    struct FlockClock clock;
 
     struct FlockConfig config;
 
+    // When set, every step is recorded after it is taken. Not owned by the flock, it must be stopped by whoever
+    // started it.
+    struct TrajectoryRecorder *recorder;
+
+#ifdef PROFILER
+    struct Profiler profiler;
+#endif /* ifdef PROFILER */
+
 #ifdef DEBUG
     struct Debug_BoidData *debug_boidData;
     bool isPaused;
     bool doStep;
 
     float collisionTime;
-    float collisionTimeStart;
+    // Simulated time that collisionTime was measured over
+    float collisionSampleTime;
+#endif /* ifdef DEBUG */
+};
+
+// Read-only copy of the parts of a flock needed to draw it and show it in the GUI, taken between updates so it can be
+// drawn while the flock is updated on another thread
+struct FlockSnapshot {
+    struct BoidArrays boids;
+    // Species of each boid
+    uint8_t *boidSpecies;
+    int boidsCount;
+    // Number of boids the buffers have room for, only grows until the snapshot is destroyed
+    int boidsCapacity;
+
+    struct FlockObstacle *obstacles;
+    int obstaclesCount;
+    int obstaclesCapacity;
+
+    struct FlockClock clock;
+    struct FlockConfig config;
+
+#ifdef PROFILER
+    // Copy of the flock's profiler, without its CSV file
+    struct Profiler profiler;
+#endif /* ifdef PROFILER */
+
+#ifdef DEBUG
+    struct Debug_BoidData *debug_boidData;
+    // Index of the boid with each ID (see FlockState), so the GUI can keep following one boid
+    int *debug_boidIndices;
+    bool isPaused;
+
+    float collisionTime;
+    float collisionSampleTime;
 #endif /* ifdef DEBUG */
 };
 
 struct FlockConfig CreateDefaultFlockConfig(Rectangle flockBounds);
 
+// NOTE: The flock's worker threads point into the state, so it must not be moved or copied once initialised.
 bool InitializeFlock(struct FlockState *flockState, struct FlockConfig config);
 
+// Destroys the flock and initialises it again with the config, reusing its memory when the new flock fits. The
+// obstacles are kept. On failure the flock is left destroyed.
+bool ResetFlock(struct FlockState *flockState, struct FlockConfig config);
+
+// Same as InitializeFlock but starts with copies of the first config.numberOfBoids boids of the arrays instead of
+// spawning them
+bool InitializeFlockFromBoids(struct FlockState *flockState, struct FlockConfig config, const struct BoidArrays *boids);
+
+// Gives the boid at each index the ID in boidIds and sets its species to match, for restoring a flock in the memory
+// order it was saved in. boidIds must hold each of [0, boidsCount) once, otherwise false is returned and the IDs are
+// left unchanged.
+bool SetFlockBoidIds(struct FlockState *flockState, const int *boidIds);
+
+// Initialises the flock from a checkpoint written by SaveFlockCheckpoint, restoring its config, boids, obstacles and
+// clock. The boid arrays are copied straight out of the memory-mapped file. Steering forces aren't stored, so with a
+// steering interval above 1 the first update recomputes every boid's force.
+bool InitializeFlockFromCheckpoint(struct FlockState *flockState, const char *path);
+
+// Writes the flock's config, boids, obstacles, clock and random state to a checkpoint file (see checkpoint.h for the
+// format). The boids are written in their current memory order along with their IDs, so a loaded flock carries on
+// exactly as the saved flock would have.
+bool SaveFlockCheckpoint(const struct FlockState *flockState, const char *path);
+
+// Applies a new config without respawning the flock, a different number of boids resizes the flock (see ResizeFlock)
 void ModifyFlockConfig(struct FlockState *flockState, struct FlockConfig newConfig);
 
-void UpdateFlock(struct FlockState *flockState);
+// Changes the number of boids in place, new boids are spawned at random positions and the boids with the highest IDs
+// are removed. All the other boids keep their state and IDs. The buffers only grow (at least doubling each time) so
+// shrinking or growing within the capacity doesn't allocate.
+bool ResizeFlock(struct FlockState *flockState, int numberOfBoids);
+
+// Replaces the flock's obstacles with copies of the given ones and bakes them into its obstacle field, no obstacles
+// clears them. On failure the flock is left without obstacles.
+bool SetFlockObstacles(struct FlockState *flockState, const struct FlockObstacle *obstacles, int obstaclesCount);
+
+// Adds a copy of the obstacle to the flock's obstacles, baking them all again
+bool AddFlockObstacle(struct FlockState *flockState, struct FlockObstacle obstacle);
+
+// Advances the flock by one step of deltaTime seconds
+void UpdateFlock(struct FlockState *flockState, float deltaTime);
+
+// Adds the frame time to the flock's clock and takes as many steps of config.timeStep as it covers (at most
+// config.maxStepsPerFrame). Returns the number of steps taken.
+int AdvanceFlock(struct FlockState *flockState, float frameTime);
+
+// Gets the time since the last step that hasn't been simulated yet, boids can be drawn this far along their velocity so
+// that movement looks smooth when rendering faster than the simulation runs
+float GetFlockTimeSinceStep(const struct FlockState *flockState);
+
+// Gets a copy of the position and velocity of the boid at the given index. Indices change when the boids are re-sorted,
+// boidIndices gives the index of a boid by its ID.
+Boid GetFlockBoid(const struct FlockState *flockState, int boidIndex);
 
 void DestroyFlock(struct FlockState *flockState);
 
+// Makes room for at least boidsCapacity boids. The snapshot is emptied when it has to grow, since its buffers are
+// replaced without keeping their contents.
+bool ReserveFlockSnapshotCapacity(struct FlockSnapshot *snapshot, int boidsCapacity);
+
+// Copies the flock into the snapshot, growing the snapshot's buffers if needed. A zeroed snapshot can be copied into.
+bool CopyFlockSnapshot(struct FlockSnapshot *snapshot, const struct FlockState *flockState);
+
+// Gets a copy of the position and velocity of the boid at the given index of the snapshot
+Boid GetFlockSnapshotBoid(const struct FlockSnapshot *snapshot, int boidIndex);
+
+void DestroyFlockSnapshot(struct FlockSnapshot *snapshot);
+
 #endif // !BOID_FLOCK_H
@@ -0,0 +1,17 @@
+#ifndef FLOCK_LOG_H
+#define FLOCK_LOG_H
+
+#include <stdarg.h>
+
+// Logging for the flock library, which is built without linking raylib. Messages use raylib's log levels
+// (TraceLogLevel) so the game can forward them to TraceLog, by default they are printed to stderr.
+typedef void (*FlockLogCallback)(int logLevel, const char *text, va_list args);
+
+void SetFlockLogCallback(FlockLogCallback callback);
+
+// Messages below this level are dropped (LOG_INFO by default)
+void SetFlockLogLevel(int logLevel);
+
+void FlockLog(int logLevel, const char *text, ...);
+
+#endif /* ifdef FLOCK_LOG_H */
@@ -0,0 +1,80 @@
+#ifndef FLOCK_THREAD_H
+#define FLOCK_THREAD_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "flock.h"
+
+// Most commands that can wait for the simulation thread at once, repeated config changes are merged into one command
+#define FLOCK_COMMAND_QUEUE_SIZE 16
+
+enum FlockCommandType {
+    // Applies the config with ModifyFlockConfig
+    FLOCK_COMMAND_MODIFY_CONFIG,
+    // Destroys the flock and initialises it again with the config
+    FLOCK_COMMAND_RESET,
+    // Adds the obstacle with AddFlockObstacle
+    FLOCK_COMMAND_ADD_OBSTACLE,
+    // Removes all the obstacles
+    FLOCK_COMMAND_CLEAR_OBSTACLES,
+#ifdef DEBUG
+    FLOCK_COMMAND_DEBUG_SET_PAUSED,
+#endif /* ifdef DEBUG */
+};
+
+// A change to the flock made by the render thread, the simulation thread applies it before its next update
+struct FlockCommand {
+    enum FlockCommandType type;
+    struct FlockConfig config;
+    struct FlockObstacle obstacle;
+#ifdef DEBUG
+    bool isPaused;
+    bool doStep;
+#endif /* ifdef DEBUG */
+};
+
+// Runs a flock's updates on a background thread, pipelined with rendering. While the render thread draws the snapshot
+// of frame N the simulation thread advances the flock and copies it into the other snapshot for frame N + 1, so a frame
+// takes as long as the slower of the two instead of both added together.
+struct FlockThread {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t frameStarted;
+    pthread_cond_t frameFinished;
+
+    // Only used by the simulation thread while it is running
+    struct FlockState *flockState;
+    bool isFlockValid;
+
+    // The render thread reads snapshots[frontSnapshot], the simulation thread writes the other one
+    struct FlockSnapshot snapshots[2];
+    int frontSnapshot;
+
+    // Guarded by the mutex
+    struct FlockCommand commands[FLOCK_COMMAND_QUEUE_SIZE];
+    int commandsCount;
+    float frameTime;
+    bool isFrameStarted;
+    bool isFrameFinished;
+    bool isShuttingDown;
+
+    bool isRunning;
+};
+
+// Starts updating the flock on a new thread. The flock must be initialised and must only be used through the thread
+// until StopFlockThread returns.
+bool StartFlockThread(struct FlockThread *flockThread, struct FlockState *flockState);
+
+// Waits for the previous frame's update, then starts advancing the flock by frameTime (see AdvanceFlock) and returns
+// the snapshot taken after the previous update. The snapshot can be read until the next call. Commands that haven't
+// been applied yet are already reflected in the snapshot's config, so the GUI shows the values it last sent.
+const struct FlockSnapshot *SwapFlockThread(struct FlockThread *flockThread, float frameTime);
+
+// Queues a change to be applied before the next update
+void PushFlockCommand(struct FlockThread *flockThread, struct FlockCommand command);
+
+// Waits for the current update to finish and stops the thread, the flock can then be used directly again
+void StopFlockThread(struct FlockThread *flockThread);
+
+#endif /* ifdef FLOCK_THREAD_H */
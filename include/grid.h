@@ -0,0 +1,122 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "boid.h"
+
+// Upper bound on the number of grid cells per boid, the cell size is increased past the requested size when the bounds
+// would need more cells than this (keeps the memory and the per-build cost of clearing the cells proportional to the
+// number of boids).
+#define SPATIAL_GRID_MAX_CELLS_PER_BOID 4
+#define SPATIAL_GRID_MIN_CELLS 64
+// Most layers a grid can be built with, and the most spans GetSpatialGridNeighbourSpans can return (3 per layer, or 9
+// for a sparse grid)
+#define SPATIAL_GRID_MAX_LAYERS 4
+#define SPATIAL_GRID_MAX_SPANS (9 * SPATIAL_GRID_MAX_LAYERS)
+// Smallest cell size of a sparse grid, which has no bounds to size its cells from when asked for any size
+#define SPATIAL_GRID_MIN_SPARSE_CELL_SIZE 1.F
+// Number of hash map slots per boid of a sparse grid, rounded up to a power of two (at most half the slots are used)
+#define SPATIAL_GRID_CELL_SLOTS_PER_BOID 2
+
+// Uniform grid over the flock bounds used to find nearby boids without testing every pair of boids. On each build the
+// boids are copied into cell order (row-major), so the boids in a row of adjacent cells are contiguous in memory.
+//
+// Boids can also be split into layers (e.g. by species), each layer then has its own set of cells over the same bounds
+// and comes after the one before in cell order. The boids of one layer near a position are then contiguous too, so
+// they can be told apart without checking each boid.
+//
+// A sparse grid has no bounds, only the cells that hold boids exist. They are found through a hash map of their
+// coordinates and numbered in the order their first boid was found in.
+struct SpatialGrid {
+    Rectangle bounds;
+    float cellSize;
+    int columns;
+    int rows;
+    int layersCount;
+
+    // Index of the first boid of each cell in sortedBoids, has (layersCount * columns * rows + 1) entries so that the
+    // boids of cell c are in the range [cellStarts[c], cellStarts[c + 1]). Cells are numbered row-major within each
+    // layer, and layer by layer.
+    int *cellStarts;
+    int cellsCapacity;
+
+    // Number of cells in cellStarts (for a sparse grid, the number of cells that hold boids)
+    int cellsCount;
+
+    // Hash map from cell coordinates to cells used by sparse grids, slots that weren't filled by the latest build are
+    // free so the map never has to be cleared
+    struct SpatialGridCellSlot *cellSlots;
+    uint32_t cellSlotsMask;
+    uint32_t generation;
+    bool isSparse;
+
+    // Cell order copies of the boids along with their index in the flock and the cell each boid was put in
+    struct BoidArrays sortedBoids;
+    // Used instead of sortedBoids when the grid was built compact, the two share memory so only one holds the copies
+    struct CompactBoidArrays compactBoids;
+    bool isCompact;
+    int *sortedIndices;
+    int *boidCells;
+    int boidsCapacity;
+
+    // Set when the buffers were carved out of an arena, which frees them instead of DestroySpatialGrid
+    bool isInArena;
+};
+
+// A slot of a sparse grid's hash map, holding the cell with the given coordinates and layer
+struct SpatialGridCellSlot {
+    int32_t column;
+    int32_t row;
+    // Build that filled the slot, the slot is free if it isn't the grid's current generation
+    uint32_t generation;
+    int32_t layer;
+    int32_t cell;
+};
+
+// A range [start, end) of sortedBoids (or compactBoids), all in the same layer
+struct SpatialGridSpan {
+    int start;
+    int end;
+    int layer;
+};
+
+bool InitializeSpatialGrid(struct SpatialGrid *grid, int boidsCapacity);
+
+// Gets the space the buffers of a grid for the given number of boids take up in an arena
+size_t GetSpatialGridArenaSize(int boidsCapacity);
+
+// Same as InitializeSpatialGrid but carves the buffers out of the arena
+bool InitializeSpatialGridFromArena(struct SpatialGrid *grid, struct Arena *arena, int boidsCapacity);
+
+// Sorts the boids into cells that are at least minimumCellSize wide. Boids outside the bounds are put in the nearest
+// edge cell, so boids that sit exactly on the far edges after wrapping around the bounds are still found. boidLayers
+// holds the layer of each boid, in [0, layersCount), or is NULL to put every boid in a single layer. Each layer gets
+// an even share of the cells.
+void BuildSpatialGrid(struct SpatialGrid *grid, const struct BoidArrays *boids, const uint8_t *boidLayers,
+                      int layersCount, int boidsCount, Rectangle bounds, float minimumCellSize);
+
+// Same as BuildSpatialGrid but the cell order copies are packed into compactBoids, with positions in fixed point across
+// the bounds. The copies take half the memory but sortedBoids is left out of date.
+void BuildCompactSpatialGrid(struct SpatialGrid *grid, const struct BoidArrays *boids, const uint8_t *boidLayers,
+                             int layersCount, int boidsCount, Rectangle bounds, float minimumCellSize);
+
+// Same as BuildSpatialGrid but without bounds, cells of minimumCellSize (or SPATIAL_GRID_MIN_SPARSE_CELL_SIZE if that
+// is larger) are only made where there are boids. The memory and time taken depend on the number of boids, however
+// far apart they are.
+void BuildSparseSpatialGrid(struct SpatialGrid *grid, const struct BoidArrays *boids, const uint8_t *boidLayers,
+                            int layersCount, int boidsCount, float minimumCellSize);
+
+// Gets the spans of sortedBoids covering the cell containing the position and the 8 cells around it (one span per row
+// of cells in each layer, layer by layer, or for a sparse grid one per run of consecutive cells that hold boids). Any
+// boid closer to the position than the minimumCellSize of the last build is in one of the spans. Returns the number of
+// spans written (at most 3 per layer, 9 for a sparse grid).
+int GetSpatialGridNeighbourSpans(const struct SpatialGrid *grid, Vector2 position,
+                                 struct SpatialGridSpan spans[SPATIAL_GRID_MAX_SPANS]);
+
+void DestroySpatialGrid(struct SpatialGrid *grid);
+
+#endif /* ifdef GRID_H */
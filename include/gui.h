@@ -1,6 +1,7 @@
 #ifndef GUI_H
 #define GUI_H
 
+#include <raylib.h>
 #include <stdbool.h>
 
 #include "flock.h"
@@ -33,6 +34,9 @@ enum GuiTab {
 #ifdef DEBUG
     DEBUG_INSPECTION_TAB,
 #endif /* ifdef DEBUG */
+#ifdef PROFILER
+    PROFILER_TAB,
+#endif /* ifdef PROFILER */
 };
 
 struct GuiState {
@@ -43,14 +47,28 @@ struct GuiState {
 
     // GUI element toggles
     bool showFPS;
+    // Set while a recording is replayed, the flock's parameters are shown but can't be changed
+    bool isFlockReadOnly;
+    // Camera the flock is drawn with, anything the GUI draws over the flock uses it too
+    Camera2D camera;
+    // Species whose parameters are shown, and the species whose weights towards it are shown
+    int editedSpecies;
+    int editedOtherSpecies;
+#ifdef PROFILER
+    struct PanelState profilerPanelState;
+    // Timings of the frame phases, the flock phases come from the snapshot. May be NULL.
+    const struct Profiler *frameProfiler;
+#endif /* ifdef PROFILER */
 #ifdef DEBUG
     struct PanelState debug_inspectionPanelState;
-    int debug_inspectedBoidIndex;
+    // ID of the inspected boid (see FlockState), so the same boid stays inspected when the flock re-sorts its boids
+    int debug_inspectedBoidId;
     bool debug_showRanges;
     bool debug_showVelocity;
     bool debug_showSeparation;
     bool debug_showAlignment;
     bool debug_showCohesion;
+    bool debug_showObstacleAvoidance;
 #endif /* ifdef DEBUG */
 };
 
@@ -60,10 +78,11 @@ void InitializeGui(struct GuiState *guiState, struct GuiConfig config);
 
 struct ParametersPanelResult {
     bool resetBoids;
+    bool clearObstacles;
     bool hasFlockConfigChanged;
     struct FlockConfig newFlockConfig;
 };
-struct ParametersPanelResult DrawParametersPanel(struct GuiState *guiState, const struct FlockState *flockState);
+struct ParametersPanelResult DrawParametersPanel(struct GuiState *guiState, const struct FlockSnapshot *flockSnapshot);
 
 struct GuiResult {
     struct ParametersPanelResult parametersPanelResult;
@@ -74,6 +93,17 @@ struct GuiResult {
     } debug_inspectionPanelResult ;
 #endif /* ifdef DEBUG */
 };
-struct GuiResult DrawGui(struct GuiState *state, const struct FlockState *flockState);
+struct GuiResult DrawGui(struct GuiState *state, const struct FlockSnapshot *flockSnapshot);
+
+struct ReplayBarResult {
+    bool togglePlaying;
+    bool hasSeeked;
+    double seekTime;
+};
+// Draws the playback controls along the bottom of the screen while a recording is replayed, times are in simulated
+// seconds
+struct ReplayBarResult DrawReplayBar(const struct GuiState *state, const struct FlockSnapshot *flockSnapshot,
+                                     double playheadTime, double startTime, double endTime, bool isPlaying,
+                                     float speed);
 
 #endif // !GUI_H
@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// A whole file mapped into memory, so it can be read and written like an array and the OS pages it in and out
+struct MappedFile {
+    void *data;
+    size_t size;
+    bool isWritable;
+
+#ifdef _WIN32
+    // HANDLEs, windows.h isn't included here since it clashes with raylib.h
+    void *file;
+    void *mapping;
+#else
+    int file;
+#endif /* ifdef _WIN32 */
+};
+
+// Maps an existing file for reading
+bool OpenMappedFile(struct MappedFile *mappedFile, const char *path);
+
+// Creates (or truncates) a file of the given size and maps it for writing
+bool CreateMappedFile(struct MappedFile *mappedFile, const char *path, size_t size);
+
+// Unmaps the file, anything written to a writable mapping is flushed to the file first
+void CloseMappedFile(struct MappedFile *mappedFile);
+
+#endif /* ifdef MAPPED_FILE_H */
@@ -0,0 +1,39 @@
+#ifndef MORTON_SORT_H
+#define MORTON_SORT_H
+
+#include <raylib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "boid.h"
+
+// Bits of each coordinate in a Morton key, positions are quantised to this many bits across the bounds
+#define MORTON_COORDINATE_BITS 16
+// Bits of the key sorted by each radix sort pass
+#define MORTON_RADIX_BITS 8
+
+// Buffers for sorting boids by Morton (Z-order) key. Boids that are close in space mostly get close keys, so sorting
+// by key puts neighbours close together in memory. Each buffer has two halves that the radix sort passes swap between.
+struct MortonSortBuffers {
+    uint32_t *keys[2];
+    int *indices[2];
+    int boidsCapacity;
+};
+
+// Gets the space the buffers for the given number of boids take up in an arena
+size_t GetMortonSortArenaSize(int boidsCapacity);
+
+// Carves the buffers out of the arena, they are freed along with it. Returns false if the arena is too small.
+bool InitializeMortonSortBuffers(struct MortonSortBuffers *buffers, struct Arena *arena, int boidsCapacity);
+
+// Interleaves the bits of the position's coordinates, quantised across the bounds. Positions outside the bounds are
+// clamped to the edges.
+uint32_t GetMortonKey(Vector2 position, Rectangle bounds);
+
+// Sorts the boids by the Morton key of their positions, returning the order: element n is the index of the boid that
+// should be moved to n. The order points into the buffers, so it is only valid until the next sort.
+const int *SortBoidsByMortonKey(struct MortonSortBuffers *buffers, const struct BoidArrays *boids, int boidsCount,
+                                Rectangle bounds);
+
+#endif /* ifdef MORTON_SORT_H */
@@ -0,0 +1,82 @@
+#ifndef NEIGHBOUR_LIST_H
+#define NEIGHBOUR_LIST_H
+
+#include <raylib.h>
+#include <stdbool.h>
+
+#include "boid.h"
+#include "grid.h"
+#include "steering.h"
+#include "worker_pool.h"
+
+// The lists are rebuilt once more than 1 in this many boids have moved more than half the skin since the last build
+#define NEIGHBOUR_LIST_MAX_MOVED_DIVISOR 16
+
+// Verlet neighbour lists: each boid's list holds every boid that was closer than the interaction range plus a skin
+// when the lists were built. Until a boid has moved more than half the skin, every boid now in range of it is in its
+// list, so the lists can be reused for several steps instead of searching the grid every step.
+//
+// The lists refer to boids by their slot in the grid they were built from. The grid isn't rebuilt while the lists are
+// in use, instead its copies of the boids are refreshed in the same order every update, so the neighbours of nearby
+// boids stay close together in memory.
+//
+// Boids that have moved further (including boids that wrapped around the bounds) are handled separately, by a small
+// grid of just those boids, so that a few fast or wrapping boids don't force the lists to be rebuilt every step.
+struct NeighbourLists {
+    // The grid slots of the neighbours of the boid at slot s are neighbours[starts[s]] to
+    // neighbours[starts[s + 1] - 1]
+    int *starts;
+    int *neighbours;
+    int neighboursCapacity;
+
+    // Positions of the boids when the lists were built, in grid order
+    float *builtPositionsX;
+    float *builtPositionsY;
+    int boidsCapacity;
+    // Number of boids the lists were built for, 0 when the lists have to be rebuilt before they are used
+    int boidsCount;
+    // Interaction range and skin the lists were built with
+    float range;
+    float skin;
+
+    // Boids that have moved more than half the skin since the build, set by UpdateNeighbourListMoves. Their current
+    // state is copied to movedBoids and put in movedGrid. isMoved and movedSlots (the slot of each moved boid in
+    // movedGrid) are in grid order, movedIndices holds the grid slot of each moved boid.
+    bool *isMoved;
+    int *movedIndices;
+    int *movedSlots;
+    int movedCount;
+    int movedCapacity;
+    struct BoidArrays movedBoids;
+    struct SpatialGrid movedGrid;
+};
+
+// Starts with no lists, nothing is allocated until the first build
+void InitializeNeighbourLists(struct NeighbourLists *lists);
+
+// Builds the lists of every boid closer than range + skin, using a grid that has just been built from the same boids
+// with a cell size of at least range + skin. The grid must not be rebuilt while the lists are in use. Returns false if
+// the lists couldn't be allocated.
+bool BuildNeighbourLists(struct NeighbourLists *lists, const struct SpatialGrid *grid, const struct BoidArrays *boids,
+                         int boidsCount, float range, float skin, struct WorkerPool *workerPool);
+
+// Copies the boids' current state into the grid the lists were built from and finds the boids that have moved more
+// than half the skin since then. The moved boids are put at infinity in the grid's copy, so no kernel counts them
+// there. Returns false if the lists have to be rebuilt first: they were invalidated, the boid count, range or skin has
+// changed, or too many boids have moved. The bounds are only used when the grid isn't sparse.
+bool UpdateNeighbourListMoves(struct NeighbourLists *lists, struct SpatialGrid *grid, const struct BoidArrays *boids,
+                              int boidsCount, float range, float skin, Rectangle bounds);
+
+// Adds the contributions of every boid within the query's ranges of the boid at sortedIndex in the grid the lists were
+// built from, once UpdateNeighbourListMoves has been called for the current boids.
+void AccumulateNeighbourListSteering(const struct NeighbourLists *lists, const struct SpatialGrid *grid,
+                                     int sortedIndex, const struct SteeringQuery *query, SteeringKernel kernel,
+                                     SteeringIndexedKernel indexedKernel, struct SteeringSums *sums);
+
+// Makes the next UpdateNeighbourListMoves ask for a rebuild, for when the boids or the grid have changed in a way the
+// lists can't detect
+void InvalidateNeighbourLists(struct NeighbourLists *lists);
+
+void DestroyNeighbourLists(struct NeighbourLists *lists);
+
+#endif /* ifdef NEIGHBOUR_LIST_H */
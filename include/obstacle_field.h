@@ -0,0 +1,76 @@
+#ifndef OBSTACLE_FIELD_H
+#define OBSTACLE_FIELD_H
+
+#include <raylib.h>
+#include <stdbool.h>
+
+// Largest distance between the field's samples
+#define OBSTACLE_FIELD_CELL_SIZE 4.F
+// Most samples a field can have, the cells are made larger than OBSTACLE_FIELD_CELL_SIZE to fit large bounds in this
+#define OBSTACLE_FIELD_MAX_SAMPLES (1 << 20)
+
+enum FlockObstacleShape {
+    FLOCK_OBSTACLE_CIRCLE,
+    FLOCK_OBSTACLE_RECTANGLE,
+};
+
+// A solid shape that boids steer around
+struct FlockObstacle {
+    enum FlockObstacleShape shape;
+    // Circles
+    Vector2 center;
+    float radius;
+    // Rectangles
+    Rectangle rectangle;
+};
+
+// Signed distance to the nearest obstacle and the direction away from it, at one point of an ObstacleField
+struct ObstacleFieldSample {
+    // Negative inside an obstacle
+    float distance;
+    // Unit vector that the distance grows fastest along
+    float gradientX;
+    float gradientY;
+};
+
+// Signed distance field of a set of obstacles, sampled on a regular grid over the flock's bounds. Baking it costs a
+// distance check per sample and obstacle, but afterwards finding the distance and direction to the nearest obstacle is
+// a single lookup whatever the number of obstacles. It only has to be baked again when the obstacles or the bounds
+// change. The buffers only grow.
+struct ObstacleField {
+    // Samples at the corners of the cells, row by row, (columns + 1) * (rows + 1) of them
+    struct ObstacleFieldSample *samples;
+    int samplesCapacity;
+    int columns;
+    int rows;
+
+    Vector2 origin;
+    float cellSize;
+    float inverseCellSize;
+
+    // Number of obstacles baked into the field, the field has no samples when it is 0
+    int obstaclesCount;
+};
+
+// Starts an empty field, nothing is allocated until obstacles are baked into it
+void InitializeObstacleField(struct ObstacleField *field);
+
+// Gets the signed distance from the point to the obstacle's edge, negative inside it, and the unit vector pointing
+// away from the obstacle
+float GetFlockObstacleDistance(const struct FlockObstacle *obstacle, Vector2 point, Vector2 *gradient);
+
+// Bakes the obstacles into the field over the bounds, replacing whatever it held. With no obstacles the field is just
+// emptied. Returns false if the samples couldn't be allocated, the field is then left empty.
+bool BakeObstacleField(struct ObstacleField *field, const struct FlockObstacle *obstacles, int obstaclesCount,
+                       Rectangle bounds);
+
+// Gets the distance and direction to the nearest obstacle, interpolated between the four samples around the position.
+// Positions outside the bounds get the nearest sample on the edge. An empty field is infinitely far from everything.
+struct ObstacleFieldSample SampleObstacleField(const struct ObstacleField *field, Vector2 position);
+
+// Fills the array with circular obstacles spread evenly over the bounds, for benchmarks and headless runs
+void SpreadFlockObstacles(struct FlockObstacle *obstacles, int obstaclesCount, Rectangle bounds);
+
+void DestroyObstacleField(struct ObstacleField *field);
+
+#endif /* ifdef OBSTACLE_FIELD_H */
@@ -0,0 +1,78 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Per-phase timers for flock updates and frames, enabled with the ENABLE_PROFILER CMake option (which defines
+// PROFILER). When it is disabled the PROFILER_ macros expand to nothing and none of this is compiled.
+
+#ifdef PROFILER
+#include <stdint.h>
+#include <stdio.h>
+
+#include "timer.h"
+
+// Number of samples each phase keeps, older samples are overwritten
+#define PROFILER_HISTORY_SIZE 256
+
+enum ProfilerPhase {
+    // Recorded by UpdateFlock in the flock's profiler
+    PROFILER_PHASE_GRID,
+    PROFILER_PHASE_STEERING,
+    PROFILER_PHASE_INTEGRATION,
+    PROFILER_PHASE_SORTING,
+    PROFILER_PHASE_RECORDING,
+    // Recorded by the game in its own profiler
+    PROFILER_PHASE_FLOCK_WAIT,
+    PROFILER_PHASE_DRAW_BOIDS,
+    PROFILER_PHASE_DRAW_GUI,
+    PROFILER_PHASE_PRESENT,
+
+    PROFILER_PHASES_COUNT,
+};
+#define PROFILER_FIRST_FRAME_PHASE PROFILER_PHASE_FLOCK_WAIT
+
+// Rolling history of one phase's durations, in seconds, and the number of boids at the time
+struct ProfilerPhaseHistory {
+    float durations[PROFILER_HISTORY_SIZE];
+    int boidsCounts[PROFILER_HISTORY_SIZE];
+    int nextSample;
+    int samplesCount;
+};
+
+struct Profiler {
+    struct ProfilerPhaseHistory phases[PROFILER_PHASES_COUNT];
+    // When set every sample is also written to it as a CSV row, not owned by the profiler (see OpenProfilerCsv)
+    FILE *csvFile;
+};
+
+struct ProfilerPhaseSummary {
+    int samplesCount;
+    // Milliseconds
+    float mean;
+    float median;
+    float percentile99;
+    float maximum;
+    float nanosecondsPerBoid;
+};
+
+void InitializeProfiler(struct Profiler *profiler);
+
+void RecordProfilerSample(struct Profiler *profiler, enum ProfilerPhase phase, double duration, int boidsCount);
+
+struct ProfilerPhaseSummary SummarizeProfilerPhase(const struct Profiler *profiler, enum ProfilerPhase phase);
+
+const char *GetProfilerPhaseName(enum ProfilerPhase phase);
+
+// Creates a CSV file and writes its header, returns NULL on failure. Any number of profilers can write to the same
+// file, it must be closed with fclose once none of them are using it.
+FILE *OpenProfilerCsv(const char *path);
+
+// Times the code between a PROFILER_BEGIN and PROFILER_END with the same phase in the same scope
+#define PROFILER_BEGIN(phase) const double profilerStart_##phase = GetMonotonicTime()
+#define PROFILER_END(profiler, phase, boidsCount)                                                                      \
+    RecordProfilerSample((profiler), (phase), GetMonotonicTime() - profilerStart_##phase, (boidsCount))
+#else
+#define PROFILER_BEGIN(phase)
+#define PROFILER_END(profiler, phase, boidsCount)
+#endif /* ifdef PROFILER */
+
+#endif /* ifdef PROFILER_H */
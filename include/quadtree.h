@@ -0,0 +1,71 @@
+#ifndef QUADTREE_H
+#define QUADTREE_H
+
+#include <stdbool.h>
+
+#include "boid.h"
+#include "steering.h"
+
+// Boids per leaf, nodes with more boids than this are split into quadrants
+#define QUADTREE_LEAF_SIZE 16
+// Nodes this deep are always leaves, so boids stacked on the same spot can't split forever
+#define QUADTREE_MAX_DEPTH 24
+
+// Node of a FlockQuadtree. The node's boids are [start, end) of the tree's sortedBoids, every node's range is split
+// between its children.
+struct QuadtreeNode {
+    // Smallest rectangle containing the node's boids
+    float minX;
+    float minY;
+    float maxX;
+    float maxY;
+
+    // Sums of the node's boid positions and velocities
+    float positionX;
+    float positionY;
+    float velocityX;
+    float velocityY;
+
+    int start;
+    int end;
+
+    // Children are stored next to each other, only non-empty quadrants get a child. Leaves have no children.
+    int firstChild;
+    int childrenCount;
+};
+
+// Barnes-Hut quadtree over the flock, used to approximate alignment and cohesion over long ranges. Rebuilt from
+// scratch every update, the buffers only grow.
+struct FlockQuadtree {
+    // nodes[0] is the root
+    struct QuadtreeNode *nodes;
+    int nodesCount;
+    int nodesCapacity;
+
+    // Tree order copies of the boids, the index of each in the flock and the position of each flock boid in the tree
+    struct BoidArrays sortedBoids;
+    int *sortedIndices;
+    int *boidSlots;
+    int boidsCapacity;
+    // Number of boids in the last build, the next build starts from the same order if the count hasn't changed
+    int boidsCount;
+};
+
+// Starts an empty tree, nothing is allocated until the first build
+void InitializeFlockQuadtree(struct FlockQuadtree *tree);
+
+// Builds the tree from the boids' current positions. Returns false if the tree couldn't be allocated, the tree must
+// not be used until it has been built successfully.
+bool BuildFlockQuadtree(struct FlockQuadtree *tree, const struct BoidArrays *boids, int boidsCount);
+
+// Adds the alignment and cohesion contributions of the boids within range of the query's position to the sums (the
+// query's separation range is ignored). Nodes whose boids are all in range are added as a whole, which is exact.
+// Nodes on the edge of the range are also added as a whole, if their centre of mass is in range, once their size
+// over the distance to their centre of mass is below the opening angle (0 visits every boid on the edge). The boid
+// at boidSlot in the tree is never counted.
+void AccumulateQuadtreeSteering(const struct FlockQuadtree *tree, const struct SteeringQuery *query, int boidSlot,
+                                float openingAngle, SteeringKernel kernel, struct SteeringSums *sums);
+
+void DestroyFlockQuadtree(struct FlockQuadtree *tree);
+
+#endif /* ifdef QUADTREE_H */
@@ -0,0 +1,94 @@
+#ifndef STEERING_H
+#define STEERING_H
+
+#include <stdbool.h>
+
+#include "boid.h"
+
+// Inputs to the neighbour accumulation kernels for a single boid. Ranges are squared so that boids can be rejected
+// without taking a square root.
+struct SteeringQuery {
+    float positionX;
+    float positionY;
+
+    float separationRange;
+    float separationRangeSquared;
+    float alignmentRangeSquared;
+    float cohesionRangeSquared;
+    // Largest of the squared ranges, neighbours further than this are skipped entirely
+    float interactionRangeSquared;
+
+#ifdef DEBUG
+    float collisionDistanceSquared;
+#endif /* ifdef DEBUG */
+};
+
+// Running totals of the neighbours' contributions to each force, the kernels add to these so they can be called once
+// per span of neighbours.
+struct SteeringSums {
+    // Sum of the unit vectors away from each neighbour in separation range, scaled by (range / distance - 1)
+    float separationX;
+    float separationY;
+    int separationCount;
+
+    float velocityX;
+    float velocityY;
+    int alignmentCount;
+
+    float positionX;
+    float positionY;
+    int cohesionCount;
+
+#ifdef DEBUG
+    int collisionCount;
+#endif /* ifdef DEBUG */
+};
+
+// Accumulates the contributions of the boids in [start, end) of the arrays
+typedef void (*SteeringKernel)(const struct SteeringQuery *query, const struct BoidArrays *boids, int start, int end,
+                               struct SteeringSums *sums);
+
+// Picks the widest kernel supported by the CPU, the BOIDS_STEERING_KERNEL environment variable can be set to the name
+// of a kernel ("scalar", "sse2" or "avx2") to override the choice.
+SteeringKernel GetSteeringKernel(void);
+
+const char *GetSteeringKernelName(SteeringKernel kernel);
+
+// Accumulates the contributions of the boids at the given indices of the arrays, for neighbours that aren't contiguous
+// in memory
+typedef void (*SteeringIndexedKernel)(const struct SteeringQuery *query, const struct BoidArrays *boids,
+                                      const int *indices, int count, struct SteeringSums *sums);
+
+// Gets the indexed kernel that uses the same instructions as the kernel
+SteeringIndexedKernel GetSteeringIndexedKernel(SteeringKernel kernel);
+
+// Accumulates the contributions of the boids in [start, end) of compact arrays, unpacking each boid as it is read
+typedef void (*CompactSteeringKernel)(const struct SteeringQuery *query, const struct CompactBoidArrays *boids,
+                                      int start, int end, struct SteeringSums *sums);
+
+// Gets the compact kernel that uses the same instructions as the kernel, or the scalar one if there is none
+CompactSteeringKernel GetCompactSteeringKernel(SteeringKernel kernel);
+
+void AccumulateSteeringScalar(const struct SteeringQuery *query, const struct BoidArrays *boids, int start, int end,
+                              struct SteeringSums *sums);
+
+void AccumulateSteeringIndexedScalar(const struct SteeringQuery *query, const struct BoidArrays *boids,
+                                     const int *indices, int count, struct SteeringSums *sums);
+
+void AccumulateCompactSteeringScalar(const struct SteeringQuery *query, const struct CompactBoidArrays *boids,
+                                     int start, int end, struct SteeringSums *sums);
+
+#ifdef BOIDS_X86_KERNELS
+void AccumulateSteeringSse2(const struct SteeringQuery *query, const struct BoidArrays *boids, int start, int end,
+                            struct SteeringSums *sums);
+
+// Must only be called when the CPU supports AVX2
+void AccumulateSteeringAvx2(const struct SteeringQuery *query, const struct BoidArrays *boids, int start, int end,
+                            struct SteeringSums *sums);
+void AccumulateSteeringIndexedAvx2(const struct SteeringQuery *query, const struct BoidArrays *boids,
+                                   const int *indices, int count, struct SteeringSums *sums);
+void AccumulateCompactSteeringAvx2(const struct SteeringQuery *query, const struct CompactBoidArrays *boids, int start,
+                                   int end, struct SteeringSums *sums);
+#endif /* ifdef BOIDS_X86_KERNELS */
+
+#endif /* ifdef STEERING_H */
@@ -0,0 +1,8 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+// Seconds since an arbitrary point in the past from a monotonic, high resolution clock. Only the difference between
+// two readings is meaningful. Unlike raylib's GetTime this doesn't need a window.
+double GetMonotonicTime(void);
+
+#endif /* ifdef TIMER_H */
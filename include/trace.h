@@ -0,0 +1,42 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Timeline of flock updates and frames in the Chrome trace event format, which Perfetto and chrome://tracing can
+// load. Enabled with the ENABLE_TRACING CMake option (which defines TRACING), otherwise the TRACE_ macros expand to
+// nothing and none of this is compiled.
+//
+// Each thread records into its own preallocated ring of events, so recording never allocates or waits for another
+// thread. When a ring is full the oldest events are overwritten, so a trace always covers the most recent events.
+
+#ifdef TRACING
+#include <stdbool.h>
+
+#include "timer.h"
+
+// Number of events each thread keeps
+#define TRACE_EVENTS_PER_THREAD (1 << 16)
+#define TRACE_MAX_THREADS 64
+#define TRACE_THREAD_NAME_SIZE 32
+
+// Names the calling thread in the trace, threads that record without being named are called "Thread"
+void SetTraceThreadName(const char *name);
+
+// Records an event on the calling thread, name must outlive the trace. Times are from GetMonotonicTime.
+void AddTraceEvent(const char *name, double startTime, double endTime);
+
+// Writes the events currently held by every thread as a Chrome trace JSON file. Threads can keep recording while it
+// is written.
+bool WriteTrace(const char *path);
+
+// Frees every thread's events. No thread may record while, or after, this is called.
+void ShutdownTrace(void);
+
+// Records the code between a TRACE_BEGIN and TRACE_END with the same name in the same scope as an event
+#define TRACE_BEGIN(name) const double traceStart_##name = GetMonotonicTime()
+#define TRACE_END(name) AddTraceEvent(#name, traceStart_##name, GetMonotonicTime())
+#else
+#define TRACE_BEGIN(name)
+#define TRACE_END(name)
+#endif /* ifdef TRACING */
+
+#endif /* ifdef TRACE_H */
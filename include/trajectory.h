@@ -0,0 +1,168 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "boid.h"
+#include "checkpoint.h"
+#include "flock.h"
+#include "mapped_file.h"
+
+// Trajectory files hold the positions and velocities of every boid at every recorded step. The file is a
+// TrajectoryFileHeader, then one chunk per frame (a TrajectoryChunkHeader followed by the encoded boids), then an index
+// of the chunks and a TrajectoryFileFooter pointing at the index. Everything is stored in the byte order of the
+// machine that wrote it. Chunks aren't aligned, so they are copied out of the file rather than read in place.
+//
+// Each value is quantised to a multiple of the header's quantum and stored as the difference from the same boid's
+// value in the previous frame, zigzag and varint encoded (so small changes take 1-2 bytes). Keyframes store the
+// differences from 0 instead so they can be decoded without the frames before them. The four arrays are encoded one
+// after the other: positionsX, positionsY, velocitiesX, velocitiesY.
+
+#define TRAJECTORY_MAGIC "BOIDTRAJ"
+#define TRAJECTORY_INDEX_MAGIC "BOIDTIDX"
+#define TRAJECTORY_VERSION 11
+#define TRAJECTORY_BYTE_ORDER_MARK 0x01020304U
+
+#define TRAJECTORY_CHUNK_KEYFRAME 1U
+// Most quanta a value is stored as, values further from 0 are clamped. Just under 2^30, so the difference between two
+// values always fits in an int32.
+#define TRAJECTORY_MAX_QUANTA 1073741760.F
+
+struct TrajectoryFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    float positionQuantum;
+    float velocityQuantum;
+    uint32_t keyframeInterval;
+    uint32_t reserved;
+    // Config of the flock when recording started
+    struct FlockCheckpointConfig config;
+};
+
+struct TrajectoryChunkHeader {
+    uint64_t stepsCount;
+    double time;
+    uint32_t boidsCount;
+    uint32_t flags;
+    // Size of the encoded boids after this header
+    uint64_t encodedSize;
+};
+
+struct TrajectoryIndexEntry {
+    uint64_t stepsCount;
+    double time;
+    // Offset of the chunk header from the start of the file
+    uint64_t offset;
+    uint32_t boidsCount;
+    uint32_t flags;
+};
+
+struct TrajectoryFileFooter {
+    uint64_t indexOffset;
+    uint64_t framesCount;
+    char magic[8];
+};
+
+struct TrajectoryRecorderConfig {
+    const char *path;
+    // Number of frames that can wait to be encoded before recording blocks the simulation
+    int ringSize;
+    // Every this many frames is a keyframe
+    int keyframeInterval;
+    // Values are rounded to multiples of these, so the error is at most half of the quantum
+    float positionQuantum;
+    float velocityQuantum;
+};
+
+// A copy of the boids at one step, waiting in the recorder's ring to be encoded
+struct TrajectoryFrame {
+    struct BoidArrays boids;
+    int boidsCount;
+    int boidsCapacity;
+    uint64_t stepsCount;
+    double time;
+};
+
+// Records flocks to a trajectory file. The simulation thread only copies each step into a ring of preallocated frames,
+// a background thread encodes them and writes them to the file.
+struct TrajectoryRecorder {
+    struct TrajectoryRecorderConfig config;
+    FILE *file;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t frameRecorded;
+    pthread_cond_t frameWritten;
+
+    // Ring of frames, [firstFrame, firstFrame + framesCount) are waiting to be written. Guarded by the mutex.
+    struct TrajectoryFrame *frames;
+    int firstFrame;
+    int framesCount;
+    bool isStopping;
+
+    // Only used by the background thread
+    int32_t *previousValues;
+    int previousBoidsCount;
+    uint8_t *encodedBuffer;
+    size_t encodedCapacity;
+    struct TrajectoryIndexEntry *index;
+    uint64_t indexCount;
+    uint64_t indexCapacity;
+    uint64_t fileOffset;
+    bool hasWriteFailed;
+
+    // Number of times recording had to wait for the background thread
+    uint64_t stallsCount;
+    bool isRunning;
+};
+
+struct TrajectoryRecorderConfig CreateDefaultTrajectoryRecorderConfig(const char *path);
+
+// Creates the file and starts the background thread. Frames are preallocated for the config's number of boids and
+// grown if a larger flock is recorded.
+bool StartTrajectoryRecorder(struct TrajectoryRecorder *recorder, struct TrajectoryRecorderConfig config,
+                             const struct FlockConfig *flockConfig);
+
+// Copies the boids into the ring, waiting for a free frame if the background thread has fallen behind. Called by
+// UpdateFlock after each step when a recorder is attached to the flock. boidIndices maps each boid's ID to its index
+// (see FlockState), the boids are recorded in ID order so each boid keeps its place from frame to frame even when the
+// flock re-sorts them. NULL records them in index order.
+void RecordTrajectoryFrame(struct TrajectoryRecorder *recorder, const struct BoidArrays *boids,
+                           const int *boidIndices, int boidsCount, uint64_t stepsCount, double time);
+
+// Writes the frames still in the ring and the index, then closes the file. Returns false if anything failed to write.
+bool StopTrajectoryRecorder(struct TrajectoryRecorder *recorder);
+
+// Plays back trajectory files. The file is mapped and frames are only decoded when they are read, starting from the
+// frame read before it when playing forwards or from the nearest keyframe when seeking.
+struct TrajectoryReader {
+    struct MappedFile file;
+    struct TrajectoryFileHeader header;
+    struct FlockConfig config;
+
+    // Copied out of the file since it isn't aligned
+    struct TrajectoryIndexEntry *index;
+    uint64_t framesCount;
+    uint64_t indexOffset;
+
+    // Quantised values of the last decoded frame, or -1 if there isn't one
+    int32_t *values;
+    int valuesCapacity;
+    int64_t decodedFrame;
+};
+
+bool OpenTrajectory(struct TrajectoryReader *reader, const char *path);
+
+// Returns the last frame recorded at or before time, or the first frame if time is before it
+uint64_t FindTrajectoryFrame(const struct TrajectoryReader *reader, double time);
+
+// Decodes a frame into the snapshot, as if it had been copied from the flock right after that step. The snapshot's
+// config is the one recording started with.
+bool ReadTrajectoryFrame(struct TrajectoryReader *reader, uint64_t frameIndex, struct FlockSnapshot *snapshot);
+
+void CloseTrajectory(struct TrajectoryReader *reader);
+
+#endif /* ifdef TRAJECTORY_H */
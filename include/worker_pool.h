@@ -0,0 +1,48 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#define WORKER_POOL_MAX_THREADS 256
+// Jobs are split into about this many chunks per thread so that threads that finish early can take more work
+#define WORKER_POOL_CHUNKS_PER_THREAD 8
+// Jobs smaller than this run on the calling thread, waking the workers would cost more than it saves
+#define WORKER_POOL_MIN_CHUNK_SIZE 128
+
+// Function that processes the items [start, end) of a job
+typedef void (*WorkerPoolTask)(void *context, int start, int end);
+
+// Persistent set of threads that split jobs over a range of items between them. The thread that runs a job also works
+// on it, so a pool of N threads has N - 1 workers.
+struct WorkerPool {
+    pthread_t *workers;
+    int workersCount;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t jobStarted;
+    pthread_cond_t jobFinished;
+
+    // Current job, guarded by the mutex
+    WorkerPoolTask task;
+    void *context;
+    int itemsCount;
+    int chunkSize;
+    int nextItem;
+    int busyWorkers;
+    unsigned int jobId;
+    bool isShuttingDown;
+
+    bool isInitialized;
+};
+
+bool InitializeWorkerPool(struct WorkerPool *pool, int threadCount);
+
+// Runs the task over [0, itemsCount) split across the pool and waits for it to finish
+void RunWorkerPool(struct WorkerPool *pool, WorkerPoolTask task, void *context, int itemsCount);
+
+int GetWorkerPoolThreadCount(const struct WorkerPool *pool);
+
+void DestroyWorkerPool(struct WorkerPool *pool);
+
+#endif /* ifdef WORKER_POOL_H */
@@ -0,0 +1,137 @@
+#include "arena.h"
+
+#include "flock_log.h"
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif /* ifdef _WIN32 */
+#ifdef __linux__
+#include <sys/mman.h>
+#endif /* ifdef __linux__ */
+
+size_t GetArenaAllocationSize(const size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+// Internal function that checks if huge pages were asked for with the BOIDS_HUGE_PAGES environment variable
+static bool AreHugePagesEnabled(void) {
+    const char *value = getenv("BOIDS_HUGE_PAGES");
+    return value != NULL && strcmp(value, "1") == 0;
+}
+
+// Internal function that allocates the arena's memory, mapping it when it should be backed by huge pages
+static bool AllocateArenaMemory(struct Arena *arena, size_t size) {
+#ifdef __linux__
+    if (size >= ARENA_HUGE_PAGE_SIZE && AreHugePagesEnabled()) {
+        size = (size + ARENA_HUGE_PAGE_SIZE - 1) & ~(ARENA_HUGE_PAGE_SIZE - 1);
+        void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory != MAP_FAILED) {
+            // Transparent huge pages are only a hint, the kernel falls back to normal pages when it has none free
+            if (madvise(memory, size, MADV_HUGEPAGE) != 0) {
+                FlockLog(LOG_WARNING, "AllocateArenaMemory: Huge pages are not available, using normal pages.");
+            }
+            arena->memory = memory;
+            arena->size = size;
+            arena->isMapped = true;
+            return true;
+        }
+        FlockLog(LOG_WARNING, "AllocateArenaMemory: Failed to map %zu bytes, using the heap instead.", size);
+    }
+#else
+    if (AreHugePagesEnabled()) {
+        FlockLog(LOG_WARNING, "AllocateArenaMemory: Huge pages are only supported on Linux.");
+    }
+#endif /* ifdef __linux__ */
+
+    void *memory = NULL;
+#ifdef _WIN32
+    memory = _aligned_malloc(size, ARENA_ALIGNMENT);
+#else
+    if (posix_memalign(&memory, ARENA_ALIGNMENT, size) != 0) {
+        memory = NULL;
+    }
+#endif /* ifdef _WIN32 */
+    if (memory == NULL) {
+        return false;
+    }
+
+    arena->memory = memory;
+    arena->size = size;
+    arena->isMapped = false;
+    return true;
+}
+
+bool ReserveArena(struct Arena *arena, const size_t size) {
+    if (arena == NULL) {
+        FlockLog(LOG_ERROR, "ReserveArena: Recieved NULL pointer to arena.");
+        return false;
+    }
+
+    arena->used = 0;
+    if (arena->memory != NULL && size <= arena->size) {
+        return true;
+    }
+
+    FreeArena(arena);
+    if (!AllocateArenaMemory(arena, GetArenaAllocationSize(size > 0 ? size : 1))) {
+        FlockLog(LOG_ERROR, "ReserveArena: Failed to allocate %zu bytes.", size);
+        return false;
+    }
+
+    return true;
+}
+
+void ResetArena(struct Arena *arena) {
+    if (arena == NULL) {
+        FlockLog(LOG_ERROR, "ResetArena: Recieved NULL pointer to arena.");
+        return;
+    }
+
+    arena->used = 0;
+}
+
+void *AllocateFromArena(struct Arena *arena, const size_t size) {
+    if (arena == NULL) {
+        FlockLog(LOG_ERROR, "AllocateFromArena: Recieved NULL pointer to arena.");
+        return NULL;
+    }
+
+    const size_t allocationSize = GetArenaAllocationSize(size);
+    if (arena->memory == NULL || allocationSize > arena->size - arena->used) {
+        FlockLog(LOG_ERROR, "AllocateFromArena: %zu bytes don't fit in the %zu bytes left.", size,
+                 arena->size - arena->used);
+        return NULL;
+    }
+
+    void *allocation = arena->memory + arena->used;
+    arena->used += allocationSize;
+    return allocation;
+}
+
+void FreeArena(struct Arena *arena) {
+    if (arena == NULL) {
+        FlockLog(LOG_ERROR, "FreeArena: Recieved NULL pointer to arena.");
+        return;
+    }
+
+    if (arena->memory != NULL) {
+#ifdef __linux__
+        if (arena->isMapped) {
+            munmap(arena->memory, arena->size);
+        } else {
+            free(arena->memory);
+        }
+#elif defined(_WIN32)
+        _aligned_free(arena->memory);
+#else
+        free(arena->memory);
+#endif /* ifdef __linux__ */
+    }
+
+    *arena = (struct Arena){0};
+}
@@ -0,0 +1,541 @@
+#include "flock.h"
+#include "flock_log.h"
+#include "obstacle_field.h"
+#include "steering.h"
+#include "timer.h"
+
+#include <math.h>
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+// Leave out the parts of windows.h that clash with raylib.h
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#define NOUSER
+#include <windows.h>
+// windows.h must come first
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif /* ifdef _WIN32 */
+
+// Flock area per boid, the bounds grow with the boid count so every case has the density of 10000 boids in 1600x900
+#define BENCH_AREA_PER_BOID 144.F
+// Each case runs for about this many boid updates (clamped to the step limits below) so small flocks still get enough
+// samples and large flocks don't take minutes
+#define BENCH_BOID_STEPS_PER_CASE 20000000.0
+#define BENCH_MIN_STEPS 10
+#define BENCH_MAX_STEPS 1000
+#define BENCH_WARMUP_STEPS 3
+
+#define BENCH_MAX_BOID_COUNTS 16
+
+struct BenchRanges {
+    const char *name;
+    float separationRange;
+    float alignmentRange;
+    float cohesionRange;
+};
+
+static const struct BenchRanges benchRanges[] = {
+    {.name = "short", .separationRange = 25.F, .alignmentRange = 50.F, .cohesionRange = 50.F},
+    {.name = "default", .separationRange = 50.F, .alignmentRange = 100.F, .cohesionRange = 100.F},
+    {.name = "long", .separationRange = 100.F, .alignmentRange = 200.F, .cohesionRange = 200.F},
+};
+
+// A rule is disabled by setting its factor to 0, the same way it is turned off from the GUI
+struct BenchRules {
+    const char *name;
+    bool separation;
+    bool alignment;
+    bool cohesion;
+};
+
+static const struct BenchRules benchRules[] = {
+    {.name = "all", .separation = true, .alignment = true, .cohesion = true},
+    {.name = "separation", .separation = true, .alignment = false, .cohesion = false},
+    {.name = "none", .separation = false, .alignment = false, .cohesion = false},
+};
+
+#define BENCH_RANGES_COUNT ((int)(sizeof(benchRanges) / sizeof(benchRanges[0])))
+#define BENCH_RULES_COUNT ((int)(sizeof(benchRules) / sizeof(benchRules[0])))
+
+struct BenchOptions {
+    int boidCounts[BENCH_MAX_BOID_COUNTS];
+    int boidCountsCount;
+    // Names of the range and rule presets to run, NULL runs all of them
+    const char *ranges;
+    const char *rules;
+
+    int steps; // 0 picks the number of steps from the boid count
+    float deltaTime;
+    unsigned int seed;
+    int threadCount;
+    // Opening angle of the quadtree, negative runs every case with the grid only
+    float quadtreeOpeningAngle;
+    // Skin of the neighbour lists, negative runs every case without them
+    float neighbourListSkin;
+    int steeringInterval;
+    int sortInterval;
+    bool useCompactStorage;
+    bool useOpenWorld;
+    int speciesCount;
+    int obstaclesCount;
+    const char *outputPath;
+};
+
+struct BenchResult {
+    int steps;
+    double totalTime;
+    // Per step times in ns per boid
+    double mean;
+    double minimum;
+    double p50;
+    double p90;
+    double p99;
+    double maximum;
+    long long peakMemoryBytes;
+};
+
+// Internal function that prints the command line options
+static void PrintUsage(const char *program) {
+    printf("Usage: %s [options]\n"
+           "  --boids <list>              Comma separated boid counts (default 1000,10000,100000,1000000)\n"
+           "  --ranges <list>             Comma separated range presets: short, default, long (default all)\n"
+           "  --rules <list>              Comma separated rule presets: all, separation, none (default all)\n"
+           "  --steps <count>             Steps per case, 0 scales the steps with the boid count (default 0)\n"
+           "  --dt <seconds>              Timestep (default 1/60)\n"
+           "  --seed <seed>               Seed for the spawn positions (default 0)\n"
+           "  --threads <count>           Number of update threads (default 1)\n"
+           "  --quadtree <angle>          Use the quadtree for alignment and cohesion with this opening angle\n"
+           "  --neighbour-lists <skin>    Reuse neighbour lists with this skin across steps\n"
+           "  --steering-interval <steps> Recompute each boid's steering force every this many steps (default 1)\n"
+           "  --species <count>           Split the boids evenly between this many species, 1 to 4 (default 1)\n"
+           "  --obstacles <count>         Spread this many circular obstacles evenly over the bounds (default 0)\n"
+           "  --compact <0|1>             Pack the grid's copy of the boids into 8 bytes each (default 0)\n"
+           "  --open-world <0|1>          Let boids leave the bounds instead of wrapping around (default 0)\n"
+           "  --sort-interval <steps>     Re-sort the boids in memory every this many steps, 0 never (default 16)\n"
+           "  --output <path>             Write the JSON results to a file instead of stdout\n"
+           "  --help                      Show this message\n",
+           program);
+}
+
+// Internal function that parses a comma separated list of boid counts, returns false if the list is invalid
+static bool ParseBoidCounts(const char *value, struct BenchOptions *options) {
+    options->boidCountsCount = 0;
+    const char *cursor = value;
+    while (*cursor != '\0') {
+        char *end = NULL;
+        const long count = strtol(cursor, &end, 10);
+        if (end == cursor || count <= 0 || options->boidCountsCount >= BENCH_MAX_BOID_COUNTS) {
+            return false;
+        }
+        options->boidCounts[options->boidCountsCount++] = (int)count;
+        cursor = *end == ',' ? end + 1 : end;
+    }
+    return options->boidCountsCount > 0;
+}
+
+// Internal function that checks if a name is in a comma separated list, a NULL list contains every name
+static bool ListContains(const char *list, const char *name) {
+    if (list == NULL) {
+        return true;
+    }
+    const size_t nameLength = strlen(name);
+    const char *cursor = list;
+    while (*cursor != '\0') {
+        const char *end = strchr(cursor, ',');
+        const size_t length = end != NULL ? (size_t)(end - cursor) : strlen(cursor);
+        if (length == nameLength && strncmp(cursor, name, length) == 0) {
+            return true;
+        }
+        if (end == NULL) {
+            break;
+        }
+        cursor = end + 1;
+    }
+    return false;
+}
+
+// Internal function that parses the command line, returns false if the program should exit
+static bool ParseOptions(int argc, char *argv[], struct BenchOptions *options, int *exitCode) {
+    *options = (struct BenchOptions){
+        .boidCounts = {1000, 10000, 100000, 1000000},
+        .boidCountsCount = 4,
+        .ranges = NULL,
+        .rules = NULL,
+        .steps = 0,
+        .deltaTime = 1.F / 60.F,
+        .seed = 0,
+        .threadCount = 1,
+        .quadtreeOpeningAngle = -1.F,
+        .neighbourListSkin = -1.F,
+        .steeringInterval = 1,
+        .sortInterval = 16,
+        .useCompactStorage = false,
+        .useOpenWorld = false,
+        .speciesCount = 1,
+        .obstaclesCount = 0,
+        .outputPath = NULL,
+    };
+
+    for (int i = 1; i < argc; i++) {
+        const char *option = argv[i];
+        if (strcmp(option, "--help") == 0) {
+            PrintUsage(argv[0]);
+            *exitCode = EXIT_SUCCESS;
+            return false;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for option %s\n", option);
+            PrintUsage(argv[0]);
+            *exitCode = EXIT_FAILURE;
+            return false;
+        }
+
+        const char *value = argv[++i];
+        if (strcmp(option, "--boids") == 0) {
+            if (!ParseBoidCounts(value, options)) {
+                fprintf(stderr, "Invalid boid counts %s\n", value);
+                *exitCode = EXIT_FAILURE;
+                return false;
+            }
+        } else if (strcmp(option, "--ranges") == 0) {
+            options->ranges = value;
+        } else if (strcmp(option, "--rules") == 0) {
+            options->rules = value;
+        } else if (strcmp(option, "--steps") == 0) {
+            options->steps = atoi(value);
+        } else if (strcmp(option, "--dt") == 0) {
+            options->deltaTime = strtof(value, NULL);
+        } else if (strcmp(option, "--seed") == 0) {
+            options->seed = (unsigned int)strtoul(value, NULL, 10);
+        } else if (strcmp(option, "--threads") == 0) {
+            options->threadCount = atoi(value);
+        } else if (strcmp(option, "--quadtree") == 0) {
+            options->quadtreeOpeningAngle = strtof(value, NULL);
+        } else if (strcmp(option, "--neighbour-lists") == 0) {
+            options->neighbourListSkin = strtof(value, NULL);
+        } else if (strcmp(option, "--steering-interval") == 0) {
+            options->steeringInterval = atoi(value);
+        } else if (strcmp(option, "--sort-interval") == 0) {
+            options->sortInterval = atoi(value);
+        } else if (strcmp(option, "--compact") == 0) {
+            options->useCompactStorage = atoi(value) != 0;
+        } else if (strcmp(option, "--open-world") == 0) {
+            options->useOpenWorld = atoi(value) != 0;
+        } else if (strcmp(option, "--species") == 0) {
+            options->speciesCount = atoi(value);
+        } else if (strcmp(option, "--obstacles") == 0) {
+            options->obstaclesCount = atoi(value);
+        } else if (strcmp(option, "--output") == 0) {
+            options->outputPath = value;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", option);
+            PrintUsage(argv[0]);
+            *exitCode = EXIT_FAILURE;
+            return false;
+        }
+    }
+
+    if (options->steps < 0 || options->deltaTime <= 0.F || options->steeringInterval < 1 || options->sortInterval < 0) {
+        fprintf(stderr, "Steps and the sort interval must not be negative, the timestep must be greater than 0 and the "
+                        "steering interval at least 1\n");
+        *exitCode = EXIT_FAILURE;
+        return false;
+    }
+    if (options->speciesCount < 1 || options->speciesCount > FLOCK_MAX_SPECIES) {
+        fprintf(stderr, "The number of species must be between 1 and %d\n", FLOCK_MAX_SPECIES);
+        *exitCode = EXIT_FAILURE;
+        return false;
+    }
+    if (options->obstaclesCount < 0) {
+        fprintf(stderr, "The number of obstacles must not be negative\n");
+        *exitCode = EXIT_FAILURE;
+        return false;
+    }
+
+    return true;
+}
+
+// Internal function that gets the largest amount of memory the process has had resident so far, in bytes
+static long long GetPeakMemoryUsage(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return -1;
+    }
+    return (long long)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return (long long)usage.ru_maxrss; // Already in bytes on macOS
+#else
+    return (long long)usage.ru_maxrss * 1024LL;
+#endif /* ifdef __APPLE__ */
+#endif /* ifdef _WIN32 */
+}
+
+// Internal function used to sort the step times
+static int CompareDoubles(const void *a, const void *b) {
+    const double left = *(const double *)a;
+    const double right = *(const double *)b;
+    return (left > right) - (left < right);
+}
+
+// Internal function used to sort the boid counts
+static int CompareInts(const void *a, const void *b) {
+    const int left = *(const int *)a;
+    const int right = *(const int *)b;
+    return (left > right) - (left < right);
+}
+
+// Internal function that gets a percentile of sorted samples using the nearest rank
+static double GetPercentile(const double *sortedSamples, const int samplesCount, const double percentile) {
+    int rank = (int)ceil((percentile / 100.0) * (double)samplesCount);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > samplesCount) {
+        rank = samplesCount;
+    }
+    return sortedSamples[rank - 1];
+}
+
+// Internal function that creates the flock config for one case
+static struct FlockConfig CreateBenchFlockConfig(const struct BenchOptions *options, const int boidsCount,
+                                                 const struct BenchRanges *ranges, const struct BenchRules *rules) {
+    // Keep the 16:9 shape of the window
+    const float height = sqrtf(((float)boidsCount * BENCH_AREA_PER_BOID * 9.F) / 16.F);
+    const float width = (height * 16.F) / 9.F;
+
+    struct FlockConfig config =
+        CreateDefaultFlockConfig((Rectangle){.x = 0.F, .y = 0.F, .width = width, .height = height});
+    config.numberOfBoids = boidsCount;
+    config.separationRange = ranges->separationRange;
+    config.alignmentRange = ranges->alignmentRange;
+    config.cohesionRange = ranges->cohesionRange;
+    config.separationFactor = rules->separation ? config.separationFactor : 0.F;
+    config.alignmentFactor = rules->alignment ? config.alignmentFactor : 0.F;
+    config.cohesionFactor = rules->cohesion ? config.cohesionFactor : 0.F;
+    config.threadCount = options->threadCount;
+    config.seed = options->seed;
+    config.useQuadtree = options->quadtreeOpeningAngle >= 0.F;
+    if (config.useQuadtree) {
+        config.quadtreeOpeningAngle = options->quadtreeOpeningAngle;
+    }
+    config.useNeighbourLists = options->neighbourListSkin >= 0.F;
+    if (config.useNeighbourLists) {
+        config.neighbourListSkin = options->neighbourListSkin;
+    }
+    config.steeringInterval = options->steeringInterval;
+    config.sortInterval = options->sortInterval;
+    config.useCompactStorage = options->useCompactStorage;
+    config.useOpenWorld = options->useOpenWorld;
+    config.speciesCount = options->speciesCount;
+    return config;
+}
+
+// Internal function that times the steps of one case, returns false if the flock couldn't be created
+static bool RunBenchCase(const struct BenchOptions *options, const struct FlockConfig *config,
+                         struct BenchResult *result) {
+    int steps = options->steps;
+    if (steps == 0) {
+        steps = (int)(BENCH_BOID_STEPS_PER_CASE / (double)config->numberOfBoids);
+        steps = steps < BENCH_MIN_STEPS ? BENCH_MIN_STEPS : steps;
+        steps = steps > BENCH_MAX_STEPS ? BENCH_MAX_STEPS : steps;
+    }
+
+    double *stepTimes = malloc(sizeof(double) * steps);
+    if (stepTimes == NULL) {
+        FlockLog(LOG_ERROR, "RunBenchCase: Failed to allocate memory for %d step times.", steps);
+        return false;
+    }
+
+    struct FlockState flockState;
+    if (!InitializeFlock(&flockState, *config)) {
+        free(stepTimes);
+        return false;
+    }
+
+    // Baking the obstacles isn't timed, only sampling them in each step
+    if (options->obstaclesCount > 0) {
+        struct FlockObstacle *obstacles = malloc(sizeof(struct FlockObstacle) * options->obstaclesCount);
+        if (obstacles != NULL) {
+            SpreadFlockObstacles(obstacles, options->obstaclesCount, config->flockBounds);
+        }
+        if (obstacles == NULL || !SetFlockObstacles(&flockState, obstacles, options->obstaclesCount)) {
+            FlockLog(LOG_ERROR, "RunBenchCase: Failed to add %d obstacles.", options->obstaclesCount);
+            free(obstacles);
+            free(stepTimes);
+            DestroyFlock(&flockState);
+            return false;
+        }
+        free(obstacles);
+    }
+
+    // Let the first allocations and page faults happen before timing
+    for (int step = 0; step < BENCH_WARMUP_STEPS; step++) {
+        UpdateFlock(&flockState, options->deltaTime);
+    }
+
+    double totalTime = 0.0;
+    for (int step = 0; step < steps; step++) {
+        const double startTime = GetMonotonicTime();
+        UpdateFlock(&flockState, options->deltaTime);
+        const double stepTime = GetMonotonicTime() - startTime;
+        totalTime += stepTime;
+        stepTimes[step] = (stepTime * 1e9) / (double)flockState.boidsCount;
+    }
+
+    DestroyFlock(&flockState);
+
+    qsort(stepTimes, steps, sizeof(double), CompareDoubles);
+    *result = (struct BenchResult){
+        .steps = steps,
+        .totalTime = totalTime,
+        .mean = (totalTime * 1e9) / ((double)steps * (double)config->numberOfBoids),
+        .minimum = stepTimes[0],
+        .p50 = GetPercentile(stepTimes, steps, 50.0),
+        .p90 = GetPercentile(stepTimes, steps, 90.0),
+        .p99 = GetPercentile(stepTimes, steps, 99.0),
+        .maximum = stepTimes[steps - 1],
+        .peakMemoryBytes = GetPeakMemoryUsage(),
+    };
+
+    free(stepTimes);
+    return true;
+}
+
+// Internal function that writes one case as a JSON object
+static void WriteBenchCase(FILE *output, const struct FlockConfig *config, const struct BenchRanges *ranges,
+                           const struct BenchRules *rules, const struct BenchResult *result, const bool isFirst) {
+    char quadtree[64] = "null";
+    if (config->useQuadtree) {
+        snprintf(quadtree, sizeof(quadtree), "{\"openingAngle\": %g}", config->quadtreeOpeningAngle);
+    }
+    char neighbourLists[64] = "null";
+    if (config->useNeighbourLists) {
+        snprintf(neighbourLists, sizeof(neighbourLists), "{\"skin\": %g}", config->neighbourListSkin);
+    }
+
+    fprintf(output,
+            "%s\n    {\n"
+            "      \"name\": \"boids=%d/ranges=%s/rules=%s\",\n"
+            "      \"boids\": %d,\n"
+            "      \"bounds\": [%.1f, %.1f],\n"
+            "      \"ranges\": {\"preset\": \"%s\", \"separation\": %g, \"alignment\": %g, \"cohesion\": %g},\n"
+            "      \"rules\": {\"preset\": \"%s\", \"separation\": %s, \"alignment\": %s, \"cohesion\": %s},\n"
+            "      \"quadtree\": %s,\n"
+            "      \"neighbourLists\": %s,\n"
+            "      \"steps\": %d,\n"
+            "      \"totalSeconds\": %.6f,\n"
+            "      \"nsPerBoidStep\": {\"mean\": %.3f, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, "
+            "\"max\": %.3f},\n"
+            "      \"peakRssBytes\": %lld\n"
+            "    }",
+            isFirst ? "" : ",", config->numberOfBoids, ranges->name, rules->name, config->numberOfBoids,
+            config->flockBounds.width, config->flockBounds.height, ranges->name, config->separationRange,
+            config->alignmentRange, config->cohesionRange, rules->name, rules->separation ? "true" : "false",
+            rules->alignment ? "true" : "false", rules->cohesion ? "true" : "false",
+            quadtree, neighbourLists, result->steps, result->totalTime,
+            result->mean, result->minimum, result->p50, result->p90, result->p99, result->maximum,
+            result->peakMemoryBytes);
+}
+
+// Times UpdateFlock over a sweep of boid counts, ranges and rules and writes the results as JSON. Progress is logged to
+// stderr so the JSON on stdout can be redirected to a file and compared between commits.
+int main(int argc, char *argv[]) {
+    struct BenchOptions options;
+    int exitCode = EXIT_SUCCESS;
+    if (!ParseOptions(argc, argv, &options, &exitCode)) {
+        return exitCode;
+    }
+
+    FILE *output = stdout;
+    if (options.outputPath != NULL) {
+        output = fopen(options.outputPath, "w");
+        if (output == NULL) {
+            FlockLog(LOG_FATAL, "Failed to open %s for writing.", options.outputPath);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Peak RSS only ever goes up, so run the cases from the smallest flock to the largest
+    qsort(options.boidCounts, options.boidCountsCount, sizeof(int), CompareInts);
+
+#ifdef DEBUG
+    const char *debugTools = "true";
+#else
+    const char *debugTools = "false";
+#endif /* ifdef DEBUG */
+    fprintf(output,
+            "{\n"
+            "  \"steeringKernel\": \"%s\",\n"
+            "  \"threads\": %d,\n"
+            "  \"steeringInterval\": %d,\n"
+            "  \"sortInterval\": %d,\n"
+            "  \"compactStorage\": %s,\n"
+            "  \"openWorld\": %s,\n"
+            "  \"species\": %d,\n"
+            "  \"obstacles\": %d,\n"
+            "  \"seed\": %u,\n"
+            "  \"deltaTime\": %g,\n"
+            "  \"debugTools\": %s,\n"
+            "  \"cases\": [",
+            GetSteeringKernelName(GetSteeringKernel()), options.threadCount, options.steeringInterval,
+            options.sortInterval, options.useCompactStorage ? "true" : "false",
+            options.useOpenWorld ? "true" : "false", options.speciesCount,
+            options.obstaclesCount, options.seed, options.deltaTime, debugTools);
+
+    bool isFirst = true;
+    for (int countIndex = 0; countIndex < options.boidCountsCount; countIndex++) {
+        for (int rangesIndex = 0; rangesIndex < BENCH_RANGES_COUNT; rangesIndex++) {
+            const struct BenchRanges *ranges = &benchRanges[rangesIndex];
+            if (!ListContains(options.ranges, ranges->name)) {
+                continue;
+            }
+            for (int rulesIndex = 0; rulesIndex < BENCH_RULES_COUNT; rulesIndex++) {
+                const struct BenchRules *rules = &benchRules[rulesIndex];
+                if (!ListContains(options.rules, rules->name)) {
+                    continue;
+                }
+
+                const struct FlockConfig config =
+                    CreateBenchFlockConfig(&options, options.boidCounts[countIndex], ranges, rules);
+                FlockLog(LOG_INFO, "Running boids=%d/ranges=%s/rules=%s", config.numberOfBoids, ranges->name,
+                         rules->name);
+
+                struct BenchResult result;
+                if (!RunBenchCase(&options, &config, &result)) {
+                    FlockLog(LOG_ERROR, "Failed to run boids=%d/ranges=%s/rules=%s", config.numberOfBoids,
+                             ranges->name, rules->name);
+                    exitCode = EXIT_FAILURE;
+                    continue;
+                }
+                FlockLog(LOG_INFO, "  %d steps, %.1f ns/boid/step (p99 %.1f)", result.steps, result.mean, result.p99);
+
+                WriteBenchCase(output, &config, ranges, rules, &result, isFirst);
+                isFirst = false;
+            }
+        }
+    }
+
+    fprintf(output, "\n  ]\n}\n");
+    if (output != stdout) {
+        fclose(output);
+    }
+
+    if (isFirst) {
+        FlockLog(LOG_ERROR, "No cases were run, check the --ranges and --rules presets.");
+        return EXIT_FAILURE;
+    }
+    return exitCode;
+}
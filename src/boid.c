@@ -3,8 +3,17 @@
 #include <raylib.h>
 #include <raymath.h>
 
-void DrawBoid(const Boid *boid) {
-    const Vector2 forwardVector = Vector2Normalize(boid->velocity);
+#define BOID_SPECIES_COLORS_COUNT 4
+
+Color GetBoidSpeciesColor(const int species) {
+    // The first species keeps the colour boids had before there were species
+    const Color speciesColors[BOID_SPECIES_COLORS_COUNT] = {BLUE, ORANGE, LIME, PURPLE};
+    const int colorIndex = species % BOID_SPECIES_COLORS_COUNT;
+    return speciesColors[colorIndex < 0 ? colorIndex + BOID_SPECIES_COLORS_COUNT : colorIndex];
+}
+
+void DrawBoid(const Vector2 position, const Vector2 velocity, const int species) {
+    const Vector2 forwardVector = Vector2Normalize(velocity);
     Vector2 perpRight = (Vector2){.x = forwardVector.y, .y = -forwardVector.x};
     Vector2 perpLeft = (Vector2){.x = -forwardVector.y, .y = forwardVector.x};
     Vector2 vertex1 = Vector2Scale(forwardVector, BOID_LENGTH / 2.F);
@@ -12,9 +21,9 @@ void DrawBoid(const Boid *boid) {
     Vector2 vertex3 = Vector2Add(Vector2Negate(vertex1), Vector2Scale(perpLeft, BOID_WIDTH / 2.F));
 
     // Transform vertices from local space to world space
-    vertex1 = Vector2Add(vertex1, boid->position);
-    vertex2 = Vector2Add(vertex2, boid->position);
-    vertex3 = Vector2Add(vertex3, boid->position);
+    vertex1 = Vector2Add(vertex1, position);
+    vertex2 = Vector2Add(vertex2, position);
+    vertex3 = Vector2Add(vertex3, position);
 
-    DrawTriangle(vertex1, vertex2, vertex3, BLUE);
+    DrawTriangle(vertex1, vertex2, vertex3, GetBoidSpeciesColor(species));
 }
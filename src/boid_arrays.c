@@ -0,0 +1,159 @@
+#include "boid.h"
+
+#include "arena.h"
+#include "flock_log.h"
+
+#include <math.h>
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif /* ifdef _WIN32 */
+
+bool AllocateBoidArrays(struct BoidArrays *arrays, const int capacity) {
+    if (arrays == NULL) {
+        FlockLog(LOG_ERROR, "AllocateBoidArrays: Recieved NULL pointer to arrays.");
+        return false;
+    }
+
+    // Round each array up to a whole number of cache lines so that every array starts on a cache line
+    size_t arraySize = sizeof(float) * (size_t)(capacity > 0 ? capacity : 1);
+    arraySize = (arraySize + BOID_ARRAYS_ALIGNMENT - 1) & ~(size_t)(BOID_ARRAYS_ALIGNMENT - 1);
+
+    void *memory = NULL;
+#ifdef _WIN32
+    memory = _aligned_malloc(arraySize * 4, BOID_ARRAYS_ALIGNMENT);
+#else
+    if (posix_memalign(&memory, BOID_ARRAYS_ALIGNMENT, arraySize * 4) != 0) {
+        memory = NULL;
+    }
+#endif /* ifdef _WIN32 */
+    if (memory == NULL) {
+        FlockLog(LOG_ERROR, "AllocateBoidArrays: Failed to allocate memory for %d boids.", capacity);
+        *arrays = (struct BoidArrays){0};
+        return false;
+    }
+
+    char *block = memory;
+    *arrays = (struct BoidArrays){
+        .positionsX = (float *)block,
+        .positionsY = (float *)(block + arraySize),
+        .velocitiesX = (float *)(block + (arraySize * 2)),
+        .velocitiesY = (float *)(block + (arraySize * 3)),
+    };
+
+    return true;
+}
+
+bool ResizeBoidArrays(struct BoidArrays *arrays, const int boidsCount, const int newCapacity) {
+    if (arrays == NULL) {
+        FlockLog(LOG_ERROR, "ResizeBoidArrays: Recieved NULL pointer to arrays.");
+        return false;
+    }
+    if (boidsCount > newCapacity) {
+        FlockLog(LOG_ERROR, "ResizeBoidArrays: %d boids don't fit in a capacity of %d.", boidsCount, newCapacity);
+        return false;
+    }
+
+    struct BoidArrays resizedArrays;
+    if (!AllocateBoidArrays(&resizedArrays, newCapacity)) {
+        return false;
+    }
+
+    if (boidsCount > 0) {
+        const size_t copySize = sizeof(float) * (size_t)boidsCount;
+        memcpy(resizedArrays.positionsX, arrays->positionsX, copySize);
+        memcpy(resizedArrays.positionsY, arrays->positionsY, copySize);
+        memcpy(resizedArrays.velocitiesX, arrays->velocitiesX, copySize);
+        memcpy(resizedArrays.velocitiesY, arrays->velocitiesY, copySize);
+    }
+
+    FreeBoidArrays(arrays);
+    *arrays = resizedArrays;
+
+    return true;
+}
+
+void FreeBoidArrays(struct BoidArrays *arrays) {
+    if (arrays == NULL) {
+        FlockLog(LOG_ERROR, "FreeBoidArrays: Recieved NULL pointer to arrays.");
+        return;
+    }
+
+    // The other arrays are part of the same block
+    if (arrays->positionsX != NULL) {
+#ifdef _WIN32
+        _aligned_free(arrays->positionsX);
+#else
+        free(arrays->positionsX);
+#endif /* ifdef _WIN32 */
+    }
+
+    *arrays = (struct BoidArrays){0};
+}
+
+size_t GetBoidArraysArenaSize(const int capacity) {
+    return GetArenaAllocationSize(sizeof(float) * (size_t)(capacity > 0 ? capacity : 1)) * 4;
+}
+
+bool AllocateBoidArraysFromArena(struct BoidArrays *arrays, struct Arena *arena, const int capacity) {
+    if (arrays == NULL || arena == NULL) {
+        FlockLog(LOG_ERROR, "AllocateBoidArraysFromArena: Recieved NULL pointer.");
+        return false;
+    }
+
+    const size_t arraySize = sizeof(float) * (size_t)(capacity > 0 ? capacity : 1);
+    *arrays = (struct BoidArrays){
+        .positionsX = AllocateFromArena(arena, arraySize),
+        .positionsY = AllocateFromArena(arena, arraySize),
+        .velocitiesX = AllocateFromArena(arena, arraySize),
+        .velocitiesY = AllocateFromArena(arena, arraySize),
+    };
+    if (arrays->positionsX == NULL || arrays->positionsY == NULL || arrays->velocitiesX == NULL ||
+        arrays->velocitiesY == NULL) {
+        FlockLog(LOG_ERROR, "AllocateBoidArraysFromArena: The arena has no room for %d boids.", capacity);
+        *arrays = (struct BoidArrays){0};
+        return false;
+    }
+
+    return true;
+}
+
+void OverlayCompactBoidArrays(struct CompactBoidArrays *compactArrays, const struct BoidArrays *arrays,
+                              const int capacity) {
+    if (compactArrays == NULL || arrays == NULL) {
+        FlockLog(LOG_ERROR, "OverlayCompactBoidArrays: Recieved NULL pointer.");
+        return;
+    }
+
+    // Each float array holds two compact arrays
+    *compactArrays = (struct CompactBoidArrays){
+        .positionsX = (uint16_t *)arrays->positionsX,
+        .positionsY = (uint16_t *)arrays->positionsX + capacity,
+        .velocitiesX = (uint16_t *)arrays->positionsY,
+        .velocitiesY = (uint16_t *)arrays->positionsY + capacity,
+    };
+}
+
+Rectangle GetBoidArraysExtent(const struct BoidArrays *arrays, const int boidsCount) {
+    if (arrays == NULL || boidsCount <= 0) {
+        return (Rectangle){0};
+    }
+
+    float minimumX = arrays->positionsX[0];
+    float minimumY = arrays->positionsY[0];
+    float maximumX = minimumX;
+    float maximumY = minimumY;
+    for (int i = 1; i < boidsCount; i++) {
+        minimumX = fminf(minimumX, arrays->positionsX[i]);
+        minimumY = fminf(minimumY, arrays->positionsY[i]);
+        maximumX = fmaxf(maximumX, arrays->positionsX[i]);
+        maximumY = fmaxf(maximumY, arrays->positionsY[i]);
+    }
+
+    return (Rectangle){.x = minimumX, .y = minimumY, .width = maximumX - minimumX, .height = maximumY - minimumY};
+}
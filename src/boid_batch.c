@@ -0,0 +1,255 @@
+#include "boid_batch.h"
+
+#include "boid.h"
+
+#include <math.h>
+#include <raylib.h>
+#include <raymath.h>
+#include <rlgl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BOID_BATCH_MIN_CAPACITY 1024
+// Boids shorter than this many pixels on screen are drawn as pixels
+#define BOID_BATCH_MIN_DETAILED_LENGTH 4.F
+// Size of the triangle that covers a pixel, in pixels
+#define BOID_BATCH_PIXEL_SIZE 1.5F
+
+// Internal function that sets the colour of the three vertices of the boid's triangle
+static inline void WriteBoidColor(unsigned char *colors, const int boidSlot, const Color color) {
+    for (int vertex = boidSlot * 3; vertex < (boidSlot * 3) + 3; vertex++) {
+        colors[(vertex * 4) + 0] = color.r;
+        colors[(vertex * 4) + 1] = color.g;
+        colors[(vertex * 4) + 2] = color.b;
+        colors[(vertex * 4) + 3] = color.a;
+    }
+}
+
+// Internal function that creates and uploads the mesh buffers for the given number of boids
+static bool LoadBoidBatchMesh(struct BoidBatch *batch, const int capacity) {
+    const int vertexCount = capacity * 3;
+    batch->mesh = (Mesh){
+        .vertexCount = vertexCount,
+        .triangleCount = capacity,
+        .vertices = MemAlloc(sizeof(float) * 3 * vertexCount),
+        .colors = MemAlloc(sizeof(unsigned char) * 4 * vertexCount),
+    };
+    if (batch->mesh.vertices == NULL || batch->mesh.colors == NULL) {
+        TraceLog(LOG_ERROR, "LoadBoidBatchMesh: Failed to allocate memory for %d boids.", capacity);
+        MemFree(batch->mesh.vertices);
+        MemFree(batch->mesh.colors);
+        batch->mesh = (Mesh){0};
+        return false;
+    }
+
+    // With a single species the colours don't change so they are only uploaded once
+    const Color color = GetBoidSpeciesColor(0);
+    for (int i = 0; i < capacity; i++) {
+        WriteBoidColor(batch->mesh.colors, i, color);
+    }
+
+    // The vertices are rewritten every frame
+    UploadMesh(&batch->mesh, true);
+    batch->capacity = capacity;
+    batch->hasSpeciesColors = false;
+
+    return true;
+}
+
+bool InitializeBoidBatch(struct BoidBatch *batch, int capacity) {
+    if (batch == NULL) {
+        TraceLog(LOG_ERROR, "InitializeBoidBatch: Recieved NULL pointer to batch.");
+        return false;
+    }
+
+    *batch = (struct BoidBatch){0};
+    if (capacity < BOID_BATCH_MIN_CAPACITY) {
+        capacity = BOID_BATCH_MIN_CAPACITY;
+    }
+
+    if (!LoadBoidBatchMesh(batch, capacity)) {
+        TraceLog(LOG_ERROR, "InitializeBoidBatch: Failed to create the mesh for %d boids.", capacity);
+        return false;
+    }
+    batch->material = LoadMaterialDefault();
+
+    return true;
+}
+
+// Internal function that grows the mesh to fit the given number of boids, returns false if it couldn't
+static bool ReserveBoidBatch(struct BoidBatch *batch, const int boidsCount) {
+    if (boidsCount <= batch->capacity) {
+        return true;
+    }
+
+    int capacity = batch->capacity * 2;
+    if (capacity < boidsCount) {
+        capacity = boidsCount;
+    }
+
+    // UnloadMesh also frees the CPU copies of the buffers
+    UnloadMesh(batch->mesh);
+    batch->capacity = 0;
+    return LoadBoidBatchMesh(batch, capacity);
+}
+
+// Internal function that writes the triangles of the boids in view pointing along their velocities, along with their
+// species' colours when boidSpecies isn't NULL. Returns the number of boids written.
+static int WriteDetailedBoids(float *vertices, unsigned char *colors, const struct BoidArrays *boids,
+                              const uint8_t *boidSpecies, const int boidsCount, const float timeOffset,
+                              const Rectangle view) {
+    int drawnCount = 0;
+    for (int i = 0; i < boidsCount; i++) {
+        const float velocityX = boids->velocitiesX[i];
+        const float velocityY = boids->velocitiesY[i];
+        const float positionX = boids->positionsX[i] + (velocityX * timeOffset);
+        const float positionY = boids->positionsY[i] + (velocityY * timeOffset);
+        if (positionX < view.x || positionX > view.x + view.width || positionY < view.y ||
+            positionY > view.y + view.height) {
+            continue;
+        }
+
+        const float speed = sqrtf((velocityX * velocityX) + (velocityY * velocityY));
+        const float inverseSpeed = speed > 0.F ? 1.F / speed : 0.F;
+        const float forwardX = velocityX * inverseSpeed;
+        const float forwardY = velocityY * inverseSpeed;
+
+        const float noseX = forwardX * (BOID_LENGTH / 2.F);
+        const float noseY = forwardY * (BOID_LENGTH / 2.F);
+        const float sideX = forwardY * (BOID_WIDTH / 2.F);
+        const float sideY = -forwardX * (BOID_WIDTH / 2.F);
+
+        float *triangle = &vertices[drawnCount * 9];
+        triangle[0] = positionX + noseX;
+        triangle[1] = positionY + noseY;
+        triangle[2] = 0.F;
+        triangle[3] = positionX - noseX + sideX;
+        triangle[4] = positionY - noseY + sideY;
+        triangle[5] = 0.F;
+        triangle[6] = positionX - noseX - sideX;
+        triangle[7] = positionY - noseY - sideY;
+        triangle[8] = 0.F;
+        if (boidSpecies != NULL) {
+            WriteBoidColor(colors, drawnCount, GetBoidSpeciesColor(boidSpecies[i]));
+        }
+        drawnCount++;
+    }
+
+    return drawnCount;
+}
+
+// Internal function that writes a triangle covering about a pixel for each boid in view, along with their species'
+// colours when boidSpecies isn't NULL. Returns the number of boids written.
+static int WritePixelBoids(float *vertices, unsigned char *colors, const struct BoidArrays *boids,
+                           const uint8_t *boidSpecies, const int boidsCount, const float timeOffset,
+                           const Rectangle view, const float pixelSize) {
+    int drawnCount = 0;
+    for (int i = 0; i < boidsCount; i++) {
+        const float positionX = boids->positionsX[i] + (boids->velocitiesX[i] * timeOffset);
+        const float positionY = boids->positionsY[i] + (boids->velocitiesY[i] * timeOffset);
+        if (positionX < view.x || positionX > view.x + view.width || positionY < view.y ||
+            positionY > view.y + view.height) {
+            continue;
+        }
+
+        float *triangle = &vertices[drawnCount * 9];
+        triangle[0] = positionX;
+        triangle[1] = positionY;
+        triangle[2] = 0.F;
+        triangle[3] = positionX + pixelSize;
+        triangle[4] = positionY;
+        triangle[5] = 0.F;
+        triangle[6] = positionX;
+        triangle[7] = positionY + pixelSize;
+        triangle[8] = 0.F;
+        if (boidSpecies != NULL) {
+            WriteBoidColor(colors, drawnCount, GetBoidSpeciesColor(boidSpecies[i]));
+        }
+        drawnCount++;
+    }
+
+    return drawnCount;
+}
+
+void DrawBoidBatch(struct BoidBatch *batch, const struct BoidArrays *boids, const uint8_t *boidSpecies,
+                   const int boidsCount, const float timeOffset, Rectangle view, const float zoom) {
+    if (batch == NULL || boids == NULL) {
+        TraceLog(LOG_ERROR, "DrawBoidBatch: Recieved NULL pointer.");
+        return;
+    }
+    if (boidsCount <= 0 || zoom <= 0.F) {
+        return;
+    }
+    if (!ReserveBoidBatch(batch, boidsCount)) {
+        TraceLog(LOG_ERROR, "DrawBoidBatch: Failed to grow the batch to %d boids.", boidsCount);
+        return;
+    }
+
+    // The view is grown by a boid's length so boids partly on screen are still drawn
+    view.x -= BOID_LENGTH;
+    view.y -= BOID_LENGTH;
+    view.width += BOID_LENGTH * 2.F;
+    view.height += BOID_LENGTH * 2.F;
+
+    // Only the boids in view are written, so the cost follows the number of boids on screen
+    float *vertices = batch->mesh.vertices;
+    unsigned char *colors = batch->mesh.colors;
+    const int drawnCount =
+        BOID_LENGTH * zoom >= BOID_BATCH_MIN_DETAILED_LENGTH
+            ? WriteDetailedBoids(vertices, colors, boids, boidSpecies, boidsCount, timeOffset, view)
+            : WritePixelBoids(vertices, colors, boids, boidSpecies, boidsCount, timeOffset, view,
+                              BOID_BATCH_PIXEL_SIZE / zoom);
+
+    // Species colours move around along with the boids in view, so they have to be uploaded every frame. Once there
+    // is only one species again the colours go back to the first species' and stop changing.
+    if (boidSpecies != NULL) {
+        batch->hasSpeciesColors = true;
+    } else if (batch->hasSpeciesColors) {
+        const Color color = GetBoidSpeciesColor(0);
+        for (int i = 0; i < batch->capacity; i++) {
+            WriteBoidColor(colors, i, color);
+        }
+        UpdateMeshBuffer(batch->mesh, RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR, colors,
+                         (int)(sizeof(unsigned char) * 12 * (size_t)batch->capacity), 0);
+        batch->hasSpeciesColors = false;
+    }
+    if (drawnCount == 0) {
+        return;
+    }
+
+    UpdateMeshBuffer(batch->mesh, RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, vertices,
+                     (int)(sizeof(float) * 9 * (size_t)drawnCount), 0);
+    if (boidSpecies != NULL) {
+        UpdateMeshBuffer(batch->mesh, RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR, colors,
+                         (int)(sizeof(unsigned char) * 12 * (size_t)drawnCount), 0);
+    }
+
+    // Only draw the boids that were written this frame
+    Mesh mesh = batch->mesh;
+    mesh.vertexCount = drawnCount * 3;
+    mesh.triangleCount = drawnCount;
+
+    // Anything already queued in raylib's batch has to be drawn first to keep the draw order. Culling is turned off so
+    // the triangles are drawn whatever their winding ends up as in screen space.
+    rlDrawRenderBatchActive();
+    rlDisableBackfaceCulling();
+    DrawMesh(mesh, batch->material, MatrixIdentity());
+    rlEnableBackfaceCulling();
+}
+
+void DestroyBoidBatch(struct BoidBatch *batch) {
+    if (batch == NULL) {
+        TraceLog(LOG_ERROR, "DestroyBoidBatch: Recieved NULL pointer to batch.");
+        return;
+    }
+
+    if (batch->capacity > 0) {
+        UnloadMesh(batch->mesh);
+    }
+    if (batch->material.maps != NULL) {
+        UnloadMaterial(batch->material);
+    }
+
+    *batch = (struct BoidBatch){0};
+}
@@ -0,0 +1,332 @@
+#include "checkpoint.h"
+
+#include "boid.h"
+#include "flock.h"
+#include "flock_log.h"
+#include "mapped_file.h"
+#include "obstacle_field.h"
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Internal function that rounds a size up to the checkpoint alignment
+static uint64_t AlignCheckpointSize(const uint64_t size) {
+    return (size + FLOCK_CHECKPOINT_ALIGNMENT - 1) & ~(uint64_t)(FLOCK_CHECKPOINT_ALIGNMENT - 1);
+}
+
+struct FlockCheckpointConfig CreateFlockCheckpointConfig(const struct FlockConfig *config) {
+    struct FlockCheckpointConfig checkpointConfig = {
+        .boundsX = config->flockBounds.x,
+        .boundsY = config->flockBounds.y,
+        .boundsWidth = config->flockBounds.width,
+        .boundsHeight = config->flockBounds.height,
+        .useOpenWorld = config->useOpenWorld ? 1 : 0,
+        .numberOfBoids = config->numberOfBoids,
+        .separationFactor = config->separationFactor,
+        .alignmentFactor = config->alignmentFactor,
+        .cohesionFactor = config->cohesionFactor,
+        .separationRange = config->separationRange,
+        .cohesionRange = config->cohesionRange,
+        .alignmentRange = config->alignmentRange,
+        .obstacleAvoidanceFactor = config->obstacleAvoidanceFactor,
+        .obstacleAvoidanceRange = config->obstacleAvoidanceRange,
+        .normalizeForces = config->normalizeForces ? 1 : 0,
+        .clampSpeed = config->clampSpeed ? 1 : 0,
+        .minimumSpeed = config->minimumSpeed,
+        .maximumSpeed = config->maximumSpeed,
+        .threadCount = config->threadCount,
+        .useQuadtree = config->useQuadtree ? 1 : 0,
+        .quadtreeOpeningAngle = config->quadtreeOpeningAngle,
+        .useNeighbourLists = config->useNeighbourLists ? 1 : 0,
+        .neighbourListSkin = config->neighbourListSkin,
+        .steeringInterval = config->steeringInterval,
+        .sortInterval = config->sortInterval,
+        .useCompactStorage = config->useCompactStorage ? 1 : 0,
+        .seed = config->seed,
+        .timeStep = config->timeStep,
+        .maxStepsPerFrame = config->maxStepsPerFrame,
+        .speciesCount = config->speciesCount,
+    };
+    for (int s = 0; s < FLOCK_MAX_SPECIES; s++) {
+        const struct FlockSpeciesConfig *species = &config->species[s];
+        checkpointConfig.speciesSpeedFactors[s] = species->speedFactor;
+        for (int other = 0; other < FLOCK_MAX_SPECIES; other++) {
+            checkpointConfig.speciesSeparationWeights[s][other] = species->separationWeights[other];
+            checkpointConfig.speciesAlignmentWeights[s][other] = species->alignmentWeights[other];
+            checkpointConfig.speciesCohesionWeights[s][other] = species->cohesionWeights[other];
+        }
+    }
+    return checkpointConfig;
+}
+
+struct FlockConfig ReadFlockCheckpointConfig(const struct FlockCheckpointConfig *checkpointConfig) {
+    const Rectangle bounds = {
+        .x = checkpointConfig->boundsX,
+        .y = checkpointConfig->boundsY,
+        .width = checkpointConfig->boundsWidth,
+        .height = checkpointConfig->boundsHeight,
+    };
+
+    // Start from the defaults so that fields the checkpoint doesn't store have sensible values
+    struct FlockConfig config = CreateDefaultFlockConfig(bounds);
+    config.numberOfBoids = checkpointConfig->numberOfBoids;
+    config.separationFactor = checkpointConfig->separationFactor;
+    config.alignmentFactor = checkpointConfig->alignmentFactor;
+    config.cohesionFactor = checkpointConfig->cohesionFactor;
+    config.separationRange = checkpointConfig->separationRange;
+    config.cohesionRange = checkpointConfig->cohesionRange;
+    config.alignmentRange = checkpointConfig->alignmentRange;
+    config.obstacleAvoidanceFactor = checkpointConfig->obstacleAvoidanceFactor;
+    config.obstacleAvoidanceRange = checkpointConfig->obstacleAvoidanceRange;
+    config.normalizeForces = checkpointConfig->normalizeForces != 0;
+    config.clampSpeed = checkpointConfig->clampSpeed != 0;
+    config.minimumSpeed = checkpointConfig->minimumSpeed;
+    config.maximumSpeed = checkpointConfig->maximumSpeed;
+    config.threadCount = checkpointConfig->threadCount;
+    config.useQuadtree = checkpointConfig->useQuadtree != 0;
+    config.quadtreeOpeningAngle = checkpointConfig->quadtreeOpeningAngle;
+    config.useNeighbourLists = checkpointConfig->useNeighbourLists != 0;
+    config.neighbourListSkin = checkpointConfig->neighbourListSkin;
+    config.steeringInterval = checkpointConfig->steeringInterval;
+    config.sortInterval = checkpointConfig->sortInterval;
+    config.useOpenWorld = checkpointConfig->useOpenWorld != 0;
+    config.useCompactStorage = checkpointConfig->useCompactStorage != 0;
+    config.seed = checkpointConfig->seed;
+    config.timeStep = checkpointConfig->timeStep;
+    config.maxStepsPerFrame = checkpointConfig->maxStepsPerFrame;
+    config.speciesCount = checkpointConfig->speciesCount;
+    for (int s = 0; s < FLOCK_MAX_SPECIES; s++) {
+        struct FlockSpeciesConfig *species = &config.species[s];
+        species->speedFactor = checkpointConfig->speciesSpeedFactors[s];
+        for (int other = 0; other < FLOCK_MAX_SPECIES; other++) {
+            species->separationWeights[other] = checkpointConfig->speciesSeparationWeights[s][other];
+            species->alignmentWeights[other] = checkpointConfig->speciesAlignmentWeights[s][other];
+            species->cohesionWeights[other] = checkpointConfig->speciesCohesionWeights[s][other];
+        }
+    }
+    return config;
+}
+
+bool SaveFlockCheckpoint(const struct FlockState *flockState, const char *path) {
+    if (flockState == NULL || path == NULL) {
+        FlockLog(LOG_ERROR, "SaveFlockCheckpoint: Recieved NULL pointer.");
+        return false;
+    }
+
+    const uint64_t boidsCount = (uint64_t)flockState->boidsCount;
+    const uint64_t arraysOffset = AlignCheckpointSize(sizeof(struct FlockCheckpointHeader));
+    const uint64_t arrayStride = AlignCheckpointSize(sizeof(float) * boidsCount);
+    const uint64_t obstaclesOffset = arraysOffset + (arrayStride * FLOCK_CHECKPOINT_ARRAYS_COUNT);
+    const uint64_t obstaclesCount = (uint64_t)flockState->obstaclesCount;
+    const uint64_t fileSize = obstaclesOffset + (sizeof(struct FlockCheckpointObstacle) * obstaclesCount);
+    if (fileSize > (uint64_t)SIZE_MAX) {
+        FlockLog(LOG_ERROR, "SaveFlockCheckpoint: A checkpoint of %d boids is too large to map.",
+                 flockState->boidsCount);
+        return false;
+    }
+
+    struct MappedFile file;
+    if (!CreateMappedFile(&file, path, (size_t)fileSize)) {
+        FlockLog(LOG_ERROR, "SaveFlockCheckpoint: Failed to create %s.", path);
+        return false;
+    }
+
+    struct FlockCheckpointHeader header = {
+        .version = FLOCK_CHECKPOINT_VERSION,
+        .byteOrderMark = FLOCK_CHECKPOINT_BYTE_ORDER_MARK,
+        .headerSize = sizeof(struct FlockCheckpointHeader),
+        .fileSize = fileSize,
+        .config = CreateFlockCheckpointConfig(&flockState->config),
+        .stepsCount = flockState->clock.stepsCount,
+        .time = flockState->clock.time,
+        .droppedTime = flockState->clock.droppedTime,
+        .accumulator = flockState->clock.accumulator,
+        .boidsCount = (uint32_t)boidsCount,
+        .randomState = flockState->randomState,
+        .arraysOffset = arraysOffset,
+        .arrayStride = arrayStride,
+        .obstaclesCount = (uint32_t)obstaclesCount,
+        .obstaclesOffset = obstaclesOffset,
+    };
+    memcpy(header.magic, FLOCK_CHECKPOINT_MAGIC, sizeof(header.magic));
+
+    // The file is zero filled when it is created, so the padding between the arrays is already cleared
+    unsigned char *data = file.data;
+    memcpy(data, &header, sizeof(header));
+    // Written in memory order with the IDs alongside, so the loaded flock is in the same order as this one
+    const void *arrays[FLOCK_CHECKPOINT_ARRAYS_COUNT] = {
+        flockState->boids.positionsX,
+        flockState->boids.positionsY,
+        flockState->boids.velocitiesX,
+        flockState->boids.velocitiesY,
+        flockState->boidIds,
+    };
+    for (int array = 0; array < FLOCK_CHECKPOINT_ARRAYS_COUNT; array++) {
+        memcpy(data + arraysOffset + (arrayStride * (uint64_t)array), arrays[array], sizeof(float) * boidsCount);
+    }
+
+    struct FlockCheckpointObstacle *savedObstacles = (struct FlockCheckpointObstacle *)(data + obstaclesOffset);
+    for (uint64_t i = 0; i < obstaclesCount; i++) {
+        const struct FlockObstacle *obstacle = &flockState->obstacles[i];
+        savedObstacles[i] = (struct FlockCheckpointObstacle){
+            .shape = (uint32_t)obstacle->shape,
+            .centerX = obstacle->center.x,
+            .centerY = obstacle->center.y,
+            .radius = obstacle->radius,
+            .rectangleX = obstacle->rectangle.x,
+            .rectangleY = obstacle->rectangle.y,
+            .rectangleWidth = obstacle->rectangle.width,
+            .rectangleHeight = obstacle->rectangle.height,
+        };
+    }
+
+    CloseMappedFile(&file);
+    return true;
+}
+
+// Internal function that checks that the mapped file is a checkpoint this version can read
+static bool ValidateCheckpointHeader(const struct MappedFile *file, const struct FlockCheckpointHeader *header,
+                                     const char *path) {
+    if (file->size < sizeof(struct FlockCheckpointHeader) ||
+        memcmp(header->magic, FLOCK_CHECKPOINT_MAGIC, sizeof(header->magic)) != 0) {
+        FlockLog(LOG_ERROR, "InitializeFlockFromCheckpoint: %s is not a flock checkpoint.", path);
+        return false;
+    }
+    if (header->byteOrderMark != FLOCK_CHECKPOINT_BYTE_ORDER_MARK) {
+        FlockLog(LOG_ERROR, "InitializeFlockFromCheckpoint: %s was written on a machine with a different byte order.",
+                 path);
+        return false;
+    }
+    if (header->version != FLOCK_CHECKPOINT_VERSION || header->headerSize != sizeof(struct FlockCheckpointHeader)) {
+        FlockLog(LOG_ERROR, "InitializeFlockFromCheckpoint: %s is version %u, only version %d is supported.", path,
+                 header->version, FLOCK_CHECKPOINT_VERSION);
+        return false;
+    }
+
+    // Make sure the arrays are where the header says and fit in the file, so a truncated file can't be read past its
+    // end
+    const uint64_t arraySize = sizeof(float) * (uint64_t)header->boidsCount;
+    if (header->fileSize != (uint64_t)file->size || header->boidsCount == 0 ||
+        header->boidsCount != (uint32_t)header->config.numberOfBoids || header->arrayStride < arraySize ||
+        header->arraysOffset < header->headerSize || header->arraysOffset % FLOCK_CHECKPOINT_ALIGNMENT != 0 ||
+        header->arrayStride % FLOCK_CHECKPOINT_ALIGNMENT != 0 ||
+        header->arraysOffset + (header->arrayStride * FLOCK_CHECKPOINT_ARRAYS_COUNT) > (uint64_t)file->size) {
+        FlockLog(LOG_ERROR, "InitializeFlockFromCheckpoint: %s is truncated or corrupt.", path);
+        return false;
+    }
+    const uint64_t obstaclesSize = sizeof(struct FlockCheckpointObstacle) * (uint64_t)header->obstaclesCount;
+    if (header->obstaclesCount > INT32_MAX ||
+        header->obstaclesOffset < header->arraysOffset + (header->arrayStride * FLOCK_CHECKPOINT_ARRAYS_COUNT) ||
+        header->obstaclesOffset % FLOCK_CHECKPOINT_ALIGNMENT != 0 ||
+        header->obstaclesOffset + obstaclesSize > (uint64_t)file->size) {
+        FlockLog(LOG_ERROR, "InitializeFlockFromCheckpoint: %s has truncated or corrupt obstacles.", path);
+        return false;
+    }
+    const struct FlockCheckpointObstacle *obstacles =
+        (const struct FlockCheckpointObstacle *)((const unsigned char *)file->data + header->obstaclesOffset);
+    for (uint32_t i = 0; i < header->obstaclesCount; i++) {
+        if (obstacles[i].shape > FLOCK_OBSTACLE_RECTANGLE) {
+            FlockLog(LOG_ERROR, "InitializeFlockFromCheckpoint: Obstacle %u of %s has an unknown shape, %u.", i, path,
+                     obstacles[i].shape);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool InitializeFlockFromCheckpoint(struct FlockState *flockState, const char *path) {
+    if (flockState == NULL || path == NULL) {
+        FlockLog(LOG_ERROR, "InitializeFlockFromCheckpoint: Recieved NULL pointer.");
+        return false;
+    }
+
+    struct MappedFile file;
+    if (!OpenMappedFile(&file, path)) {
+        FlockLog(LOG_ERROR, "InitializeFlockFromCheckpoint: Failed to open %s.", path);
+        return false;
+    }
+
+    // The header is copied out so that a file shorter than the header can still be checked
+    struct FlockCheckpointHeader header = {0};
+    memcpy(&header, file.data, file.size < sizeof(header) ? file.size : sizeof(header));
+    if (!ValidateCheckpointHeader(&file, &header, path)) {
+        CloseMappedFile(&file);
+        return false;
+    }
+
+    // The arrays are used in place from the mapping and copied into the flock's own arrays
+    unsigned char *data = file.data;
+    const struct BoidArrays savedBoids = {
+        .positionsX = (float *)(data + header.arraysOffset),
+        .positionsY = (float *)(data + header.arraysOffset + header.arrayStride),
+        .velocitiesX = (float *)(data + header.arraysOffset + (header.arrayStride * 2)),
+        .velocitiesY = (float *)(data + header.arraysOffset + (header.arrayStride * 3)),
+    };
+    const struct FlockConfig config = ReadFlockCheckpointConfig(&header.config);
+    if (!InitializeFlockFromBoids(flockState, config, &savedBoids)) {
+        FlockLog(LOG_ERROR, "InitializeFlockFromCheckpoint: Failed to initialise flock from %s.", path);
+        CloseMappedFile(&file);
+        return false;
+    }
+    const int *savedBoidIds = (const int *)(data + header.arraysOffset + (header.arrayStride * 4));
+    if (!SetFlockBoidIds(flockState, savedBoidIds)) {
+        FlockLog(LOG_ERROR, "InitializeFlockFromCheckpoint: %s has corrupt boid IDs.", path);
+        DestroyFlock(flockState);
+        CloseMappedFile(&file);
+        return false;
+    }
+
+    // The obstacles are converted one at a time and baked once they are all added
+    const struct FlockCheckpointObstacle *savedObstacles =
+        (const struct FlockCheckpointObstacle *)(data + header.obstaclesOffset);
+    const int obstaclesCount = (int)header.obstaclesCount;
+    struct FlockObstacle *obstacles = NULL;
+    if (obstaclesCount > 0) {
+        obstacles = malloc(sizeof(struct FlockObstacle) * (size_t)obstaclesCount);
+        if (obstacles == NULL) {
+            FlockLog(LOG_ERROR, "InitializeFlockFromCheckpoint: Failed to allocate memory for %d obstacles.",
+                     obstaclesCount);
+            DestroyFlock(flockState);
+            CloseMappedFile(&file);
+            return false;
+        }
+    }
+    for (int i = 0; i < obstaclesCount; i++) {
+        const struct FlockCheckpointObstacle *savedObstacle = &savedObstacles[i];
+        obstacles[i] = (struct FlockObstacle){
+            .shape = (enum FlockObstacleShape)savedObstacle->shape,
+            .center = {.x = savedObstacle->centerX, .y = savedObstacle->centerY},
+            .radius = savedObstacle->radius,
+            .rectangle =
+                {
+                    .x = savedObstacle->rectangleX,
+                    .y = savedObstacle->rectangleY,
+                    .width = savedObstacle->rectangleWidth,
+                    .height = savedObstacle->rectangleHeight,
+                },
+        };
+    }
+    CloseMappedFile(&file);
+    const bool areObstaclesSet = SetFlockObstacles(flockState, obstacles, obstaclesCount);
+    free(obstacles);
+    if (!areObstaclesSet) {
+        FlockLog(LOG_ERROR, "InitializeFlockFromCheckpoint: Failed to restore the obstacles from %s.", path);
+        DestroyFlock(flockState);
+        return false;
+    }
+
+    flockState->randomState = header.randomState;
+    flockState->clock = (struct FlockClock){
+        .accumulator = header.accumulator,
+        .droppedTime = header.droppedTime,
+        .stepsCount = header.stepsCount,
+        .time = header.time,
+    };
+
+    return true;
+}
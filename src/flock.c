@@ -1,31 +1,86 @@
 #include "flock.h"
 
 #include "boid.h"
+#include "flock_log.h"
+#include "grid.h"
+#include "morton_sort.h"
+#include "neighbour_list.h"
+#include "obstacle_field.h"
+#include "profiler.h"
+#include "quadtree.h"
+#include "steering.h"
+#include "trace.h"
+#include "trajectory.h"
 
+#include <math.h>
 #include <raylib.h>
 #include <raymath.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef DEBUG
+// Boids closer than this are counted as colliding
+#define DEBUG_COLLISION_DISTANCE 5.F
+// Largest per boid element that is moved through the sort scratch buffer
+#define FLOCK_SORT_SCRATCH_ELEMENT_SIZE                                                                               \
+    (sizeof(struct Debug_BoidData) > sizeof(Vector2) ? sizeof(struct Debug_BoidData) : sizeof(Vector2))
+#else
+#define FLOCK_SORT_SCRATCH_ELEMENT_SIZE sizeof(Vector2)
+#endif /* ifdef DEBUG */
 
 struct FlockConfig CreateDefaultFlockConfig(const Rectangle flockBounds) {
-    return (struct FlockConfig){
+    // Every species keeps its distance from the others but only flocks with its own kind
+    struct FlockSpeciesConfig species[FLOCK_MAX_SPECIES];
+    for (int s = 0; s < FLOCK_MAX_SPECIES; s++) {
+        species[s].speedFactor = 1.F;
+        for (int other = 0; other < FLOCK_MAX_SPECIES; other++) {
+            species[s].separationWeights[other] = 1.F;
+            species[s].alignmentWeights[other] = other == s ? 1.F : 0.F;
+            species[s].cohesionWeights[other] = other == s ? 1.F : 0.F;
+        }
+    }
+
+    struct FlockConfig config = {
         .flockBounds = flockBounds,
+        .useOpenWorld = false,
         .numberOfBoids = 100,
 
         .separationFactor = 1.F,
         .alignmentFactor = 1.F,
         .cohesionFactor = 1.F,
+        .obstacleAvoidanceFactor = 2.F,
 
         .separationRange = 50.F,
         .alignmentRange = 100.F,
         .cohesionRange = 100.F,
+        .obstacleAvoidanceRange = 50.F,
 
         .normalizeForces = false,
 
         .clampSpeed = true,
         .minimumSpeed = 50.F,
         .maximumSpeed = 100.F,
+
+        .speciesCount = 1,
+
+        .threadCount = 1,
+        .useQuadtree = false,
+        .quadtreeOpeningAngle = 0.5F,
+        .useNeighbourLists = false,
+        .neighbourListSkin = 20.F,
+        .steeringInterval = 1,
+        .sortInterval = 16,
+        .useCompactStorage = false,
+
+        .seed = 0,
+
+        .timeStep = 1.F / 60.F,
+        .maxStepsPerFrame = 4,
     };
+    memcpy(config.species, species, sizeof(species));
+    return config;
 }
 
 enum FlockConfigValidationResult {
@@ -34,7 +89,14 @@ enum FlockConfigValidationResult {
     FLOCK_CONFIG_INVALID_BOID_COUNT,
     FLOCK_CONFIG_INVALID_BOUNDS,
     FLOCK_CONFIG_INVALID_SPEED_RANGE,
-    FLOCK_CONFIG_INVALID_RANGE
+    FLOCK_CONFIG_INVALID_RANGE,
+    FLOCK_CONFIG_INVALID_THREAD_COUNT,
+    FLOCK_CONFIG_INVALID_TIME_STEP,
+    FLOCK_CONFIG_INVALID_OPENING_ANGLE,
+    FLOCK_CONFIG_INVALID_NEIGHBOUR_LIST_SKIN,
+    FLOCK_CONFIG_INVALID_STEERING_INTERVAL,
+    FLOCK_CONFIG_INVALID_SORT_INTERVAL,
+    FLOCK_CONFIG_INVALID_SPECIES
 };
 
 // Internal function that returns a human-readable error message for a flock config validation result
@@ -52,6 +114,20 @@ static const char *FlockConfigValidationMessage(enum FlockConfigValidationResult
         return "speed range invalid: minimum must be <= maximum and both must be greater than 0";
     case FLOCK_CONFIG_INVALID_RANGE:
         return "force ranges must be non-negative";
+    case FLOCK_CONFIG_INVALID_THREAD_COUNT:
+        return "thread count must be between 1 and 256";
+    case FLOCK_CONFIG_INVALID_TIME_STEP:
+        return "time step must be greater than 0 and at least 1 step per frame must be allowed";
+    case FLOCK_CONFIG_INVALID_OPENING_ANGLE:
+        return "quadtree opening angle must be non-negative";
+    case FLOCK_CONFIG_INVALID_NEIGHBOUR_LIST_SKIN:
+        return "neighbour list skin must be non-negative";
+    case FLOCK_CONFIG_INVALID_STEERING_INTERVAL:
+        return "steering interval must be at least 1";
+    case FLOCK_CONFIG_INVALID_SORT_INTERVAL:
+        return "sort interval must be non-negative";
+    case FLOCK_CONFIG_INVALID_SPECIES:
+        return "number of species must be between 1 and 4 and species speed factors must be positive";
     default:
         return "unknown validation error";
     }
@@ -71,107 +147,387 @@ static enum FlockConfigValidationResult validateFlockConfig(const struct FlockCo
     if (config->clampSpeed && (config->minimumSpeed > config->maximumSpeed || config->minimumSpeed < 0.F)) {
         return FLOCK_CONFIG_INVALID_SPEED_RANGE;
     }
-    if (config->separationRange < 0.F || config->alignmentRange < 0.F || config->cohesionRange < 0.F) {
+    if (config->separationRange < 0.F || config->alignmentRange < 0.F || config->cohesionRange < 0.F ||
+        config->obstacleAvoidanceRange < 0.F) {
         return FLOCK_CONFIG_INVALID_RANGE;
     }
+    if (config->threadCount < 1 || config->threadCount > WORKER_POOL_MAX_THREADS) {
+        return FLOCK_CONFIG_INVALID_THREAD_COUNT;
+    }
+    if (config->timeStep <= 0.F || config->maxStepsPerFrame < 1) {
+        return FLOCK_CONFIG_INVALID_TIME_STEP;
+    }
+    if (!(config->quadtreeOpeningAngle >= 0.F)) {
+        return FLOCK_CONFIG_INVALID_OPENING_ANGLE;
+    }
+    if (!(config->neighbourListSkin >= 0.F)) {
+        return FLOCK_CONFIG_INVALID_NEIGHBOUR_LIST_SKIN;
+    }
+    if (config->steeringInterval < 1) {
+        return FLOCK_CONFIG_INVALID_STEERING_INTERVAL;
+    }
+    if (config->sortInterval < 0) {
+        return FLOCK_CONFIG_INVALID_SORT_INTERVAL;
+    }
+    if (config->speciesCount < 1 || config->speciesCount > FLOCK_MAX_SPECIES) {
+        return FLOCK_CONFIG_INVALID_SPECIES;
+    }
+    for (int s = 0; s < config->speciesCount; s++) {
+        if (!(config->species[s].speedFactor > 0.F)) {
+            return FLOCK_CONFIG_INVALID_SPECIES;
+        }
+    }
 
     // NOTE: Negative flock factors are not considered invalid.
 
     return FLOCK_CONFIG_VALID;
 }
 
-// Internal function to spawn a set number of boids at random positions in the given bounds.
-static Boid *SpawnBoids(const int numberOfBoids, const Rectangle spawnBounds, const float startSpeed) {
-    Boid *boids = malloc(sizeof(Boid) * numberOfBoids);
-    if (boids == NULL) {
-        TraceLog(LOG_ERROR, "SpawnBoids: Failed to allocate memory for %d boids.", numberOfBoids);
-        return NULL;
+// Internal function that seeds the flock's random number generator
+static uint64_t SeedRandom(const unsigned int seed) {
+    // Run the seed through one round of SplitMix64 so that nearby seeds give unrelated sequences
+    uint64_t state = (uint64_t)seed + 0x9E3779B97F4A7C15ULL;
+    state = (state ^ (state >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    state = (state ^ (state >> 27)) * 0x94D049BB133111EBULL;
+    return state ^ (state >> 31);
+}
+
+// Internal function that gets a random integer in [min, max] (inclusive, like raylib's GetRandomValue) and advances
+// the generator (PCG32).
+static int GetRandomInt(uint64_t *state, const int min, const int max) {
+    const uint64_t oldState = *state;
+    *state = (oldState * 6364136223846793005ULL) + 1442695040888963407ULL;
+    const uint32_t shifted = (uint32_t)(((oldState >> 18U) ^ oldState) >> 27U);
+    const uint32_t rotation = (uint32_t)(oldState >> 59U);
+    const uint32_t random = (shifted >> rotation) | (shifted << ((32U - rotation) & 31U));
+
+    if (max <= min) {
+        return min;
     }
-    for (int i = 0; i < numberOfBoids; i++) {
-        float x = (float)GetRandomValue((int)spawnBounds.x, (int)(spawnBounds.x + spawnBounds.width));
-        float y = (float)GetRandomValue((int)spawnBounds.y, (int)(spawnBounds.y + spawnBounds.height));
+    return min + (int)(random % ((uint32_t)(max - min) + 1U));
+}
+
+// Internal function to spawn the boids at [start, end) of the arrays at random positions in the given bounds.
+static void SpawnBoids(struct BoidArrays *boids, const int start, const int end, const Rectangle spawnBounds,
+                       const float startSpeed, uint64_t *randomState) {
+    for (int i = start; i < end; i++) {
+        float x = (float)GetRandomInt(randomState, (int)spawnBounds.x, (int)(spawnBounds.x + spawnBounds.width));
+        float y = (float)GetRandomInt(randomState, (int)spawnBounds.y, (int)(spawnBounds.y + spawnBounds.height));
         Vector2 randomDirection = (Vector2){
-            .x = (float)GetRandomValue(-100, 100),
-            .y = (float)GetRandomValue(-100, 100),
+            .x = (float)GetRandomInt(randomState, -100, 100),
+            .y = (float)GetRandomInt(randomState, -100, 100),
         };
 
-        boids[i] = (Boid){
-            .position = (Vector2){.x = x, .y = y},
-            .velocity = Vector2Scale(Vector2Normalize(randomDirection), startSpeed),
-        };
+        SetBoidInArrays(boids, i,
+                        (Boid){
+                            .position = (Vector2){.x = x, .y = y},
+                            .velocity = Vector2Scale(Vector2Normalize(randomDirection), startSpeed),
+                        });
     }
-    return boids;
 }
 
-bool InitializeFlock(struct FlockState *flockState, const struct FlockConfig config) {
-    enum FlockConfigValidationResult validationResult = validateFlockConfig(&config);
-    if (validationResult != FLOCK_CONFIG_VALID) {
-        TraceLog(LOG_ERROR, "InitializeFlock: Failed due to invalid flock config, %s.",
-                 FlockConfigValidationMessage(validationResult));
+// Internal function that gets the arena size for the per boid buffers of a flock with the given capacity
+static size_t GetFlockArenaSize(const int boidsCapacity) {
+    size_t size = GetBoidArraysArenaSize(boidsCapacity);
+    size += GetArenaAllocationSize(sizeof(Vector2) * (size_t)boidsCapacity);
+#ifdef DEBUG
+    size += GetArenaAllocationSize(sizeof(struct Debug_BoidData) * (size_t)boidsCapacity);
+#endif /* ifdef DEBUG */
+    size += GetArenaAllocationSize(sizeof(int) * (size_t)boidsCapacity) * 2;
+    size += GetArenaAllocationSize(sizeof(uint8_t) * (size_t)boidsCapacity);
+    size += GetMortonSortArenaSize(boidsCapacity);
+    size += GetArenaAllocationSize(FLOCK_SORT_SCRATCH_ELEMENT_SIZE * (size_t)boidsCapacity);
+    size += GetSpatialGridArenaSize(boidsCapacity);
+    return size;
+}
+
+// Per boid buffers of a flock, carved out of its arena
+struct FlockBuffers {
+    struct BoidArrays boids;
+    Vector2 *steeringForces;
+#ifdef DEBUG
+    struct Debug_BoidData *debug_boidData;
+#endif /* ifdef DEBUG */
+    int *boidIds;
+    int *boidIndices;
+    uint8_t *boidSpecies;
+    struct MortonSortBuffers sortBuffers;
+    void *sortScratch;
+    struct SpatialGrid grid;
+};
+
+// Internal function that reserves the arena for the given capacity and carves the buffers out of it. The arena's
+// previous contents are lost.
+static bool CarveFlockBuffers(struct Arena *arena, const int boidsCapacity, struct FlockBuffers *buffers) {
+    if (!ReserveArena(arena, GetFlockArenaSize(boidsCapacity))) {
         return false;
     }
 
-    Boid *boids =
-        SpawnBoids(config.numberOfBoids, config.flockBounds, (config.minimumSpeed + config.maximumSpeed) / 2.F);
-    if (boids == NULL) {
-        TraceLog(LOG_ERROR, "InitializeFlock: Failed to spawn boids.");
+    // The sizes match GetFlockArenaSize, so these only fail if the two get out of sync
+    if (!AllocateBoidArraysFromArena(&buffers->boids, arena, boidsCapacity)) {
         return false;
     }
-
-    // Pre-allocate memory for calculating the steering vectors
-    Vector2 *steeringVectors = malloc(sizeof(Vector2) * config.numberOfBoids);
-    if (steeringVectors == NULL) {
-        TraceLog(LOG_ERROR, "InitializeFlock: Failed to allocate memory for the steering vectors for %d boids.",
-                 config.numberOfBoids);
-        // Initialisation failed, clean up.
-        if (boids != NULL) {
-            free(boids);
-            boids = NULL;
-        }
+    buffers->steeringForces = AllocateFromArena(arena, sizeof(Vector2) * (size_t)boidsCapacity);
+    if (buffers->steeringForces == NULL) {
         return false;
     }
-
 #ifdef DEBUG
-    // Allocate memory for storing boid debug data
-    struct Debug_BoidData *debug_boidData = malloc(sizeof(struct Debug_BoidData) * config.numberOfBoids);
-    if (debug_boidData == NULL) {
-        TraceLog(LOG_ERROR, "InitializeFlock: Failed to allocate memory for the debug data for %d boids.",
-                 config.numberOfBoids);
-        // Initialisation failed, clean up.
-        if (boids != NULL) {
-            free(boids);
-            boids = NULL;
-        }
-        if (steeringVectors != NULL) {
-            free(steeringVectors);
-            steeringVectors = NULL;
-        }
+    buffers->debug_boidData = AllocateFromArena(arena, sizeof(struct Debug_BoidData) * (size_t)boidsCapacity);
+    if (buffers->debug_boidData == NULL) {
         return false;
     }
 #endif /* ifdef DEBUG */
+    buffers->boidIds = AllocateFromArena(arena, sizeof(int) * (size_t)boidsCapacity);
+    buffers->boidIndices = AllocateFromArena(arena, sizeof(int) * (size_t)boidsCapacity);
+    buffers->boidSpecies = AllocateFromArena(arena, sizeof(uint8_t) * (size_t)boidsCapacity);
+    buffers->sortScratch = AllocateFromArena(arena, FLOCK_SORT_SCRATCH_ELEMENT_SIZE * (size_t)boidsCapacity);
+    if (buffers->boidIds == NULL || buffers->boidIndices == NULL || buffers->boidSpecies == NULL ||
+        buffers->sortScratch == NULL || !InitializeMortonSortBuffers(&buffers->sortBuffers, arena, boidsCapacity)) {
+        return false;
+    }
+    return InitializeSpatialGridFromArena(&buffers->grid, arena, boidsCapacity);
+}
+
+// Internal function that sets the species of the boids at [start, end) from their IDs, so the species stay evenly
+// mixed however the flock is resized
+static void AssignFlockSpecies(struct FlockState *flockState, const int start, const int end) {
+    const int speciesCount = flockState->config.speciesCount;
+    for (int i = start; i < end; i++) {
+        flockState->boidSpecies[i] = (uint8_t)(flockState->boidIds[i] % speciesCount);
+    }
+}
+
+// Internal function that initialises the flock with copies of the given boids, or with randomly spawned boids when
+// initialBoids is NULL. The arena may already have memory from an earlier flock, it is reused if it is large enough.
+static bool CreateFlock(struct FlockState *flockState, const struct FlockConfig config,
+                        const struct BoidArrays *initialBoids, struct Arena arena) {
+    enum FlockConfigValidationResult validationResult = validateFlockConfig(&config);
+    if (validationResult != FLOCK_CONFIG_VALID) {
+        FlockLog(LOG_ERROR, "InitializeFlock: Failed due to invalid flock config, %s.",
+                 FlockConfigValidationMessage(validationResult));
+        FreeArena(&arena);
+        return false;
+    }
 
+    struct FlockBuffers buffers;
+    if (!CarveFlockBuffers(&arena, config.numberOfBoids, &buffers)) {
+        FlockLog(LOG_ERROR, "InitializeFlock: Failed to allocate memory for %d boids.", config.numberOfBoids);
+        FreeArena(&arena);
+        return false;
+    }
+
+    uint64_t randomState = SeedRandom(config.seed);
+    if (initialBoids != NULL) {
+        const size_t arraySize = sizeof(float) * (size_t)config.numberOfBoids;
+        memcpy(buffers.boids.positionsX, initialBoids->positionsX, arraySize);
+        memcpy(buffers.boids.positionsY, initialBoids->positionsY, arraySize);
+        memcpy(buffers.boids.velocitiesX, initialBoids->velocitiesX, arraySize);
+        memcpy(buffers.boids.velocitiesY, initialBoids->velocitiesY, arraySize);
+    } else {
+        SpawnBoids(&buffers.boids, 0, config.numberOfBoids, config.flockBounds,
+                   (config.minimumSpeed + config.maximumSpeed) / 2.F, &randomState);
+    }
+    for (int i = 0; i < config.numberOfBoids; i++) {
+        buffers.boidIds[i] = i;
+        buffers.boidIndices[i] = i;
+    }
+
+    const SteeringKernel steeringKernel = GetSteeringKernel();
     *flockState = (struct FlockState){
-        .boids = boids,
+        .arena = arena,
+        .boids = buffers.boids,
         .boidsCount = config.numberOfBoids,
-        .steeringForces = steeringVectors,
+        .boidsCapacity = config.numberOfBoids,
+        .steeringForces = buffers.steeringForces,
+        .steeringForcesCount = 0,
+        .boidIds = buffers.boidIds,
+        .boidIndices = buffers.boidIndices,
+        .boidSpecies = buffers.boidSpecies,
+        .sortBuffers = buffers.sortBuffers,
+        .sortScratch = buffers.sortScratch,
+        .grid = buffers.grid,
+        .quadtree = (struct FlockQuadtree){0},
+        .neighbourLists = (struct NeighbourLists){0},
+        .obstacles = NULL,
+        .obstaclesCount = 0,
+        .obstaclesCapacity = 0,
+        .obstacleField = (struct ObstacleField){0},
+        .steeringKernel = steeringKernel,
+        .steeringIndexedKernel = GetSteeringIndexedKernel(steeringKernel),
+        .compactSteeringKernel = GetCompactSteeringKernel(steeringKernel),
+        .randomState = randomState,
+        .clock = (struct FlockClock){0},
         .config = config,
+        .recorder = NULL,
 #ifdef DEBUG
-        .debug_boidData = debug_boidData,
+        .debug_boidData = buffers.debug_boidData,
 
         .isPaused = false,
         .doStep = false,
 
         .collisionTime = 0.F,
-        .collisionTimeStart = (float)GetTime(),
+        .collisionSampleTime = 0.F,
 #endif /* ifdef DEBUG */
     };
+    AssignFlockSpecies(flockState, 0, config.numberOfBoids);
+
+    // The workers keep a pointer to the pool so it is started in place
+    if (!InitializeWorkerPool(&flockState->workerPool, config.threadCount)) {
+        FlockLog(LOG_ERROR, "InitializeFlock: Failed to start %d threads.", config.threadCount);
+        DestroyFlock(flockState);
+        return false;
+    }
+
+    return true;
+}
+
+// Internal function that checks if two bounds are exactly the same
+static bool AreFlockBoundsEqual(const Rectangle bounds, const Rectangle otherBounds) {
+    return bounds.x == otherBounds.x && bounds.y == otherBounds.y && bounds.width == otherBounds.width &&
+           bounds.height == otherBounds.height;
+}
+
+// Internal function that gets the area the obstacle field is baked over. That is the bounds, but boids can leave the
+// bounds of an open world (and obstacles can be placed anywhere in it), so there it also covers each obstacle and the
+// range around it that boids steer away from. Boids outside the area are then out of range of every obstacle.
+static Rectangle GetFlockObstacleFieldBounds(const struct FlockState *flockState) {
+    const struct FlockConfig *config = &flockState->config;
+    if (!config->useOpenWorld) {
+        return config->flockBounds;
+    }
+
+    float minimumX = config->flockBounds.x;
+    float minimumY = config->flockBounds.y;
+    float maximumX = config->flockBounds.x + config->flockBounds.width;
+    float maximumY = config->flockBounds.y + config->flockBounds.height;
+    const float range = config->obstacleAvoidanceRange;
+    for (int i = 0; i < flockState->obstaclesCount; i++) {
+        const struct FlockObstacle *obstacle = &flockState->obstacles[i];
+        Rectangle area;
+        if (obstacle->shape == FLOCK_OBSTACLE_CIRCLE) {
+            area = (Rectangle){
+                .x = obstacle->center.x - obstacle->radius,
+                .y = obstacle->center.y - obstacle->radius,
+                .width = obstacle->radius * 2.F,
+                .height = obstacle->radius * 2.F,
+            };
+        } else {
+            // Rectangles can have a negative width or height
+            area = (Rectangle){
+                .x = fminf(obstacle->rectangle.x, obstacle->rectangle.x + obstacle->rectangle.width),
+                .y = fminf(obstacle->rectangle.y, obstacle->rectangle.y + obstacle->rectangle.height),
+                .width = fabsf(obstacle->rectangle.width),
+                .height = fabsf(obstacle->rectangle.height),
+            };
+        }
+        minimumX = fminf(minimumX, area.x - range);
+        minimumY = fminf(minimumY, area.y - range);
+        maximumX = fmaxf(maximumX, area.x + area.width + range);
+        maximumY = fmaxf(maximumY, area.y + area.height + range);
+    }
+
+    return (Rectangle){.x = minimumX, .y = minimumY, .width = maximumX - minimumX, .height = maximumY - minimumY};
+}
 
+// Internal function that bakes the flock's obstacles into its obstacle field (see GetFlockObstacleFieldBounds). If the
+// field can't be allocated the flock is left without obstacles.
+static bool BakeFlockObstacles(struct FlockState *flockState) {
+    if (!BakeObstacleField(&flockState->obstacleField, flockState->obstacles, flockState->obstaclesCount,
+                           GetFlockObstacleFieldBounds(flockState))) {
+        flockState->obstaclesCount = 0;
+        return false;
+    }
+    return true;
+}
+
+bool InitializeFlock(struct FlockState *flockState, const struct FlockConfig config) {
+    return CreateFlock(flockState, config, NULL, (struct Arena){0});
+}
+
+bool ResetFlock(struct FlockState *flockState, const struct FlockConfig config) {
+    if (flockState == NULL) {
+        FlockLog(LOG_ERROR, "ResetFlock: Recieved NULL pointer to flockState.");
+        return false;
+    }
+
+    // The arena is taken out of the flock before it is destroyed so the new flock can carve its buffers out of it, and
+    // the obstacles so the new flock keeps them
+    const struct Arena arena = flockState->arena;
+    struct FlockObstacle *obstacles = flockState->obstacles;
+    const int obstaclesCount = flockState->obstaclesCount;
+    const int obstaclesCapacity = flockState->obstaclesCapacity;
+    struct ObstacleField obstacleField = flockState->obstacleField;
+    const Rectangle previousFieldBounds = GetFlockObstacleFieldBounds(flockState);
+    flockState->arena = (struct Arena){0};
+    flockState->obstacles = NULL;
+    flockState->obstaclesCount = 0;
+    flockState->obstaclesCapacity = 0;
+    flockState->obstacleField = (struct ObstacleField){0};
+    DestroyFlock(flockState);
+    if (!CreateFlock(flockState, config, NULL, arena)) {
+        free(obstacles);
+        DestroyObstacleField(&obstacleField);
+        return false;
+    }
+
+    flockState->obstacles = obstacles;
+    flockState->obstaclesCount = obstaclesCount;
+    flockState->obstaclesCapacity = obstaclesCapacity;
+    flockState->obstacleField = obstacleField;
+    if (obstaclesCount > 0 && !AreFlockBoundsEqual(previousFieldBounds, GetFlockObstacleFieldBounds(flockState)) &&
+        !BakeFlockObstacles(flockState)) {
+        FlockLog(LOG_WARNING, "ResetFlock: Failed to bake the obstacles over the new bounds, removing them.");
+    }
+    return true;
+}
+
+bool InitializeFlockFromBoids(struct FlockState *flockState, const struct FlockConfig config,
+                              const struct BoidArrays *boids) {
+    if (boids == NULL) {
+        FlockLog(LOG_ERROR, "InitializeFlockFromBoids: Recieved NULL pointer to boids.");
+        return false;
+    }
+
+    return CreateFlock(flockState, config, boids, (struct Arena){0});
+}
+
+bool SetFlockBoidIds(struct FlockState *flockState, const int *boidIds) {
+    if (flockState == NULL || boidIds == NULL) {
+        FlockLog(LOG_ERROR, "SetFlockBoidIds: Recieved NULL pointer.");
+        return false;
+    }
+
+    // The indices mark the IDs that have been seen, so they are built and checked in one pass
+    const int boidsCount = flockState->boidsCount;
+    for (int id = 0; id < boidsCount; id++) {
+        flockState->boidIndices[id] = -1;
+    }
+    bool areIdsValid = true;
+    for (int i = 0; i < boidsCount && areIdsValid; i++) {
+        const int id = boidIds[i];
+        areIdsValid = id >= 0 && id < boidsCount && flockState->boidIndices[id] == -1;
+        if (areIdsValid) {
+            flockState->boidIndices[id] = i;
+        }
+    }
+    if (!areIdsValid) {
+        FlockLog(LOG_ERROR, "SetFlockBoidIds: The IDs aren't each of [0, %d) once.", boidsCount);
+        for (int i = 0; i < boidsCount; i++) {
+            flockState->boidIndices[flockState->boidIds[i]] = i;
+        }
+        return false;
+    }
+
+    memcpy(flockState->boidIds, boidIds, sizeof(int) * (size_t)boidsCount);
+    AssignFlockSpecies(flockState, 0, boidsCount);
+    // The lists refer to the boids by their old indices
+    InvalidateNeighbourLists(&flockState->neighbourLists);
     return true;
 }
 
 void ModifyFlockConfig(struct FlockState *flockState, struct FlockConfig newConfig) {
     if (flockState == NULL) {
-        TraceLog(LOG_ERROR, "ModifyFlockConfig: Recieved NULL pointer to flockState.");
+        FlockLog(LOG_ERROR, "ModifyFlockConfig: Recieved NULL pointer to flockState.");
         return;
     }
 
@@ -180,72 +536,346 @@ void ModifyFlockConfig(struct FlockState *flockState, struct FlockConfig newConf
 
     enum FlockConfigValidationResult validationResult = validateFlockConfig(&newConfig);
     if (validationResult != FLOCK_CONFIG_VALID) {
-        TraceLog(LOG_ERROR, "InitializeFlock: Failed due to invalid flock config, %s.",
+        FlockLog(LOG_ERROR, "InitializeFlock: Failed due to invalid flock config, %s.",
                  FlockConfigValidationMessage(validationResult));
         return;
     }
 
+    // The boid count is changed by ResizeFlock, which keeps the config in sync with the boids that actually exist
+    const int numberOfBoids = newConfig.numberOfBoids;
+    newConfig.numberOfBoids = flockState->boidsCount;
+
+    if (newConfig.threadCount != GetWorkerPoolThreadCount(&flockState->workerPool)) {
+        DestroyWorkerPool(&flockState->workerPool);
+        if (!InitializeWorkerPool(&flockState->workerPool, newConfig.threadCount)) {
+            FlockLog(LOG_WARNING, "ModifyFlockConfig: Failed to start %d threads, using a single thread instead.",
+                     newConfig.threadCount);
+            // A single thread pool doesn't create any threads so it can't fail
+            InitializeWorkerPool(&flockState->workerPool, 1);
+            newConfig.threadCount = 1;
+        }
+    }
+
+    const bool hasSpeciesCountChanged = newConfig.speciesCount != flockState->config.speciesCount;
+    const Rectangle previousFieldBounds = GetFlockObstacleFieldBounds(flockState);
     flockState->config = newConfig;
+    if (hasSpeciesCountChanged) {
+        AssignFlockSpecies(flockState, 0, flockState->boidsCount);
+    }
+    // The obstacle field covers the bounds (and in an open world the obstacles' ranges)
+    if (flockState->obstaclesCount > 0 &&
+        !AreFlockBoundsEqual(previousFieldBounds, GetFlockObstacleFieldBounds(flockState)) &&
+        !BakeFlockObstacles(flockState)) {
+        FlockLog(LOG_WARNING, "ModifyFlockConfig: Failed to bake the obstacles over the new bounds, removing them.");
+    }
+
+    if (numberOfBoids != flockState->boidsCount && !ResizeFlock(flockState, numberOfBoids)) {
+        FlockLog(LOG_WARNING, "ModifyFlockConfig: Failed to resize the flock to %d boids, keeping %d boids.",
+                 numberOfBoids, flockState->boidsCount);
+    }
 }
 
-// Internal function that calculates the steering force (total separation, alignment and cohesion) for the given boid.
-static Vector2 CalculateSteeringForce(int boidIndex, const struct FlockState *flockState) {
-    const Boid *boid = &flockState->boids[boidIndex];
+// Internal function that grows the per boid buffers to hold at least the given number of boids, keeping the current
+// boids. The capacity at least doubles so that repeatedly adding a few boids doesn't reallocate every time.
+static bool ReserveFlockCapacity(struct FlockState *flockState, const int numberOfBoids) {
+    if (numberOfBoids <= flockState->boidsCapacity) {
+        return true;
+    }
 
-    // Accumulators
-    Vector2 separationAccumulator = Vector2Zero();
-    Vector2 averageVelocity = Vector2Zero();
-    Vector2 centerOfMass = Vector2Zero();
+    int newCapacity = flockState->boidsCapacity * 2;
+    if (newCapacity < numberOfBoids) {
+        newCapacity = numberOfBoids;
+    }
 
-    int boidsInSeparationRange = 0;
-    int boidsInAlignmentRange = 0;
-    int boidsInCohesionRange = 0;
+    // The buffers are moved to a new arena, so the flock is left unchanged if it can't be allocated
+    struct Arena arena = {0};
+    struct FlockBuffers buffers;
+    if (!CarveFlockBuffers(&arena, newCapacity, &buffers)) {
+        FlockLog(LOG_ERROR, "ReserveFlockCapacity: Failed to allocate memory for %d boids.", newCapacity);
+        FreeArena(&arena);
+        return false;
+    }
 
+    // The grid and the sort buffers are filled from scratch each time they are used, so they don't need to keep their
+    // contents
+    const int boidsCount = flockState->boidsCount;
+    const size_t arraySize = sizeof(float) * (size_t)boidsCount;
+    memcpy(buffers.boids.positionsX, flockState->boids.positionsX, arraySize);
+    memcpy(buffers.boids.positionsY, flockState->boids.positionsY, arraySize);
+    memcpy(buffers.boids.velocitiesX, flockState->boids.velocitiesX, arraySize);
+    memcpy(buffers.boids.velocitiesY, flockState->boids.velocitiesY, arraySize);
+    memcpy(buffers.steeringForces, flockState->steeringForces, sizeof(Vector2) * (size_t)boidsCount);
 #ifdef DEBUG
-    float collisionTime = 0;
+    memcpy(buffers.debug_boidData, flockState->debug_boidData, sizeof(struct Debug_BoidData) * (size_t)boidsCount);
 #endif /* ifdef DEBUG */
+    memcpy(buffers.boidIds, flockState->boidIds, sizeof(int) * (size_t)boidsCount);
+    memcpy(buffers.boidIndices, flockState->boidIndices, sizeof(int) * (size_t)boidsCount);
+    memcpy(buffers.boidSpecies, flockState->boidSpecies, sizeof(uint8_t) * (size_t)boidsCount);
 
+    FreeArena(&flockState->arena);
+    flockState->arena = arena;
+    flockState->boids = buffers.boids;
+    flockState->steeringForces = buffers.steeringForces;
+#ifdef DEBUG
+    flockState->debug_boidData = buffers.debug_boidData;
+#endif /* ifdef DEBUG */
+    flockState->boidIds = buffers.boidIds;
+    flockState->boidIndices = buffers.boidIndices;
+    flockState->boidSpecies = buffers.boidSpecies;
+    flockState->sortBuffers = buffers.sortBuffers;
+    flockState->sortScratch = buffers.sortScratch;
+    flockState->grid = buffers.grid;
+    flockState->boidsCapacity = newCapacity;
+
+    return true;
+}
+
+// Internal function that removes the boids with IDs from numberOfBoids up, moving the rest down to close the gaps
+// without changing their order
+static void RemoveFlockBoids(struct FlockState *flockState, const int numberOfBoids) {
+    int keptCount = 0;
+    int keptForcesCount = 0;
     for (int i = 0; i < flockState->boidsCount; i++) {
-        if (boidIndex == i) {
+        const int id = flockState->boidIds[i];
+        if (id >= numberOfBoids) {
             continue;
         }
 
-        const Boid *otherBoid = &flockState->boids[i];
-        const float distanceToOtherBoid = Vector2Distance(boid->position, otherBoid->position);
-
-        // Separation
-        // A force pushing away from other boids, the smaller distance between the boids, the
-        // stronger the force.
-        if (distanceToOtherBoid < flockState->config.separationRange && distanceToOtherBoid > EPSILON) {
-            Vector2 offset = Vector2Subtract(boid->position, otherBoid->position);
-            // Magnitude starts at 0 at the edge of the range and scales towards infinity
-            float speed = (flockState->config.separationRange / distanceToOtherBoid) - 1;
-            // Magnitude gets exponentially higher as the distance closes
-            speed *= flockState->config.maximumSpeed;
-            separationAccumulator = Vector2Add(separationAccumulator, Vector2Scale(Vector2Normalize(offset), speed));
-            boidsInSeparationRange++;
+        // The boids with a force stay at the front since the order is kept
+        if (i < flockState->steeringForcesCount) {
+            keptForcesCount++;
         }
-
-        // Alignment
-        // Adjusts the velocity towards the average velocity of the boids within range.
-        if (distanceToOtherBoid < flockState->config.alignmentRange) {
-            averageVelocity = Vector2Add(averageVelocity, otherBoid->velocity);
-            boidsInAlignmentRange++;
+        if (keptCount != i) {
+            SetBoidInArrays(&flockState->boids, keptCount, GetBoidFromArrays(&flockState->boids, i));
+            flockState->steeringForces[keptCount] = flockState->steeringForces[i];
+#ifdef DEBUG
+            flockState->debug_boidData[keptCount] = flockState->debug_boidData[i];
+#endif /* ifdef DEBUG */
+            flockState->boidIds[keptCount] = id;
+            flockState->boidSpecies[keptCount] = flockState->boidSpecies[i];
         }
+        flockState->boidIndices[id] = keptCount;
+        keptCount++;
+    }
+    flockState->steeringForcesCount = keptForcesCount;
+}
 
-        // Cohesion
-        // A force towards the centre of the boids within range.
-        if (distanceToOtherBoid < flockState->config.cohesionRange) {
-            centerOfMass = Vector2Add(centerOfMass, otherBoid->position);
-            boidsInCohesionRange++;
-        }
+bool ResizeFlock(struct FlockState *flockState, const int numberOfBoids) {
+    if (flockState == NULL) {
+        FlockLog(LOG_ERROR, "ResizeFlock: Recieved NULL pointer to flockState.");
+        return false;
+    }
+    if (numberOfBoids <= 0) {
+        FlockLog(LOG_ERROR, "ResizeFlock: Failed due to invalid number of boids, %s.",
+                 FlockConfigValidationMessage(FLOCK_CONFIG_INVALID_BOID_COUNT));
+        return false;
+    }
 
+    if (!ReserveFlockCapacity(flockState, numberOfBoids)) {
+        FlockLog(LOG_ERROR, "ResizeFlock: Failed to make room for %d boids.", numberOfBoids);
+        return false;
+    }
+
+    // Only the new boids are spawned, at the end of the arrays with the next IDs
+    const struct FlockConfig *config = &flockState->config;
+    if (numberOfBoids > flockState->boidsCount) {
+        SpawnBoids(&flockState->boids, flockState->boidsCount, numberOfBoids, config->flockBounds,
+                   (config->minimumSpeed + config->maximumSpeed) / 2.F, &flockState->randomState);
 #ifdef DEBUG
-        if (distanceToOtherBoid < 5.F) {
-            collisionTime += GetFrameTime();
+        memset(&flockState->debug_boidData[flockState->boidsCount], 0,
+               sizeof(struct Debug_BoidData) * (numberOfBoids - flockState->boidsCount));
+#endif /* ifdef DEBUG */
+        for (int i = flockState->boidsCount; i < numberOfBoids; i++) {
+            flockState->boidIds[i] = i;
+            flockState->boidIndices[i] = i;
         }
+        AssignFlockSpecies(flockState, flockState->boidsCount, numberOfBoids);
+    } else if (numberOfBoids < flockState->boidsCount) {
+        RemoveFlockBoids(flockState, numberOfBoids);
+    }
+
+    flockState->boidsCount = numberOfBoids;
+    flockState->config.numberOfBoids = numberOfBoids;
+    if (flockState->steeringForcesCount > numberOfBoids) {
+        flockState->steeringForcesCount = numberOfBoids;
+    }
+    // The lists can't tell new boids from the old ones if the count ends up the same before the next update
+    InvalidateNeighbourLists(&flockState->neighbourLists);
+
+    return true;
+}
+
+// Internal function that grows the obstacles to hold at least the given number, keeping the current ones. The capacity
+// at least doubles so that adding obstacles one at a time doesn't reallocate every time.
+static bool ReserveFlockObstacles(struct FlockState *flockState, const int obstaclesCount) {
+    if (obstaclesCount <= flockState->obstaclesCapacity) {
+        return true;
+    }
+
+    int newCapacity = flockState->obstaclesCapacity * 2;
+    if (newCapacity < obstaclesCount) {
+        newCapacity = obstaclesCount;
+    }
+    struct FlockObstacle *obstacles = realloc(flockState->obstacles, sizeof(struct FlockObstacle) * newCapacity);
+    if (obstacles == NULL) {
+        return false;
+    }
+    flockState->obstacles = obstacles;
+    flockState->obstaclesCapacity = newCapacity;
+    return true;
+}
+
+bool SetFlockObstacles(struct FlockState *flockState, const struct FlockObstacle *obstacles, const int obstaclesCount) {
+    if (flockState == NULL || (obstacles == NULL && obstaclesCount > 0)) {
+        FlockLog(LOG_ERROR, "SetFlockObstacles: Recieved NULL pointer.");
+        return false;
+    }
+    if (obstaclesCount < 0) {
+        FlockLog(LOG_ERROR, "SetFlockObstacles: Recieved invalid number of obstacles %d.", obstaclesCount);
+        return false;
+    }
+
+    if (!ReserveFlockObstacles(flockState, obstaclesCount)) {
+        FlockLog(LOG_ERROR, "SetFlockObstacles: Failed to allocate memory for %d obstacles.", obstaclesCount);
+        flockState->obstaclesCount = 0;
+        BakeFlockObstacles(flockState);
+        return false;
+    }
+    if (obstaclesCount > 0) {
+        memcpy(flockState->obstacles, obstacles, sizeof(struct FlockObstacle) * (size_t)obstaclesCount);
+    }
+    flockState->obstaclesCount = obstaclesCount;
+
+    if (!BakeFlockObstacles(flockState)) {
+        FlockLog(LOG_ERROR, "SetFlockObstacles: Failed to bake %d obstacles.", obstaclesCount);
+        return false;
+    }
+    return true;
+}
+
+bool AddFlockObstacle(struct FlockState *flockState, const struct FlockObstacle obstacle) {
+    if (flockState == NULL) {
+        FlockLog(LOG_ERROR, "AddFlockObstacle: Recieved NULL pointer to flockState.");
+        return false;
+    }
+
+    if (!ReserveFlockObstacles(flockState, flockState->obstaclesCount + 1)) {
+        FlockLog(LOG_ERROR, "AddFlockObstacle: Failed to allocate memory for %d obstacles.",
+                 flockState->obstaclesCount + 1);
+        return false;
+    }
+    flockState->obstacles[flockState->obstaclesCount++] = obstacle;
+
+    if (!BakeFlockObstacles(flockState)) {
+        FlockLog(LOG_ERROR, "AddFlockObstacle: Failed to bake %d obstacles.", flockState->obstaclesCount);
+        return false;
+    }
+    return true;
+}
+
+// Internal function that gets the distance within which the grid has to find neighbours, this is the smallest cell
+// size the spatial grid can use. When the quadtree is used the grid is only needed for separation.
+static float GetFlockInteractionRange(const struct FlockConfig *config, const bool useQuadtree) {
+    float range = config->separationRange;
+    if (!useQuadtree) {
+        range = fmaxf(range, fmaxf(config->alignmentRange, config->cohesionRange));
+    }
+#ifdef DEBUG
+    range = fmaxf(range, DEBUG_COLLISION_DISTANCE);
 #endif /* ifdef DEBUG */
+    return range;
+}
+
+// Internal function that creates the grid's kernel query for the current config, the position is filled in per boid.
+// When the quadtree is used the grid query leaves out alignment and cohesion.
+static struct SteeringQuery CreateSteeringQuery(const struct FlockConfig *config, const bool useQuadtree) {
+    const float interactionRange = GetFlockInteractionRange(config, useQuadtree);
+    return (struct SteeringQuery){
+        .separationRange = config->separationRange,
+        .separationRangeSquared = config->separationRange * config->separationRange,
+        .alignmentRangeSquared = useQuadtree ? 0.F : config->alignmentRange * config->alignmentRange,
+        .cohesionRangeSquared = useQuadtree ? 0.F : config->cohesionRange * config->cohesionRange,
+        .interactionRangeSquared = interactionRange * interactionRange,
+#ifdef DEBUG
+        .collisionDistanceSquared = DEBUG_COLLISION_DISTANCE * DEBUG_COLLISION_DISTANCE,
+#endif /* ifdef DEBUG */
+    };
+}
+
+// Shared inputs of the steering task
+struct SteeringTaskContext {
+    struct FlockState *flockState;
+    struct SteeringQuery queryTemplate;
+    // NULL when the quadtree isn't used for this update
+    const struct SteeringQuery *quadtreeQueryTemplate;
+    // Set when the neighbour lists are up to date for this update
+    bool useNeighbourLists;
+    // Set when each boid is moved as soon as its force is found instead of storing the force
+    bool integrateForces;
+    // Only boids whose ID is steeringSlice modulo the steering interval, or that have no force yet, are updated
+    int steeringInterval;
+    int steeringSlice;
+    float deltaTime;
+};
+
+// Internal function that accumulates the boids at [start, end) of the grid's cell order, with the kernel for the way
+// the grid was built
+static inline void AccumulateGridSteering(const struct FlockState *flockState, const struct SteeringQuery *query,
+                                          const int start, const int end, struct SteeringSums *sums) {
+    const struct SpatialGrid *grid = &flockState->grid;
+    if (grid->isCompact) {
+        flockState->compactSteeringKernel(query, &grid->compactBoids, start, end, sums);
+    } else {
+        flockState->steeringKernel(query, &grid->sortedBoids, start, end, sums);
     }
+}
+
+// Internal function that calculates the steering force (total separation, alignment and cohesion) for the given boid.
+// Only the boids in the cells around the boid are visited, the spatial grid must have been built from the current
+// boid positions (or along with the neighbour lists, when they are used) and sortedIndex is the boid's position in the
+// grid's cell order. When the quadtree is used alignment and cohesion are found with it instead, it must have been
+// built from the current positions.
+static Vector2 CalculateSteeringForce(int boidIndex, int sortedIndex, const struct SteeringTaskContext *context) {
+    const struct FlockState *flockState = context->flockState;
+    const Boid boid = GetBoidFromArrays(&flockState->boids, boidIndex);
+
+    struct SteeringQuery query = context->queryTemplate;
+    query.positionX = boid.position.x;
+    query.positionY = boid.position.y;
+
+    // The grid has a layer per species, so the neighbours of each species are summed separately
+    const struct SpatialGrid *grid = &flockState->grid;
+    struct SteeringSums sums[FLOCK_MAX_SPECIES] = {0};
+    if (context->useNeighbourLists) {
+        AccumulateNeighbourListSteering(&flockState->neighbourLists, grid, sortedIndex, &query,
+                                        flockState->steeringKernel, flockState->steeringIndexedKernel, &sums[0]);
+    } else {
+        struct SpatialGridSpan spans[SPATIAL_GRID_MAX_SPANS];
+        const int spansCount = GetSpatialGridNeighbourSpans(grid, boid.position, spans);
+
+        // Sum the contributions of the neighbours in each span, skipping the boid itself
+        for (int span = 0; span < spansCount; span++) {
+            struct SteeringSums *layerSums = &sums[spans[span].layer];
+            if (sortedIndex >= spans[span].start && sortedIndex < spans[span].end) {
+                AccumulateGridSteering(flockState, &query, spans[span].start, sortedIndex, layerSums);
+                AccumulateGridSteering(flockState, &query, sortedIndex + 1, spans[span].end, layerSums);
+            } else {
+                AccumulateGridSteering(flockState, &query, spans[span].start, spans[span].end, layerSums);
+            }
+        }
+    }
+
+    const struct SteeringQuery *quadtreeQueryTemplate = context->quadtreeQueryTemplate;
+    if (quadtreeQueryTemplate != NULL) {
+        struct SteeringQuery quadtreeQuery = *quadtreeQueryTemplate;
+        quadtreeQuery.positionX = boid.position.x;
+        quadtreeQuery.positionY = boid.position.y;
+        AccumulateQuadtreeSteering(&flockState->quadtree, &quadtreeQuery, flockState->quadtree.boidSlots[boidIndex],
+                                   flockState->config.quadtreeOpeningAngle, flockState->steeringKernel, &sums[0]);
+    }
+
+    const struct FlockSpeciesConfig *species = &flockState->config.species[flockState->boidSpecies[boidIndex]];
+    const float maximumSpeed = flockState->config.maximumSpeed * species->speedFactor;
 
     // Calculate steering forces
     Vector2 desiredSeparation = Vector2Zero();
@@ -256,31 +886,81 @@ static Vector2 CalculateSteeringForce(int boidIndex, const struct FlockState *fl
     Vector2 alignmentSteeringForce = Vector2Zero();
     Vector2 cohesionSteeringForce = Vector2Zero();
 
-    // Separation
-    if (boidsInSeparationRange > 0) {
-        desiredSeparation = Vector2ClampValue(separationAccumulator, 0.F, flockState->config.maximumSpeed);
-        separationSteeringForce = Vector2Subtract(desiredSeparation, boid->velocity);
-    }
+#ifdef DEBUG
+    int collisionCount = 0;
+#endif /* ifdef DEBUG */
+
+    // Each species' forces are weighted by how this boid's species reacts to it
+    for (int other = 0; other < flockState->config.speciesCount; other++) {
+        const struct SteeringSums *otherSums = &sums[other];
+
+        // Separation
+        // A force pushing away from other boids, the smaller distance between the boids, the stronger the force. The
+        // kernels sum the unit offsets scaled by (range / distance - 1), this is then scaled by the maximum speed.
+        if (otherSums->separationCount > 0) {
+            const float weight = species->separationWeights[other];
+            const Vector2 separationAccumulator =
+                Vector2Scale((Vector2){.x = otherSums->separationX, .y = otherSums->separationY}, maximumSpeed);
+            const Vector2 desired = Vector2ClampValue(separationAccumulator, 0.F, maximumSpeed);
+            desiredSeparation = Vector2Add(desiredSeparation, Vector2Scale(desired, weight));
+            separationSteeringForce = Vector2Add(separationSteeringForce,
+                                                 Vector2Scale(Vector2Subtract(desired, boid.velocity), weight));
+        }
+
+        // Alignment
+        // Adjusts the velocity towards the average velocity of the boids within range.
+        if (otherSums->alignmentCount > 0) {
+            const float weight = species->alignmentWeights[other];
+            const Vector2 averageVelocity =
+                Vector2Scale((Vector2){.x = otherSums->velocityX, .y = otherSums->velocityY},
+                             1.F / (float)otherSums->alignmentCount);
+            const Vector2 desired = Vector2ClampValue(averageVelocity, 0.F, maximumSpeed);
+            desiredAlignment = Vector2Add(desiredAlignment, Vector2Scale(desired, weight));
+            alignmentSteeringForce = Vector2Add(alignmentSteeringForce,
+                                                Vector2Scale(Vector2Subtract(desired, boid.velocity), weight));
+        }
+
+        // Cohesion
+        // A force towards the centre of the boids within range.
+        if (otherSums->cohesionCount > 0) {
+            const float weight = species->cohesionWeights[other];
+            const Vector2 centerOfMass = Vector2Scale((Vector2){.x = otherSums->positionX, .y = otherSums->positionY},
+                                                      1.F / (float)otherSums->cohesionCount);
+            const Vector2 desired =
+                Vector2ClampValue(Vector2Subtract(centerOfMass, boid.position), 0.F, maximumSpeed);
+            desiredCohesion = Vector2Add(desiredCohesion, Vector2Scale(desired, weight));
+            cohesionSteeringForce = Vector2Add(cohesionSteeringForce,
+                                               Vector2Scale(Vector2Subtract(desired, boid.velocity), weight));
+        }
 
-    // Alignment
-    if (boidsInAlignmentRange > 0) {
-        averageVelocity = Vector2Scale(averageVelocity, 1.F / (float)boidsInAlignmentRange);
-        desiredAlignment = Vector2ClampValue(averageVelocity, 0.F, flockState->config.maximumSpeed);
-        alignmentSteeringForce = Vector2Subtract(desiredAlignment, boid->velocity);
+#ifdef DEBUG
+        collisionCount += otherSums->collisionCount;
+#endif /* ifdef DEBUG */
     }
 
-    // Cohesion
-    if (boidsInCohesionRange > 0) {
-        centerOfMass = Vector2Scale(centerOfMass, 1.F / (float)boidsInCohesionRange);
-        desiredCohesion = Vector2Subtract(centerOfMass, boid->position);
-        desiredCohesion = Vector2ClampValue(desiredCohesion, 0.F, flockState->config.maximumSpeed);
-        cohesionSteeringForce = Vector2Subtract(desiredCohesion, boid->velocity);
+    // Obstacle avoidance
+    // A force away from the nearest obstacle, looked up in the baked field so it costs the same however many obstacles
+    // there are. It grows from nothing at the avoidance range to its full strength at the obstacle's edge.
+    Vector2 desiredObstacleAvoidance = Vector2Zero();
+    Vector2 obstacleSteeringForce = Vector2Zero();
+    const float obstacleAvoidanceRange = flockState->config.obstacleAvoidanceRange;
+    if (flockState->obstacleField.obstaclesCount > 0 && obstacleAvoidanceRange > 0.F) {
+        const struct ObstacleFieldSample sample = SampleObstacleField(&flockState->obstacleField, boid.position);
+        if (sample.distance < obstacleAvoidanceRange) {
+            const float strength = fminf(1.F - (sample.distance / obstacleAvoidanceRange), 1.F);
+            desiredObstacleAvoidance =
+                Vector2Scale((Vector2){.x = sample.gradientX, .y = sample.gradientY}, maximumSpeed);
+            obstacleSteeringForce =
+                Vector2Scale(Vector2Subtract(desiredObstacleAvoidance, boid.velocity), strength);
+        }
     }
 
 #ifdef DEBUG
+    const float collisionTime = (float)collisionCount * context->deltaTime;
     flockState->debug_boidData[boidIndex].separationVector = desiredSeparation;
     flockState->debug_boidData[boidIndex].alignmentVector = desiredAlignment;
     flockState->debug_boidData[boidIndex].cohesionVector = desiredCohesion;
+    flockState->debug_boidData[boidIndex].obstacleVector = desiredObstacleAvoidance;
 
     flockState->debug_boidData[boidIndex].collisionTime = collisionTime;
 #endif /* ifdef DEBUG */
@@ -289,31 +969,40 @@ static Vector2 CalculateSteeringForce(int boidIndex, const struct FlockState *fl
     separationSteeringForce = Vector2Scale(separationSteeringForce, flockState->config.separationFactor);
     alignmentSteeringForce = Vector2Scale(alignmentSteeringForce, flockState->config.alignmentFactor);
     cohesionSteeringForce = Vector2Scale(cohesionSteeringForce, flockState->config.cohesionFactor);
+    obstacleSteeringForce = Vector2Scale(obstacleSteeringForce, flockState->config.obstacleAvoidanceFactor);
 
     Vector2 steeringForce = Vector2Add(separationSteeringForce, alignmentSteeringForce);
     steeringForce = Vector2Add(steeringForce, cohesionSteeringForce);
+    steeringForce = Vector2Add(steeringForce, obstacleSteeringForce);
 
     return steeringForce;
 }
 
-// Internal function that updates the given boid's position by applying its velocity (clamped by min/max speed).
-static void UpdateBoidPosition(Boid *boid, const struct FlockState *flockState) {
+// Internal function that updates the given boid's position by applying its velocity (clamped by min/max speed, scaled
+// by the speed factor of the boid's species).
+static void UpdateBoidPosition(Boid *boid, const struct FlockState *flockState, const float speedFactor,
+                               const float deltaTime) {
     // Clamp boid speed
     if (flockState->config.clampSpeed) {
+        const float maximumSpeed = flockState->config.maximumSpeed * speedFactor;
+        const float minimumSpeed = flockState->config.minimumSpeed * speedFactor;
         float speed = Vector2Length(boid->velocity);
         // TODO: Handle speed = 0 to avoid division by 0
-        if (speed > flockState->config.maximumSpeed) {
-            boid->velocity = Vector2Scale(boid->velocity, (1.F / speed) * flockState->config.maximumSpeed);
-        } else if (speed < flockState->config.minimumSpeed) {
-            boid->velocity = Vector2Scale(boid->velocity, (1.F / speed) * flockState->config.minimumSpeed);
+        if (speed > maximumSpeed) {
+            boid->velocity = Vector2Scale(boid->velocity, (1.F / speed) * maximumSpeed);
+        } else if (speed < minimumSpeed) {
+            boid->velocity = Vector2Scale(boid->velocity, (1.F / speed) * minimumSpeed);
         }
     }
 
     // Update position
-    boid->position.x += boid->velocity.x * GetFrameTime();
-    boid->position.y += boid->velocity.y * GetFrameTime();
+    boid->position.x += boid->velocity.x * deltaTime;
+    boid->position.y += boid->velocity.y * deltaTime;
 
-    // Loop around screen edges
+    // Loop around screen edges, an open world has no edges
+    if (flockState->config.useOpenWorld) {
+        return;
+    }
     if (boid->position.x < flockState->config.flockBounds.x) {
         boid->position.x = flockState->config.flockBounds.x + flockState->config.flockBounds.width;
     }
@@ -328,9 +1017,116 @@ static void UpdateBoidPosition(Boid *boid, const struct FlockState *flockState)
     }
 }
 
-void UpdateFlock(struct FlockState *flockState) {
+// Internal function that applies the steering force to the boid at the given index and moves it
+static inline void IntegrateBoid(struct FlockState *flockState, const int boidIndex, const Vector2 steeringForce,
+                                 const float deltaTime) {
+    Boid boid = GetBoidFromArrays(&flockState->boids, boidIndex);
+    boid.velocity = Vector2Add(boid.velocity, Vector2Scale(steeringForce, deltaTime));
+    const float speedFactor = flockState->config.species[flockState->boidSpecies[boidIndex]].speedFactor;
+    UpdateBoidPosition(&boid, flockState, speedFactor, deltaTime);
+    SetBoidInArrays(&flockState->boids, boidIndex, boid);
+}
+
+// Internal function that calculates the steering forces for the boids at [start, end) of the grid's cell order that
+// are due an update. Each boid only reads its neighbours from the grid (or the quadtree) and writes its own steering
+// force, so chunks can run in parallel. For the same reason a boid can be moved as soon as its force is found.
+static void SteeringTask(void *context, const int start, const int end) {
+    TRACE_BEGIN(SteeringTask);
+    const struct SteeringTaskContext *taskContext = context;
+    struct FlockState *flockState = taskContext->flockState;
+
+    // Visit the boids in cell order so that consecutive boids look at the same cells. Slices are picked by ID rather
+    // than by cell, so every chunk has about the same share of the boids to update, and rather than by index, so a
+    // boid that is re-sorted still takes its turn every steering interval steps.
+    for (int sortedIndex = start; sortedIndex < end; sortedIndex++) {
+        const int i = flockState->grid.sortedIndices[sortedIndex];
+        if (flockState->boidIds[i] % taskContext->steeringInterval == taskContext->steeringSlice ||
+            i >= flockState->steeringForcesCount) {
+            const Vector2 steeringForce = CalculateSteeringForce(i, sortedIndex, taskContext);
+            if (taskContext->integrateForces) {
+                IntegrateBoid(flockState, i, steeringForce, taskContext->deltaTime);
+            } else {
+                flockState->steeringForces[i] = steeringForce;
+            }
+        }
+    }
+    TRACE_END(SteeringTask);
+}
+
+// Shared inputs of the integration task
+struct IntegrationTaskContext {
+    struct FlockState *flockState;
+    float deltaTime;
+};
+
+// Internal function that applies the steering forces and moves the boids at [start, end)
+static void IntegrationTask(void *context, const int start, const int end) {
+    TRACE_BEGIN(IntegrationTask);
+    const struct IntegrationTaskContext *taskContext = context;
+    struct FlockState *flockState = taskContext->flockState;
+    const float deltaTime = taskContext->deltaTime;
+
+    for (int i = start; i < end; i++) {
+        IntegrateBoid(flockState, i, flockState->steeringForces[i], deltaTime);
+    }
+    TRACE_END(IntegrationTask);
+}
+
+// Internal function that moves each element of a per boid buffer to its place in the new order, order[n] is the index
+// of the element that goes to n
+static void PermuteFlockBuffer(void *buffer, void *scratch, const size_t elementSize, const int *order,
+                               const int boidsCount) {
+    const unsigned char *source = buffer;
+    unsigned char *target = scratch;
+    for (int n = 0; n < boidsCount; n++) {
+        memcpy(&target[(size_t)n * elementSize], &source[(size_t)order[n] * elementSize], elementSize);
+    }
+    memcpy(buffer, scratch, elementSize * (size_t)boidsCount);
+}
+
+// Internal function that re-sorts the boids by the Morton key of their position. The grid copies the boids into cell
+// order every update, but the gather that copies them and every other per boid access (forces, integration, the
+// quadtree) go by index, so keeping boids that are close in the flock close in memory cuts the cache misses of each.
+static void SortFlockBoids(struct FlockState *flockState) {
+    const int boidsCount = flockState->boidsCount;
+    // The keys are spread over the space the boids actually cover when they aren't kept within the bounds
+    const Rectangle bounds = flockState->config.useOpenWorld ? GetBoidArraysExtent(&flockState->boids, boidsCount)
+                                                             : flockState->config.flockBounds;
+    const int *order = SortBoidsByMortonKey(&flockState->sortBuffers, &flockState->boids, boidsCount, bounds);
+    if (order == NULL) {
+        FlockLog(LOG_WARNING, "UpdateFlock: Failed to sort the boids, keeping their order.");
+        return;
+    }
+
+    float *arrays[4] = {
+        flockState->boids.positionsX,
+        flockState->boids.positionsY,
+        flockState->boids.velocitiesX,
+        flockState->boids.velocitiesY,
+    };
+    for (int array = 0; array < 4; array++) {
+        PermuteFlockBuffer(arrays[array], flockState->sortScratch, sizeof(float), order, boidsCount);
+    }
+    PermuteFlockBuffer(flockState->steeringForces, flockState->sortScratch, sizeof(Vector2), order, boidsCount);
+#ifdef DEBUG
+    PermuteFlockBuffer(flockState->debug_boidData, flockState->sortScratch, sizeof(struct Debug_BoidData), order,
+                       boidsCount);
+#endif /* ifdef DEBUG */
+
+    // The boids keep their IDs and species wherever they are moved to
+    PermuteFlockBuffer(flockState->boidIds, flockState->sortScratch, sizeof(int), order, boidsCount);
+    PermuteFlockBuffer(flockState->boidSpecies, flockState->sortScratch, sizeof(uint8_t), order, boidsCount);
+    for (int i = 0; i < boidsCount; i++) {
+        flockState->boidIndices[flockState->boidIds[i]] = i;
+    }
+
+    // The lists refer to the boids by their old indices
+    InvalidateNeighbourLists(&flockState->neighbourLists);
+}
+
+void UpdateFlock(struct FlockState *flockState, const float deltaTime) {
     if (flockState == NULL) {
-        TraceLog(LOG_ERROR, "UpdateFlock: Recieved NULL pointer to flockState.");
+        FlockLog(LOG_ERROR, "UpdateFlock: Recieved NULL pointer to flockState.");
         return;
     }
 
@@ -342,46 +1138,364 @@ void UpdateFlock(struct FlockState *flockState) {
             return;
         }
     }
+#endif /* ifdef DEBUG */
+
+    TRACE_BEGIN(UpdateFlock);
+
+    PROFILER_BEGIN(PROFILER_PHASE_GRID);
+    // The quadtree and the neighbour lists sum up neighbours without telling their species apart
+    const int speciesCount = flockState->config.speciesCount;
+    const uint8_t *boidSpecies = speciesCount > 1 ? flockState->boidSpecies : NULL;
+    bool useQuadtree = flockState->config.useQuadtree && speciesCount == 1;
+    if (useQuadtree) {
+        TRACE_BEGIN(BuildFlockQuadtree);
+        if (!BuildFlockQuadtree(&flockState->quadtree, &flockState->boids, flockState->boidsCount)) {
+            FlockLog(LOG_WARNING, "UpdateFlock: Failed to build the quadtree, using the grid for this update.");
+            useQuadtree = false;
+        }
+        TRACE_END(BuildFlockQuadtree);
+    }
+
+    // The lists are only rebuilt, along with the grid, once too many boids have moved
+    const float interactionRange = GetFlockInteractionRange(&flockState->config, useQuadtree);
+    const float skin = flockState->config.neighbourListSkin;
+    const bool useOpenWorld = flockState->config.useOpenWorld;
+    const bool useCompactStorage = flockState->config.useCompactStorage && !useOpenWorld;
+    // The lists read the grid's float copies
+    bool useNeighbourLists = flockState->config.useNeighbourLists && !useCompactStorage && speciesCount == 1;
+    bool isGridBuilt = false;
+    if (useNeighbourLists &&
+        !UpdateNeighbourListMoves(&flockState->neighbourLists, &flockState->grid, &flockState->boids,
+                                  flockState->boidsCount, interactionRange, skin, flockState->config.flockBounds)) {
+        TRACE_BEGIN(BuildNeighbourLists);
+        if (useOpenWorld) {
+            BuildSparseSpatialGrid(&flockState->grid, &flockState->boids, NULL, 1, flockState->boidsCount,
+                                   interactionRange + skin);
+        } else {
+            BuildSpatialGrid(&flockState->grid, &flockState->boids, NULL, 1, flockState->boidsCount,
+                             flockState->config.flockBounds, interactionRange + skin);
+        }
+        isGridBuilt = true;
+        if (!BuildNeighbourLists(&flockState->neighbourLists, &flockState->grid, &flockState->boids,
+                                 flockState->boidsCount, interactionRange, skin, &flockState->workerPool)) {
+            // The grid is still usable on its own, its cells are just larger than needed
+            FlockLog(LOG_WARNING, "UpdateFlock: Failed to build the neighbour lists, using the grid for this update.");
+            useNeighbourLists = false;
+        }
+        TRACE_END(BuildNeighbourLists);
+    }
+    if (!useNeighbourLists && !isGridBuilt) {
+        TRACE_BEGIN(BuildSpatialGrid);
+        if (useOpenWorld) {
+            BuildSparseSpatialGrid(&flockState->grid, &flockState->boids, boidSpecies, speciesCount,
+                                   flockState->boidsCount, interactionRange);
+        } else if (useCompactStorage) {
+            BuildCompactSpatialGrid(&flockState->grid, &flockState->boids, boidSpecies, speciesCount,
+                                    flockState->boidsCount, flockState->config.flockBounds, interactionRange);
+        } else {
+            BuildSpatialGrid(&flockState->grid, &flockState->boids, boidSpecies, speciesCount, flockState->boidsCount,
+                             flockState->config.flockBounds, interactionRange);
+        }
+        TRACE_END(BuildSpatialGrid);
+        // The lists refer to the grid's old cell order
+        InvalidateNeighbourLists(&flockState->neighbourLists);
+    }
+    PROFILER_END(&flockState->profiler, PROFILER_PHASE_GRID, flockState->boidsCount);
 
+    // The steering forces are all calculated from the current positions before any boid is moved. With compact storage
+    // every neighbour is read from the grid's copies, so when every boid is due a new force it can be moved straight
+    // away and the forces never have to be stored and read back.
+    const bool integrateForces = useCompactStorage && flockState->config.steeringInterval == 1;
+    const struct SteeringQuery quadtreeQueryTemplate = CreateSteeringQuery(&flockState->config, false);
+    struct SteeringTaskContext steeringContext = {
+        .flockState = flockState,
+        .queryTemplate = CreateSteeringQuery(&flockState->config, useQuadtree),
+        .quadtreeQueryTemplate = useQuadtree ? &quadtreeQueryTemplate : NULL,
+        .useNeighbourLists = useNeighbourLists,
+        .integrateForces = integrateForces,
+        // Taking turns by step count keeps the order the same when a flock is resumed from a checkpoint
+        .steeringInterval = flockState->config.steeringInterval,
+        .steeringSlice = (int)(flockState->clock.stepsCount % (uint64_t)flockState->config.steeringInterval),
+        .deltaTime = deltaTime,
+    };
+    PROFILER_BEGIN(PROFILER_PHASE_STEERING);
+    RunWorkerPool(&flockState->workerPool, SteeringTask, &steeringContext, flockState->boidsCount);
+    // Forces that were applied straight away aren't kept for later updates
+    flockState->steeringForcesCount = integrateForces ? 0 : flockState->boidsCount;
+    PROFILER_END(&flockState->profiler, PROFILER_PHASE_STEERING, flockState->boidsCount);
+
+#ifdef DEBUG
     float totalCollisionTime = 0.F;
+    for (int i = 0; i < flockState->boidsCount; i++) {
+        totalCollisionTime += flockState->debug_boidData[i].collisionTime;
+    }
+    flockState->collisionTime += totalCollisionTime;
+    flockState->collisionSampleTime += deltaTime;
 #endif /* ifdef DEBUG */
 
-    for (int i = 0; i < flockState->boidsCount; i++) {
-        Vector2 steeringForce = CalculateSteeringForce(i, flockState);
+    if (!integrateForces) {
+        struct IntegrationTaskContext integrationContext = {
+            .flockState = flockState,
+            .deltaTime = deltaTime,
+        };
+        PROFILER_BEGIN(PROFILER_PHASE_INTEGRATION);
+        RunWorkerPool(&flockState->workerPool, IntegrationTask, &integrationContext, flockState->boidsCount);
+        PROFILER_END(&flockState->profiler, PROFILER_PHASE_INTEGRATION, flockState->boidsCount);
+    }
 
-        flockState->steeringForces[i] = steeringForce;
+    flockState->clock.stepsCount++;
+    flockState->clock.time += deltaTime;
 
-        #ifdef DEBUG
-            totalCollisionTime += flockState->debug_boidData[i].collisionTime;
-        #endif /* ifdef DEBUG */
+    // Sorting after the boids have moved means every boid has a force to take along, and counting by step keeps the
+    // sorts at the same steps when a flock is resumed from a checkpoint
+    const int sortInterval = flockState->config.sortInterval;
+    if (sortInterval > 0 && flockState->clock.stepsCount % (uint64_t)sortInterval == 0) {
+        PROFILER_BEGIN(PROFILER_PHASE_SORTING);
+        TRACE_BEGIN(SortFlockBoids);
+        SortFlockBoids(flockState);
+        TRACE_END(SortFlockBoids);
+        PROFILER_END(&flockState->profiler, PROFILER_PHASE_SORTING, flockState->boidsCount);
     }
 
+    if (flockState->recorder != NULL) {
+        PROFILER_BEGIN(PROFILER_PHASE_RECORDING);
+        RecordTrajectoryFrame(flockState->recorder, &flockState->boids, flockState->boidIndices,
+                              flockState->boidsCount, flockState->clock.stepsCount, flockState->clock.time);
+        PROFILER_END(&flockState->profiler, PROFILER_PHASE_RECORDING, flockState->boidsCount);
+    }
+
+    TRACE_END(UpdateFlock);
+}
+
+int AdvanceFlock(struct FlockState *flockState, const float frameTime) {
+    if (flockState == NULL) {
+        FlockLog(LOG_ERROR, "AdvanceFlock: Recieved NULL pointer to flockState.");
+        return 0;
+    }
+
+    struct FlockClock *clock = &flockState->clock;
+    const float timeStep = flockState->config.timeStep;
+
 #ifdef DEBUG
-    flockState->collisionTime += totalCollisionTime;
+    // Time doesn't pass while paused, a single step request is still one full time step
+    if (flockState->isPaused) {
+        clock->accumulator = 0.F;
+        if (flockState->doStep) {
+            UpdateFlock(flockState, timeStep);
+            return 1;
+        }
+        return 0;
+    }
 #endif /* ifdef DEBUG */
 
-    for (int i = 0; i < flockState->boidsCount; i++) {
-        flockState->boids[i].velocity =
-            Vector2Add(flockState->boids[i].velocity, Vector2Scale(flockState->steeringForces[i], GetFrameTime()));
-        UpdateBoidPosition(&flockState->boids[i], flockState);
+    if (frameTime > 0.F) {
+        clock->accumulator += frameTime;
     }
+
+    int stepsCount = 0;
+    while (clock->accumulator >= timeStep && stepsCount < flockState->config.maxStepsPerFrame) {
+        UpdateFlock(flockState, timeStep);
+        clock->accumulator -= timeStep;
+        stepsCount++;
+    }
+
+    // Drop whole steps that didn't fit in this frame instead of catching up on them later, the simulation then runs
+    // slower than real time but each frame still costs at most maxStepsPerFrame steps
+    if (clock->accumulator >= timeStep) {
+        const float droppedTime = floorf(clock->accumulator / timeStep) * timeStep;
+        clock->droppedTime += droppedTime;
+        clock->accumulator = fmaxf(clock->accumulator - droppedTime, 0.F);
+    }
+
+    return stepsCount;
+}
+
+float GetFlockTimeSinceStep(const struct FlockState *flockState) {
+    if (flockState == NULL) {
+        FlockLog(LOG_ERROR, "GetFlockTimeSinceStep: Recieved NULL pointer to flockState.");
+        return 0.F;
+    }
+
+    return flockState->clock.accumulator;
+}
+
+Boid GetFlockBoid(const struct FlockState *flockState, const int boidIndex) {
+    if (flockState == NULL || boidIndex < 0 || boidIndex >= flockState->boidsCount) {
+        FlockLog(LOG_ERROR, "GetFlockBoid: Recieved invalid flockState or boid index %d.", boidIndex);
+        return (Boid){0};
+    }
+
+    return GetBoidFromArrays(&flockState->boids, boidIndex);
 }
 
 void DestroyFlock(struct FlockState *flockState) {
     if (flockState == NULL) {
-        TraceLog(LOG_ERROR, "DestroyFlock: Recieved NULL pointer to flockState.");
+        FlockLog(LOG_ERROR, "DestroyFlock: Recieved NULL pointer to flockState.");
         return;
     }
 
-    if (flockState->boids != NULL) {
-        free(flockState->boids);
-        flockState->boids = NULL;
-    }
+    DestroyWorkerPool(&flockState->workerPool);
 
+    // The boids, steering forces, debug data, IDs, species, sort buffers and grid all go with the arena
+    FreeArena(&flockState->arena);
+    flockState->boids = (struct BoidArrays){0};
     flockState->boidsCount = 0;
+    flockState->boidsCapacity = 0;
+    flockState->steeringForces = NULL;
+    flockState->boidIds = NULL;
+    flockState->boidIndices = NULL;
+    flockState->boidSpecies = NULL;
+    flockState->sortBuffers = (struct MortonSortBuffers){0};
+    flockState->sortScratch = NULL;
+#ifdef DEBUG
+    flockState->debug_boidData = NULL;
+#endif /* ifdef DEBUG */
+    DestroySpatialGrid(&flockState->grid);
+
+    DestroyFlockQuadtree(&flockState->quadtree);
+    DestroyNeighbourLists(&flockState->neighbourLists);
+
+    free(flockState->obstacles);
+    flockState->obstacles = NULL;
+    flockState->obstaclesCount = 0;
+    flockState->obstaclesCapacity = 0;
+    DestroyObstacleField(&flockState->obstacleField);
+}
+
+bool ReserveFlockSnapshotCapacity(struct FlockSnapshot *snapshot, const int boidsCapacity) {
+    if (snapshot == NULL) {
+        FlockLog(LOG_ERROR, "ReserveFlockSnapshotCapacity: Recieved NULL pointer to snapshot.");
+        return false;
+    }
+    if (boidsCapacity <= snapshot->boidsCapacity) {
+        return true;
+    }
+
+    if (!ResizeBoidArrays(&snapshot->boids, 0, boidsCapacity)) {
+        FlockLog(LOG_ERROR, "ReserveFlockSnapshotCapacity: Failed to allocate memory for %d boids.", boidsCapacity);
+        return false;
+    }
+    uint8_t *boidSpecies = realloc(snapshot->boidSpecies, sizeof(uint8_t) * boidsCapacity);
+    if (boidSpecies == NULL) {
+        FlockLog(LOG_ERROR, "ReserveFlockSnapshotCapacity: Failed to allocate memory for the species of %d boids.",
+                 boidsCapacity);
+        // The boid arrays were already replaced without keeping their contents
+        snapshot->boidsCount = 0;
+        return false;
+    }
+    snapshot->boidSpecies = boidSpecies;
+#ifdef DEBUG
+    struct Debug_BoidData *debug_boidData =
+        realloc(snapshot->debug_boidData, sizeof(struct Debug_BoidData) * boidsCapacity);
+    if (debug_boidData == NULL) {
+        FlockLog(LOG_ERROR,
+                 "ReserveFlockSnapshotCapacity: Failed to allocate memory for the debug data for %d boids.",
+                 boidsCapacity);
+        // The boid arrays were already replaced without keeping their contents
+        snapshot->boidsCount = 0;
+        return false;
+    }
+    snapshot->debug_boidData = debug_boidData;
+    int *debug_boidIndices = realloc(snapshot->debug_boidIndices, sizeof(int) * boidsCapacity);
+    if (debug_boidIndices == NULL) {
+        FlockLog(LOG_ERROR, "ReserveFlockSnapshotCapacity: Failed to allocate memory for the IDs of %d boids.",
+                 boidsCapacity);
+        snapshot->boidsCount = 0;
+        return false;
+    }
+    snapshot->debug_boidIndices = debug_boidIndices;
+#endif /* ifdef DEBUG */
+    snapshot->boidsCapacity = boidsCapacity;
+    snapshot->boidsCount = 0;
+
+    return true;
+}
+
+bool CopyFlockSnapshot(struct FlockSnapshot *snapshot, const struct FlockState *flockState) {
+    if (snapshot == NULL || flockState == NULL) {
+        FlockLog(LOG_ERROR, "CopyFlockSnapshot: Recieved NULL pointer.");
+        return false;
+    }
+
+    // Grow to the flock's capacity so the snapshot only reallocates when the flock does
+    const int boidsCount = flockState->boidsCount;
+    const int newCapacity = flockState->boidsCapacity > boidsCount ? flockState->boidsCapacity : boidsCount;
+    if (boidsCount > snapshot->boidsCapacity && !ReserveFlockSnapshotCapacity(snapshot, newCapacity)) {
+        FlockLog(LOG_ERROR, "CopyFlockSnapshot: Failed to grow snapshot to %d boids.", boidsCount);
+        return false;
+    }
+
+    const size_t arraySize = sizeof(float) * (size_t)boidsCount;
+    memcpy(snapshot->boids.positionsX, flockState->boids.positionsX, arraySize);
+    memcpy(snapshot->boids.positionsY, flockState->boids.positionsY, arraySize);
+    memcpy(snapshot->boids.velocitiesX, flockState->boids.velocitiesX, arraySize);
+    memcpy(snapshot->boids.velocitiesY, flockState->boids.velocitiesY, arraySize);
+    memcpy(snapshot->boidSpecies, flockState->boidSpecies, sizeof(uint8_t) * (size_t)boidsCount);
+    snapshot->boidsCount = boidsCount;
 
-    if (flockState->steeringForces != NULL) {
-        free(flockState->steeringForces);
-        flockState->steeringForces = NULL;
+    const int obstaclesCount = flockState->obstaclesCount;
+    if (obstaclesCount > snapshot->obstaclesCapacity) {
+        struct FlockObstacle *obstacles = realloc(snapshot->obstacles, sizeof(struct FlockObstacle) * obstaclesCount);
+        if (obstacles == NULL) {
+            FlockLog(LOG_ERROR, "CopyFlockSnapshot: Failed to grow snapshot to %d obstacles.", obstaclesCount);
+            snapshot->obstaclesCount = 0;
+            return false;
+        }
+        snapshot->obstacles = obstacles;
+        snapshot->obstaclesCapacity = obstaclesCount;
+    }
+    if (obstaclesCount > 0) {
+        memcpy(snapshot->obstacles, flockState->obstacles, sizeof(struct FlockObstacle) * (size_t)obstaclesCount);
+    }
+    snapshot->obstaclesCount = obstaclesCount;
+
+    snapshot->clock = flockState->clock;
+    snapshot->config = flockState->config;
+
+#ifdef PROFILER
+    snapshot->profiler = flockState->profiler;
+    snapshot->profiler.csvFile = NULL;
+#endif /* ifdef PROFILER */
+
+#ifdef DEBUG
+    memcpy(snapshot->debug_boidData, flockState->debug_boidData, sizeof(struct Debug_BoidData) * boidsCount);
+    memcpy(snapshot->debug_boidIndices, flockState->boidIndices, sizeof(int) * boidsCount);
+    snapshot->isPaused = flockState->isPaused;
+    snapshot->collisionTime = flockState->collisionTime;
+    snapshot->collisionSampleTime = flockState->collisionSampleTime;
+#endif /* ifdef DEBUG */
+
+    return true;
+}
+
+Boid GetFlockSnapshotBoid(const struct FlockSnapshot *snapshot, const int boidIndex) {
+    if (snapshot == NULL || boidIndex < 0 || boidIndex >= snapshot->boidsCount) {
+        FlockLog(LOG_ERROR, "GetFlockSnapshotBoid: Recieved invalid snapshot or boid index %d.", boidIndex);
+        return (Boid){0};
     }
+
+    return GetBoidFromArrays(&snapshot->boids, boidIndex);
+}
+
+void DestroyFlockSnapshot(struct FlockSnapshot *snapshot) {
+    if (snapshot == NULL) {
+        FlockLog(LOG_ERROR, "DestroyFlockSnapshot: Recieved NULL pointer to snapshot.");
+        return;
+    }
+
+    FreeBoidArrays(&snapshot->boids);
+    free(snapshot->boidSpecies);
+    free(snapshot->obstacles);
+#ifdef DEBUG
+    if (snapshot->debug_boidData != NULL) {
+        free(snapshot->debug_boidData);
+        snapshot->debug_boidData = NULL;
+    }
+    if (snapshot->debug_boidIndices != NULL) {
+        free(snapshot->debug_boidIndices);
+        snapshot->debug_boidIndices = NULL;
+    }
+#endif /* ifdef DEBUG */
+
+    *snapshot = (struct FlockSnapshot){0};
 }
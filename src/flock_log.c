@@ -0,0 +1,53 @@
+#include "flock_log.h"
+
+#include <raylib.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+static FlockLogCallback logCallback = NULL;
+static int minimumLogLevel = LOG_INFO;
+
+void SetFlockLogCallback(FlockLogCallback callback) {
+    logCallback = callback;
+}
+
+void SetFlockLogLevel(const int logLevel) {
+    minimumLogLevel = logLevel;
+}
+
+// Internal function that gets the prefix raylib uses for the log level
+static const char *GetLogLevelPrefix(const int logLevel) {
+    switch (logLevel) {
+    case LOG_TRACE:
+        return "TRACE: ";
+    case LOG_DEBUG:
+        return "DEBUG: ";
+    case LOG_INFO:
+        return "INFO: ";
+    case LOG_WARNING:
+        return "WARNING: ";
+    case LOG_ERROR:
+        return "ERROR: ";
+    case LOG_FATAL:
+        return "FATAL: ";
+    default:
+        return "";
+    }
+}
+
+void FlockLog(const int logLevel, const char *text, ...) {
+    if (logLevel < minimumLogLevel) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, text);
+    if (logCallback != NULL) {
+        logCallback(logLevel, text, args);
+    } else {
+        fputs(GetLogLevelPrefix(logLevel), stderr);
+        vfprintf(stderr, text, args);
+        fputc('\n', stderr);
+    }
+    va_end(args);
+}
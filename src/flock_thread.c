@@ -0,0 +1,277 @@
+#include "flock_thread.h"
+
+#include "flock.h"
+#include "flock_log.h"
+#include "trace.h"
+
+#include <pthread.h>
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Internal function that applies a command to the flock on the simulation thread
+static void ApplyFlockCommand(struct FlockThread *flockThread, const struct FlockCommand *command) {
+    struct FlockState *flockState = flockThread->flockState;
+
+    switch (command->type) {
+    case FLOCK_COMMAND_MODIFY_CONFIG:
+        if (flockThread->isFlockValid) {
+            ModifyFlockConfig(flockState, command->config);
+        }
+        break;
+    case FLOCK_COMMAND_RESET: {
+        const struct FlockConfig previousConfig = flockState->config;
+        // Whatever was attached to the flock before the thread started carries over to the new flock
+        struct TrajectoryRecorder *recorder = flockState->recorder;
+#ifdef PROFILER
+        FILE *profilerCsvFile = flockState->profiler.csvFile;
+#endif /* ifdef PROFILER */
+        // Resetting reuses the flock's memory, so respawning the same number of boids doesn't allocate
+        if (flockThread->isFlockValid) {
+            flockThread->isFlockValid = ResetFlock(flockState, command->config);
+        } else {
+            flockThread->isFlockValid = InitializeFlock(flockState, command->config);
+        }
+        if (!flockThread->isFlockValid) {
+            FlockLog(LOG_ERROR, "ApplyFlockCommand: Failed to reinitialise flock, restoring the previous config.");
+            flockThread->isFlockValid = InitializeFlock(flockState, previousConfig);
+            if (!flockThread->isFlockValid) {
+                FlockLog(LOG_FATAL, "ApplyFlockCommand: Failed to reinitialise flock.");
+            }
+        }
+        if (flockThread->isFlockValid) {
+            flockState->recorder = recorder;
+#ifdef PROFILER
+            flockState->profiler.csvFile = profilerCsvFile;
+#endif /* ifdef PROFILER */
+        }
+        break;
+    }
+    case FLOCK_COMMAND_ADD_OBSTACLE:
+        if (flockThread->isFlockValid) {
+            AddFlockObstacle(flockState, command->obstacle);
+        }
+        break;
+    case FLOCK_COMMAND_CLEAR_OBSTACLES:
+        if (flockThread->isFlockValid) {
+            SetFlockObstacles(flockState, NULL, 0);
+        }
+        break;
+#ifdef DEBUG
+    case FLOCK_COMMAND_DEBUG_SET_PAUSED:
+        flockState->isPaused = command->isPaused;
+        if (command->doStep) {
+            flockState->doStep = true;
+        }
+        break;
+#endif /* ifdef DEBUG */
+    default:
+        break;
+    }
+}
+
+// Internal function run by the simulation thread, advances the flock once per frame until the thread is stopped
+static void *FlockThreadMain(void *argument) {
+    struct FlockThread *flockThread = argument;
+    struct FlockCommand commands[FLOCK_COMMAND_QUEUE_SIZE];
+#ifdef TRACING
+    SetTraceThreadName("Simulation");
+#endif /* ifdef TRACING */
+
+    pthread_mutex_lock(&flockThread->mutex);
+    for (;;) {
+        while (!flockThread->isShuttingDown && !flockThread->isFrameStarted) {
+            pthread_cond_wait(&flockThread->frameStarted, &flockThread->mutex);
+        }
+        if (flockThread->isShuttingDown) {
+            break;
+        }
+
+        // Take this frame's inputs, commands pushed while the update runs wait for the next frame
+        const int commandsCount = flockThread->commandsCount;
+        for (int i = 0; i < commandsCount; i++) {
+            commands[i] = flockThread->commands[i];
+        }
+        flockThread->commandsCount = 0;
+        const float frameTime = flockThread->frameTime;
+        struct FlockSnapshot *backSnapshot = &flockThread->snapshots[1 - flockThread->frontSnapshot];
+        flockThread->isFrameStarted = false;
+        pthread_mutex_unlock(&flockThread->mutex);
+
+        for (int i = 0; i < commandsCount; i++) {
+            ApplyFlockCommand(flockThread, &commands[i]);
+        }
+
+        if (flockThread->isFlockValid) {
+            AdvanceFlock(flockThread->flockState, frameTime);
+            if (!CopyFlockSnapshot(backSnapshot, flockThread->flockState)) {
+                FlockLog(LOG_ERROR, "FlockThreadMain: Failed to copy the flock, the frame will be empty.");
+            }
+        } else {
+            backSnapshot->boidsCount = 0;
+        }
+
+        pthread_mutex_lock(&flockThread->mutex);
+        flockThread->isFrameFinished = true;
+        pthread_cond_signal(&flockThread->frameFinished);
+    }
+    pthread_mutex_unlock(&flockThread->mutex);
+
+    return NULL;
+}
+
+bool StartFlockThread(struct FlockThread *flockThread, struct FlockState *flockState) {
+    if (flockThread == NULL || flockState == NULL) {
+        FlockLog(LOG_ERROR, "StartFlockThread: Recieved NULL pointer.");
+        return false;
+    }
+
+    *flockThread = (struct FlockThread){
+        .flockState = flockState,
+        .isFlockValid = true,
+        .frontSnapshot = 0,
+        .commandsCount = 0,
+        .isFrameStarted = false,
+        // The back snapshot is filled in below, so the first swap doesn't have to wait for an update
+        .isFrameFinished = true,
+        .isShuttingDown = false,
+        .isRunning = false,
+    };
+
+    if (!CopyFlockSnapshot(&flockThread->snapshots[1], flockState)) {
+        FlockLog(LOG_ERROR, "StartFlockThread: Failed to copy the flock.");
+        DestroyFlockSnapshot(&flockThread->snapshots[1]);
+        return false;
+    }
+
+    if (pthread_mutex_init(&flockThread->mutex, NULL) != 0) {
+        FlockLog(LOG_ERROR, "StartFlockThread: Failed to create mutex.");
+        DestroyFlockSnapshot(&flockThread->snapshots[1]);
+        return false;
+    }
+    if (pthread_cond_init(&flockThread->frameStarted, NULL) != 0) {
+        FlockLog(LOG_ERROR, "StartFlockThread: Failed to create condition variable.");
+        pthread_mutex_destroy(&flockThread->mutex);
+        DestroyFlockSnapshot(&flockThread->snapshots[1]);
+        return false;
+    }
+    if (pthread_cond_init(&flockThread->frameFinished, NULL) != 0) {
+        FlockLog(LOG_ERROR, "StartFlockThread: Failed to create condition variable.");
+        pthread_cond_destroy(&flockThread->frameStarted);
+        pthread_mutex_destroy(&flockThread->mutex);
+        DestroyFlockSnapshot(&flockThread->snapshots[1]);
+        return false;
+    }
+
+    if (pthread_create(&flockThread->thread, NULL, FlockThreadMain, flockThread) != 0) {
+        FlockLog(LOG_ERROR, "StartFlockThread: Failed to create the simulation thread.");
+        pthread_cond_destroy(&flockThread->frameFinished);
+        pthread_cond_destroy(&flockThread->frameStarted);
+        pthread_mutex_destroy(&flockThread->mutex);
+        DestroyFlockSnapshot(&flockThread->snapshots[1]);
+        return false;
+    }
+
+    flockThread->isRunning = true;
+    return true;
+}
+
+const struct FlockSnapshot *SwapFlockThread(struct FlockThread *flockThread, const float frameTime) {
+    if (flockThread == NULL || !flockThread->isRunning) {
+        FlockLog(LOG_ERROR, "SwapFlockThread: Recieved NULL pointer or stopped thread.");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&flockThread->mutex);
+    while (!flockThread->isFrameFinished) {
+        pthread_cond_wait(&flockThread->frameFinished, &flockThread->mutex);
+    }
+
+    flockThread->frontSnapshot = 1 - flockThread->frontSnapshot;
+    struct FlockSnapshot *frontSnapshot = &flockThread->snapshots[flockThread->frontSnapshot];
+
+    // The queued commands were pushed after the snapshot was taken, show them as if they were already applied so the
+    // GUI doesn't send the old values back
+    for (int i = 0; i < flockThread->commandsCount; i++) {
+        const struct FlockCommand *command = &flockThread->commands[i];
+        switch (command->type) {
+        case FLOCK_COMMAND_MODIFY_CONFIG:
+        case FLOCK_COMMAND_RESET:
+            frontSnapshot->config = command->config;
+            break;
+#ifdef DEBUG
+        case FLOCK_COMMAND_DEBUG_SET_PAUSED:
+            frontSnapshot->isPaused = command->isPaused;
+            break;
+#endif /* ifdef DEBUG */
+        default:
+            break;
+        }
+    }
+
+    flockThread->frameTime = frameTime;
+    flockThread->isFrameStarted = true;
+    flockThread->isFrameFinished = false;
+    pthread_cond_signal(&flockThread->frameStarted);
+    pthread_mutex_unlock(&flockThread->mutex);
+
+    return frontSnapshot;
+}
+
+void PushFlockCommand(struct FlockThread *flockThread, const struct FlockCommand command) {
+    if (flockThread == NULL || !flockThread->isRunning) {
+        FlockLog(LOG_ERROR, "PushFlockCommand: Recieved NULL pointer or stopped thread.");
+        return;
+    }
+
+    pthread_mutex_lock(&flockThread->mutex);
+
+    // Merge with the last command when it is the same kind, only the latest config matters
+    struct FlockCommand *lastCommand =
+        flockThread->commandsCount > 0 ? &flockThread->commands[flockThread->commandsCount - 1] : NULL;
+    if (lastCommand != NULL && lastCommand->type == command.type && command.type == FLOCK_COMMAND_MODIFY_CONFIG) {
+        lastCommand->config = command.config;
+#ifdef DEBUG
+    } else if (lastCommand != NULL && lastCommand->type == command.type &&
+               command.type == FLOCK_COMMAND_DEBUG_SET_PAUSED) {
+        // A step request must not be lost by merging
+        lastCommand->isPaused = command.isPaused;
+        lastCommand->doStep = lastCommand->doStep || command.doStep;
+#endif /* ifdef DEBUG */
+    } else if (flockThread->commandsCount < FLOCK_COMMAND_QUEUE_SIZE) {
+        flockThread->commands[flockThread->commandsCount++] = command;
+    } else {
+        FlockLog(LOG_WARNING, "PushFlockCommand: Command queue is full, dropping command.");
+    }
+
+    pthread_mutex_unlock(&flockThread->mutex);
+}
+
+void StopFlockThread(struct FlockThread *flockThread) {
+    if (flockThread == NULL) {
+        FlockLog(LOG_ERROR, "StopFlockThread: Recieved NULL pointer to flockThread.");
+        return;
+    }
+    if (!flockThread->isRunning) {
+        return;
+    }
+
+    pthread_mutex_lock(&flockThread->mutex);
+    while (!flockThread->isFrameFinished) {
+        pthread_cond_wait(&flockThread->frameFinished, &flockThread->mutex);
+    }
+    flockThread->isShuttingDown = true;
+    pthread_cond_signal(&flockThread->frameStarted);
+    pthread_mutex_unlock(&flockThread->mutex);
+
+    pthread_join(flockThread->thread, NULL);
+
+    pthread_cond_destroy(&flockThread->frameFinished);
+    pthread_cond_destroy(&flockThread->frameStarted);
+    pthread_mutex_destroy(&flockThread->mutex);
+
+    DestroyFlockSnapshot(&flockThread->snapshots[0]);
+    DestroyFlockSnapshot(&flockThread->snapshots[1]);
+
+    flockThread->isRunning = false;
+}
@@ -0,0 +1,444 @@
+#include "grid.h"
+
+#include "arena.h"
+#include "boid.h"
+#include "flock_log.h"
+
+#include <math.h>
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Internal function that gets the number of cells a grid for the given number of boids has room for
+static int GetSpatialGridCellsCapacity(const int boidsCapacity) {
+    const int cellsCapacity = boidsCapacity * SPATIAL_GRID_MAX_CELLS_PER_BOID;
+    return cellsCapacity < SPATIAL_GRID_MIN_CELLS ? SPATIAL_GRID_MIN_CELLS : cellsCapacity;
+}
+
+// Internal function that gets the number of hash map slots a sparse grid for the given number of boids has, always a
+// power of two so a hash can be masked to a slot
+static uint32_t GetSpatialGridCellSlotsCount(const int boidsCapacity) {
+    const long long minimumSlotsCount = (long long)boidsCapacity * SPATIAL_GRID_CELL_SLOTS_PER_BOID;
+    uint32_t slotsCount = SPATIAL_GRID_MIN_CELLS;
+    while ((long long)slotsCount < minimumSlotsCount) {
+        slotsCount *= 2U;
+    }
+    return slotsCount;
+}
+
+bool InitializeSpatialGrid(struct SpatialGrid *grid, const int boidsCapacity) {
+    if (grid == NULL) {
+        FlockLog(LOG_ERROR, "InitializeSpatialGrid: Recieved NULL pointer to grid.");
+        return false;
+    }
+
+    const int cellsCapacity = GetSpatialGridCellsCapacity(boidsCapacity);
+    const uint32_t cellSlotsCount = GetSpatialGridCellSlotsCount(boidsCapacity);
+    *grid = (struct SpatialGrid){
+        .cellStarts = malloc(sizeof(int) * (cellsCapacity + 1)),
+        .cellsCapacity = cellsCapacity,
+        // Every slot starts out free
+        .cellSlots = calloc(cellSlotsCount, sizeof(struct SpatialGridCellSlot)),
+        .cellSlotsMask = cellSlotsCount - 1U,
+        .sortedIndices = malloc(sizeof(int) * boidsCapacity),
+        .boidCells = malloc(sizeof(int) * boidsCapacity),
+        .boidsCapacity = boidsCapacity,
+    };
+
+    if (grid->cellStarts == NULL || grid->cellSlots == NULL || !AllocateBoidArrays(&grid->sortedBoids, boidsCapacity) ||
+        grid->sortedIndices == NULL || grid->boidCells == NULL) {
+        FlockLog(LOG_ERROR, "InitializeSpatialGrid: Failed to allocate memory for a grid of %d boids.", boidsCapacity);
+        DestroySpatialGrid(grid);
+        return false;
+    }
+    OverlayCompactBoidArrays(&grid->compactBoids, &grid->sortedBoids, boidsCapacity);
+
+    return true;
+}
+
+// Internal function that gets the column of the cell containing the x coordinate, clamped to the grid
+static int GetSpatialGridColumn(const struct SpatialGrid *grid, const float x) {
+    const float column = floorf((x - grid->bounds.x) / grid->cellSize);
+    if (column < 0.F) {
+        return 0;
+    }
+    if (column >= (float)grid->columns) {
+        return grid->columns - 1;
+    }
+    return (int)column;
+}
+
+// Internal function that gets the row of the cell containing the y coordinate, clamped to the grid
+static int GetSpatialGridRow(const struct SpatialGrid *grid, const float y) {
+    const float row = floorf((y - grid->bounds.y) / grid->cellSize);
+    if (row < 0.F) {
+        return 0;
+    }
+    if (row >= (float)grid->rows) {
+        return grid->rows - 1;
+    }
+    return (int)row;
+}
+
+// Internal function that checks the arguments shared by the build functions, logging the error for the named function
+static bool CanBuildSpatialGrid(const struct SpatialGrid *grid, const struct BoidArrays *boids, const int layersCount,
+                                const int boidsCount, const char *functionName) {
+    if (grid == NULL || boids == NULL) {
+        FlockLog(LOG_ERROR, "%s: Recieved NULL pointer.", functionName);
+        return false;
+    }
+    if (boidsCount > grid->boidsCapacity) {
+        FlockLog(LOG_ERROR, "%s: %d boids exceeds the grid capacity of %d.", functionName, boidsCount,
+                 grid->boidsCapacity);
+        return false;
+    }
+    if (layersCount < 1 || layersCount > SPATIAL_GRID_MAX_LAYERS) {
+        FlockLog(LOG_ERROR, "%s: The number of layers must be between 1 and %d, got %d.", functionName,
+                 SPATIAL_GRID_MAX_LAYERS, layersCount);
+        return false;
+    }
+    return true;
+}
+
+// Internal function that sizes the cells for the bounds and counts the boids into them, leaving cellStarts[c] at the
+// start of cell c for the boids to be copied in with
+static void CountSpatialGridCells(struct SpatialGrid *grid, const struct BoidArrays *boids, const uint8_t *boidLayers,
+                                  const int layersCount, const int boidsCount, const Rectangle bounds,
+                                  const float minimumCellSize) {
+    // Use the smallest cell size that fits the cell capacity, cells smaller than the minimum would miss neighbours
+    // but larger cells only cost extra distance checks. Each layer only holds its share of the boids, so it only gets
+    // its share of the cells.
+    const int layerCellsCapacity = grid->cellsCapacity / layersCount;
+    float cellSize = sqrtf((bounds.width * bounds.height) / (float)layerCellsCapacity);
+    if (cellSize < minimumCellSize) {
+        cellSize = minimumCellSize;
+    }
+    double columns = ceil(bounds.width / cellSize);
+    double rows = ceil(bounds.height / cellSize);
+    // Rounding up can push the cell count over the capacity
+    while (columns * rows > (double)layerCellsCapacity) {
+        cellSize *= 1.25F;
+        columns = ceil(bounds.width / cellSize);
+        rows = ceil(bounds.height / cellSize);
+    }
+
+    grid->bounds = bounds;
+    grid->cellSize = cellSize;
+    grid->columns = columns < 1.0 ? 1 : (int)columns;
+    grid->rows = rows < 1.0 ? 1 : (int)rows;
+    grid->layersCount = layersCount;
+    grid->isSparse = false;
+
+    const int layerCellsCount = grid->columns * grid->rows;
+    const int cellsCount = layerCellsCount * layersCount;
+    grid->cellsCount = cellsCount;
+
+    // Counting sort of the boids by cell, first count the boids in each cell (offset by one)...
+    memset(grid->cellStarts, 0, sizeof(int) * (cellsCount + 1));
+    for (int i = 0; i < boidsCount; i++) {
+        int cell = (GetSpatialGridRow(grid, boids->positionsY[i]) * grid->columns) +
+                   GetSpatialGridColumn(grid, boids->positionsX[i]);
+        if (boidLayers != NULL) {
+            cell += boidLayers[i] * layerCellsCount;
+        }
+        grid->boidCells[i] = cell;
+        grid->cellStarts[cell + 1]++;
+    }
+
+    // ...then turn the counts into the index of the first boid of each cell...
+    for (int cell = 1; cell <= cellsCount; cell++) {
+        grid->cellStarts[cell] += grid->cellStarts[cell - 1];
+    }
+}
+
+// Internal function that shifts the cell starts back after they were used as write cursors
+static void RestoreSpatialGridCellStarts(struct SpatialGrid *grid) {
+    for (int cell = grid->cellsCount; cell > 0; cell--) {
+        grid->cellStarts[cell] = grid->cellStarts[cell - 1];
+    }
+    grid->cellStarts[0] = 0;
+}
+
+// Internal function that gets the coordinate of the sparse grid cell containing the value, clamped far enough inside
+// the range of an int that the cells around it can be found too
+static int32_t GetSparseSpatialGridCoordinate(const struct SpatialGrid *grid, const float value) {
+    const float coordinate = floorf(value / grid->cellSize);
+    // Also catches NaN
+    if (!(coordinate > -1073741824.F)) {
+        return -1073741824;
+    }
+    if (coordinate > 1073741824.F) {
+        return 1073741824;
+    }
+    return (int32_t)coordinate;
+}
+
+// Internal function that gets the first slot to look for a cell in, the slots after it are tried in turn
+static uint32_t GetSpatialGridCellSlot(const struct SpatialGrid *grid, const int32_t column, const int32_t row,
+                                       const int32_t layer) {
+    uint32_t hash = ((uint32_t)column * 0x9E3779B1U) ^ ((uint32_t)row * 0x85EBCA77U) ^ ((uint32_t)layer * 0xC2B2AE3DU);
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352DU;
+    hash ^= hash >> 15;
+    return hash & grid->cellSlotsMask;
+}
+
+// Internal function that finds the cell with the given coordinates in a sparse grid, returns -1 if it holds no boids
+static int FindSparseSpatialGridCell(const struct SpatialGrid *grid, const int32_t column, const int32_t row,
+                                     const int32_t layer) {
+    for (uint32_t slot = GetSpatialGridCellSlot(grid, column, row, layer);; slot = (slot + 1U) & grid->cellSlotsMask) {
+        const struct SpatialGridCellSlot *cellSlot = &grid->cellSlots[slot];
+        if (cellSlot->generation != grid->generation) {
+            return -1;
+        }
+        if (cellSlot->column == column && cellSlot->row == row && cellSlot->layer == layer) {
+            return cellSlot->cell;
+        }
+    }
+}
+
+// Internal function that counts the boids into the cells of a sparse grid, making each cell the first time a boid is
+// found in it. Leaves cellStarts[c] at the start of cell c, like CountSpatialGridCells.
+static void CountSparseSpatialGridCells(struct SpatialGrid *grid, const struct BoidArrays *boids,
+                                        const uint8_t *boidLayers, const int layersCount, const int boidsCount,
+                                        const float minimumCellSize) {
+    grid->bounds = (Rectangle){0};
+    // Also catches NaN
+    grid->cellSize = fmaxf(minimumCellSize, SPATIAL_GRID_MIN_SPARSE_CELL_SIZE);
+    grid->columns = 0;
+    grid->rows = 0;
+    grid->layersCount = layersCount;
+    grid->isSparse = true;
+
+    // Starting a new generation frees every slot at once, they only have to be cleared when it wraps around
+    grid->generation++;
+    if (grid->generation == 0U) {
+        memset(grid->cellSlots, 0, sizeof(struct SpatialGridCellSlot) * ((size_t)grid->cellSlotsMask + 1U));
+        grid->generation = 1U;
+    }
+
+    // There are never more cells than boids, and the map is at most half full, so looking for a free slot always ends
+    int cellsCount = 0;
+    grid->cellStarts[0] = 0;
+    for (int i = 0; i < boidsCount; i++) {
+        const int32_t column = GetSparseSpatialGridCoordinate(grid, boids->positionsX[i]);
+        const int32_t row = GetSparseSpatialGridCoordinate(grid, boids->positionsY[i]);
+        const int32_t layer = boidLayers != NULL ? boidLayers[i] : 0;
+
+        uint32_t slot = GetSpatialGridCellSlot(grid, column, row, layer);
+        struct SpatialGridCellSlot *cellSlot = &grid->cellSlots[slot];
+        while (cellSlot->generation == grid->generation &&
+               (cellSlot->column != column || cellSlot->row != row || cellSlot->layer != layer)) {
+            slot = (slot + 1U) & grid->cellSlotsMask;
+            cellSlot = &grid->cellSlots[slot];
+        }
+        if (cellSlot->generation != grid->generation) {
+            *cellSlot = (struct SpatialGridCellSlot){
+                .column = column,
+                .row = row,
+                .generation = grid->generation,
+                .layer = layer,
+                .cell = cellsCount,
+            };
+            grid->cellStarts[++cellsCount] = 0;
+        }
+
+        grid->boidCells[i] = cellSlot->cell;
+        grid->cellStarts[cellSlot->cell + 1]++;
+    }
+    grid->cellsCount = cellsCount;
+
+    for (int cell = 1; cell <= cellsCount; cell++) {
+        grid->cellStarts[cell] += grid->cellStarts[cell - 1];
+    }
+}
+
+// Internal function that copies each boid into its cell, using the cell starts as write cursors (which leaves each one
+// at the start of the next cell), and then shifts the cursors back to the cell starts
+static void FillSpatialGridCells(struct SpatialGrid *grid, const struct BoidArrays *boids, const int boidsCount) {
+    for (int i = 0; i < boidsCount; i++) {
+        const int sortedIndex = grid->cellStarts[grid->boidCells[i]]++;
+        grid->sortedBoids.positionsX[sortedIndex] = boids->positionsX[i];
+        grid->sortedBoids.positionsY[sortedIndex] = boids->positionsY[i];
+        grid->sortedBoids.velocitiesX[sortedIndex] = boids->velocitiesX[i];
+        grid->sortedBoids.velocitiesY[sortedIndex] = boids->velocitiesY[i];
+        grid->sortedIndices[sortedIndex] = i;
+    }
+
+    RestoreSpatialGridCellStarts(grid);
+    grid->isCompact = false;
+}
+
+void BuildSpatialGrid(struct SpatialGrid *grid, const struct BoidArrays *boids, const uint8_t *boidLayers,
+                      const int layersCount, const int boidsCount, const Rectangle bounds,
+                      const float minimumCellSize) {
+    if (!CanBuildSpatialGrid(grid, boids, layersCount, boidsCount, "BuildSpatialGrid")) {
+        return;
+    }
+
+    CountSpatialGridCells(grid, boids, boidLayers, layersCount, boidsCount, bounds, minimumCellSize);
+    FillSpatialGridCells(grid, boids, boidsCount);
+}
+
+void BuildSparseSpatialGrid(struct SpatialGrid *grid, const struct BoidArrays *boids, const uint8_t *boidLayers,
+                            const int layersCount, const int boidsCount, const float minimumCellSize) {
+    if (!CanBuildSpatialGrid(grid, boids, layersCount, boidsCount, "BuildSparseSpatialGrid")) {
+        return;
+    }
+
+    CountSparseSpatialGridCells(grid, boids, boidLayers, layersCount, boidsCount, minimumCellSize);
+    FillSpatialGridCells(grid, boids, boidsCount);
+}
+
+void BuildCompactSpatialGrid(struct SpatialGrid *grid, const struct BoidArrays *boids, const uint8_t *boidLayers,
+                             const int layersCount, const int boidsCount, const Rectangle bounds,
+                             const float minimumCellSize) {
+    if (!CanBuildSpatialGrid(grid, boids, layersCount, boidsCount, "BuildCompactSpatialGrid")) {
+        return;
+    }
+
+    CountSpatialGridCells(grid, boids, boidLayers, layersCount, boidsCount, bounds, minimumCellSize);
+
+    // Same as BuildSpatialGrid, except that the copies are packed on the way in
+    struct CompactBoidArrays *compactBoids = &grid->compactBoids;
+    compactBoids->positionOrigin = (Vector2){.x = bounds.x, .y = bounds.y};
+    compactBoids->positionScale = (Vector2){
+        .x = bounds.width / (float)COMPACT_BOID_POSITION_MAX,
+        .y = bounds.height / (float)COMPACT_BOID_POSITION_MAX,
+    };
+    const float inverseScaleX = 1.F / compactBoids->positionScale.x;
+    const float inverseScaleY = 1.F / compactBoids->positionScale.y;
+    for (int i = 0; i < boidsCount; i++) {
+        const int sortedIndex = grid->cellStarts[grid->boidCells[i]]++;
+        compactBoids->positionsX[sortedIndex] = PackBoidPosition(boids->positionsX[i], bounds.x, inverseScaleX);
+        compactBoids->positionsY[sortedIndex] = PackBoidPosition(boids->positionsY[i], bounds.y, inverseScaleY);
+        compactBoids->velocitiesX[sortedIndex] = PackBoidVelocity(boids->velocitiesX[i]);
+        compactBoids->velocitiesY[sortedIndex] = PackBoidVelocity(boids->velocitiesY[i]);
+        grid->sortedIndices[sortedIndex] = i;
+    }
+
+    RestoreSpatialGridCellStarts(grid);
+    grid->isCompact = true;
+}
+
+// Internal function that gets the spans of the cells around the position in a sparse grid, each cell that holds boids
+// is looked up on its own but cells that follow each other in cell order are joined into one span
+static int GetSparseSpatialGridNeighbourSpans(const struct SpatialGrid *grid, const Vector2 position,
+                                              struct SpatialGridSpan spans[SPATIAL_GRID_MAX_SPANS]) {
+    const int32_t column = GetSparseSpatialGridCoordinate(grid, position.x);
+    const int32_t row = GetSparseSpatialGridCoordinate(grid, position.y);
+
+    int spansCount = 0;
+    for (int32_t layer = 0; layer < grid->layersCount; layer++) {
+        for (int32_t r = row - 1; r <= row + 1; r++) {
+            for (int32_t c = column - 1; c <= column + 1; c++) {
+                const int cell = FindSparseSpatialGridCell(grid, c, r, layer);
+                if (cell < 0) {
+                    continue;
+                }
+                const int start = grid->cellStarts[cell];
+                const int end = grid->cellStarts[cell + 1];
+                if (spansCount > 0 && spans[spansCount - 1].layer == layer && spans[spansCount - 1].end == start) {
+                    spans[spansCount - 1].end = end;
+                } else {
+                    spans[spansCount++] = (struct SpatialGridSpan){.start = start, .end = end, .layer = layer};
+                }
+            }
+        }
+    }
+
+    return spansCount;
+}
+
+int GetSpatialGridNeighbourSpans(const struct SpatialGrid *grid, const Vector2 position,
+                                 struct SpatialGridSpan spans[SPATIAL_GRID_MAX_SPANS]) {
+    if (grid->isSparse) {
+        return GetSparseSpatialGridNeighbourSpans(grid, position, spans);
+    }
+
+    const int column = GetSpatialGridColumn(grid, position.x);
+    const int row = GetSpatialGridRow(grid, position.y);
+
+    const int firstColumn = column > 0 ? column - 1 : 0;
+    const int lastColumn = column < grid->columns - 1 ? column + 1 : column;
+    const int firstRow = row > 0 ? row - 1 : 0;
+    const int lastRow = row < grid->rows - 1 ? row + 1 : row;
+
+    // Cells are stored row-major so the three adjacent cells of each row form one span
+    const int layerCellsCount = grid->columns * grid->rows;
+    int spansCount = 0;
+    for (int layer = 0; layer < grid->layersCount; layer++) {
+        const int *layerCellStarts = &grid->cellStarts[layer * layerCellsCount];
+        for (int r = firstRow; r <= lastRow; r++) {
+            spans[spansCount++] = (struct SpatialGridSpan){
+                .start = layerCellStarts[(r * grid->columns) + firstColumn],
+                .end = layerCellStarts[(r * grid->columns) + lastColumn + 1],
+                .layer = layer,
+            };
+        }
+    }
+
+    return spansCount;
+}
+
+size_t GetSpatialGridArenaSize(const int boidsCapacity) {
+    return GetArenaAllocationSize(sizeof(int) * (size_t)(GetSpatialGridCellsCapacity(boidsCapacity) + 1)) +
+           GetArenaAllocationSize(sizeof(struct SpatialGridCellSlot) * GetSpatialGridCellSlotsCount(boidsCapacity)) +
+           GetBoidArraysArenaSize(boidsCapacity) + (GetArenaAllocationSize(sizeof(int) * (size_t)boidsCapacity) * 2);
+}
+
+bool InitializeSpatialGridFromArena(struct SpatialGrid *grid, struct Arena *arena, const int boidsCapacity) {
+    if (grid == NULL || arena == NULL) {
+        FlockLog(LOG_ERROR, "InitializeSpatialGridFromArena: Recieved NULL pointer.");
+        return false;
+    }
+
+    const int cellsCapacity = GetSpatialGridCellsCapacity(boidsCapacity);
+    const uint32_t cellSlotsCount = GetSpatialGridCellSlotsCount(boidsCapacity);
+    *grid = (struct SpatialGrid){
+        .cellStarts = AllocateFromArena(arena, sizeof(int) * (size_t)(cellsCapacity + 1)),
+        .cellsCapacity = cellsCapacity,
+        .cellSlots = AllocateFromArena(arena, sizeof(struct SpatialGridCellSlot) * cellSlotsCount),
+        .cellSlotsMask = cellSlotsCount - 1U,
+        .boidsCapacity = boidsCapacity,
+        .isInArena = true,
+    };
+    const bool areBoidsAllocated = AllocateBoidArraysFromArena(&grid->sortedBoids, arena, boidsCapacity);
+    grid->sortedIndices = AllocateFromArena(arena, sizeof(int) * (size_t)boidsCapacity);
+    grid->boidCells = AllocateFromArena(arena, sizeof(int) * (size_t)boidsCapacity);
+
+    if (grid->cellStarts == NULL || grid->cellSlots == NULL || !areBoidsAllocated || grid->sortedIndices == NULL ||
+        grid->boidCells == NULL) {
+        FlockLog(LOG_ERROR, "InitializeSpatialGridFromArena: The arena has no room for a grid of %d boids.",
+                 boidsCapacity);
+        *grid = (struct SpatialGrid){0};
+        return false;
+    }
+    // Arenas are reused, so every slot has to be freed
+    memset(grid->cellSlots, 0, sizeof(struct SpatialGridCellSlot) * cellSlotsCount);
+    OverlayCompactBoidArrays(&grid->compactBoids, &grid->sortedBoids, boidsCapacity);
+
+    return true;
+}
+
+void DestroySpatialGrid(struct SpatialGrid *grid) {
+    if (grid == NULL) {
+        FlockLog(LOG_ERROR, "DestroySpatialGrid: Recieved NULL pointer to grid.");
+        return;
+    }
+
+    if (grid->isInArena) {
+        *grid = (struct SpatialGrid){0};
+        return;
+    }
+
+    free(grid->cellStarts);
+    free(grid->cellSlots);
+    FreeBoidArrays(&grid->sortedBoids);
+    free(grid->sortedIndices);
+    free(grid->boidCells);
+
+    *grid = (struct SpatialGrid){0};
+}
@@ -18,12 +18,18 @@ struct GuiConfig CreateDefaultGuiConfig(float screenHeight) {
 #ifdef DEBUG
     numTabs += 1;
 #endif /* ifdef DEBUG */
+#ifdef PROFILER
+    numTabs += 1;
+#endif /* ifdef PROFILER */
 
     static const char *tabLabels[] = {
         [PARAMETERS_TAB] = "Parameters",
 #ifdef DEBUG
         [DEBUG_INSPECTION_TAB] = "Inspect",
 #endif /* ifdef DEBUG */
+#ifdef PROFILER
+        [PROFILER_TAB] = "Profile",
+#endif /* ifdef PROFILER */
     };
 
     return (struct GuiConfig){
@@ -55,6 +61,20 @@ void InitializeGui(struct GuiState *guiState, const struct GuiConfig config) {
             },
         .config = config,
         .showFPS = false,
+        .isFlockReadOnly = false,
+        .camera = (Camera2D){.zoom = 1.F},
+        .editedSpecies = 0,
+        .editedOtherSpecies = 0,
+#ifdef PROFILER
+        .profilerPanelState =
+            (struct PanelState){
+                .currentId = 0,
+                .activeId = 0,
+                .heightOffset = 0,
+                .config = &guiState->config,
+            },
+        .frameProfiler = NULL,
+#endif /* ifdef PROFILER */
 #ifdef DEBUG
         .debug_inspectionPanelState =
             (struct PanelState){
@@ -63,7 +83,7 @@ void InitializeGui(struct GuiState *guiState, const struct GuiConfig config) {
                 .heightOffset = 0,
                 .config = &guiState->config,
             },
-        .debug_inspectedBoidIndex = 0,
+        .debug_inspectedBoidId = 0,
         .debug_showRanges = false,
         .debug_showVelocity = false,
 #endif /* ifdef DEBUG */
@@ -235,20 +255,22 @@ static void PanelValueVector2(const char *label, const Vector2 *value, bool disp
 
     state->heightOffset += bounds.height + config->padding;
 }
-struct ParametersPanelResult DrawParametersPanel(struct GuiState *guiState, const struct FlockState *flockState) {
+struct ParametersPanelResult DrawParametersPanel(struct GuiState *guiState,
+                                                 const struct FlockSnapshot *flockSnapshot) {
     struct PanelState *panelState = &guiState->parametersPanelState;
     struct ParametersPanelResult result = {
         .resetBoids = false,
-        .hasFlockConfigChanged = true,
-        .newFlockConfig = flockState->config,
+        .clearObstacles = false,
+        .hasFlockConfigChanged = !guiState->isFlockReadOnly,
+        .newFlockConfig = flockSnapshot->config,
     };
 
     if (guiState == NULL) {
         TraceLog(LOG_ERROR, "DrawParametersPanel: Recieved NULL pointer to parametersPanelState.");
         return result;
     }
-    if (flockState == NULL) {
-        TraceLog(LOG_ERROR, "DrawParametersPanel: Recieved NULL pointer to flockState.");
+    if (flockSnapshot == NULL) {
+        TraceLog(LOG_ERROR, "DrawParametersPanel: Recieved NULL pointer to flockSnapshot.");
         return result;
     }
 
@@ -264,15 +286,21 @@ struct ParametersPanelResult DrawParametersPanel(struct GuiState *guiState, cons
     // Set the initial height offset
     guiState->parametersPanelState.heightOffset = 25.F + guiState->config.padding;
 
+    if (guiState->isFlockReadOnly) {
+        GuiDisable();
+    }
+
     PanelHeader("Force Factors", panelState);
     PanelParameterFloat("Separation", &result.newFlockConfig.separationFactor, 100.F, 0, 10000, panelState);
     PanelParameterFloat("Alignment", &result.newFlockConfig.alignmentFactor, 100.F, 0, 10000, panelState);
     PanelParameterFloat("Cohesion", &result.newFlockConfig.cohesionFactor, 100.F, 0, 10000, panelState);
+    PanelParameterFloat("Obstacles", &result.newFlockConfig.obstacleAvoidanceFactor, 100.F, 0, 10000, panelState);
 
     PanelHeader("Force Ranges", panelState);
     PanelParameterFloat("Separation", &result.newFlockConfig.separationRange, 1.F, 0, 1000, panelState);
     PanelParameterFloat("Alignment", &result.newFlockConfig.alignmentRange, 1.F, 0, 1000, panelState);
     PanelParameterFloat("Cohesion", &result.newFlockConfig.cohesionRange, 1.F, 0, 1000, panelState);
+    PanelParameterFloat("Obstacles", &result.newFlockConfig.obstacleAvoidanceRange, 1.F, 0, 1000, panelState);
 
     PanelParameterBool("Normalise Forces", &result.newFlockConfig.normalizeForces, panelState);
 
@@ -283,23 +311,119 @@ struct ParametersPanelResult DrawParametersPanel(struct GuiState *guiState, cons
     }
     PanelParameterFloat("Minimum Speed", &result.newFlockConfig.minimumSpeed, 1.F, 0, 1000, panelState);
     PanelParameterFloat("Maximum Speed", &result.newFlockConfig.maximumSpeed, 1.F, 0, 1000, panelState);
-    GuiEnable();
+    if (!guiState->isFlockReadOnly) {
+        GuiEnable();
+    }
 
     PanelHeader("Boids", panelState);
-    PanelParameterInt("Number of Boids", &result.newFlockConfig.numberOfBoids, 1, 10000, panelState);
+    // Changing the number resizes the flock in place (see ResizeFlock), the other boids carry on as they were
+    PanelParameterInt("Number of Boids", &result.newFlockConfig.numberOfBoids, 1, 1000000, panelState);
     // Although the minimum is 1, deleting all the digits in the spinner still returns 0
     if (result.newFlockConfig.numberOfBoids <= 0) {
         result.newFlockConfig.numberOfBoids = 1;
     }
-    // Reset boids when the number is changed to prevent buffer overflow.
-    // TODO: Change to dynamically resize the buffer.
-    if (flockState->config.numberOfBoids != result.newFlockConfig.numberOfBoids) {
-        result.resetBoids = true;
-    }
+    // Boids that have flown off return to the bounds when it is turned off again
+    PanelParameterBool("Open World", &result.newFlockConfig.useOpenWorld, panelState);
 
     if (PanelButton("Reset Boids", panelState)) {
         result.resetBoids = true;
     }
+    // Obstacles are placed with the O key
+    if (PanelButton(TextFormat("Clear %d Obstacles", flockSnapshot->obstaclesCount), panelState)) {
+        result.clearObstacles = true;
+    }
+
+    PanelHeader("Species", panelState);
+    PanelParameterInt("Species", &result.newFlockConfig.speciesCount, 1, FLOCK_MAX_SPECIES, panelState);
+    if (result.newFlockConfig.speciesCount <= 0) {
+        result.newFlockConfig.speciesCount = 1;
+    }
+    const int lastSpecies = result.newFlockConfig.speciesCount - 1;
+
+    // One species and how it reacts to one other species (or itself) are edited at a time
+    PanelParameterInt("Edit Species", &guiState->editedSpecies, 0, lastSpecies, panelState);
+    // The spinners can be left past the last species when the number of species goes down
+    if (guiState->editedSpecies < 0 || guiState->editedSpecies > lastSpecies) {
+        guiState->editedSpecies = 0;
+    }
+    struct FlockSpeciesConfig *species = &result.newFlockConfig.species[guiState->editedSpecies];
+    PanelParameterFloat("Speed Factor", &species->speedFactor, 100.F, 1, 1000, panelState);
+    if (species->speedFactor <= 0.F) {
+        species->speedFactor = 0.01F;
+    }
+    PanelParameterInt("Towards Species", &guiState->editedOtherSpecies, 0, lastSpecies, panelState);
+    if (guiState->editedOtherSpecies < 0 || guiState->editedOtherSpecies > lastSpecies) {
+        guiState->editedOtherSpecies = 0;
+    }
+    const int other = guiState->editedOtherSpecies;
+    PanelParameterFloat("Separation", &species->separationWeights[other], 100.F, -1000, 1000, panelState);
+    PanelParameterFloat("Alignment", &species->alignmentWeights[other], 100.F, -1000, 1000, panelState);
+    PanelParameterFloat("Cohesion", &species->cohesionWeights[other], 100.F, -1000, 1000, panelState);
+
+    PanelHeader("Performance", panelState);
+    PanelParameterInt("Threads", &result.newFlockConfig.threadCount, 1, 64, panelState);
+    if (result.newFlockConfig.threadCount <= 0) {
+        result.newFlockConfig.threadCount = 1;
+    }
+
+    // The quadtree and the neighbour lists aren't used with more than one species
+    const bool hasSpecies = result.newFlockConfig.speciesCount > 1;
+    if (hasSpecies) {
+        GuiDisable();
+    }
+    PanelParameterBool("Quadtree", &result.newFlockConfig.useQuadtree, panelState);
+    if (!result.newFlockConfig.useQuadtree) {
+        GuiDisable();
+    }
+    PanelParameterFloat("Opening Angle", &result.newFlockConfig.quadtreeOpeningAngle, 100.F, 0, 200, panelState);
+    if (!guiState->isFlockReadOnly) {
+        GuiEnable();
+    }
+
+    // Compact storage packs positions across the bounds, so it isn't used in an open world
+    const bool useCompactStorage = result.newFlockConfig.useCompactStorage && !result.newFlockConfig.useOpenWorld;
+    if (result.newFlockConfig.useOpenWorld) {
+        GuiDisable();
+    }
+    PanelParameterBool("Compact Storage", &result.newFlockConfig.useCompactStorage, panelState);
+    if (!guiState->isFlockReadOnly) {
+        GuiEnable();
+    }
+
+    // Neighbour lists aren't used with compact storage either
+    if (useCompactStorage || hasSpecies) {
+        GuiDisable();
+    }
+    PanelParameterBool("Neighbour Lists", &result.newFlockConfig.useNeighbourLists, panelState);
+    if (!result.newFlockConfig.useNeighbourLists) {
+        GuiDisable();
+    }
+    PanelParameterFloat("List Skin", &result.newFlockConfig.neighbourListSkin, 1.F, 0, 200, panelState);
+    if (!guiState->isFlockReadOnly) {
+        GuiEnable();
+    }
+
+    PanelParameterInt("Steering Interval", &result.newFlockConfig.steeringInterval, 1, 16, panelState);
+    if (result.newFlockConfig.steeringInterval <= 0) {
+        result.newFlockConfig.steeringInterval = 1;
+    }
+    PanelParameterInt("Sort Interval", &result.newFlockConfig.sortInterval, 0, 240, panelState);
+    if (result.newFlockConfig.sortInterval < 0) {
+        result.newFlockConfig.sortInterval = 0;
+    }
+
+    // The time step is shown as a rate, it is only changed when the rate is so rounding doesn't alter it every frame
+    const int stepRate = (int)lroundf(1.F / flockSnapshot->config.timeStep);
+    int newStepRate = stepRate;
+    PanelParameterInt("Step Rate (Hz)", &newStepRate, 1, 240, panelState);
+    if (newStepRate != stepRate) {
+        result.newFlockConfig.timeStep = 1.F / (float)(newStepRate > 0 ? newStepRate : 1);
+    }
+    PanelParameterInt("Max Steps/Frame", &result.newFlockConfig.maxStepsPerFrame, 1, 16, panelState);
+    if (result.newFlockConfig.maxStepsPerFrame <= 0) {
+        result.newFlockConfig.maxStepsPerFrame = 1;
+    }
+    GuiEnable();
 
     PanelParameterBool("Show FPS", &guiState->showFPS, panelState);
 
@@ -310,11 +434,11 @@ struct ParametersPanelResult DrawParametersPanel(struct GuiState *guiState, cons
 struct Debug_PanelInspectionButtonsResult {
     bool isFlockPaused;
     bool doFlockStep;
-} Debug_PanelInspectionButtons(struct PanelState *state, const struct FlockState *flockState) {
+} Debug_PanelInspectionButtons(struct PanelState *state, const struct FlockSnapshot *flockSnapshot) {
     const struct GuiConfig *config = state->config;
 
     struct Debug_PanelInspectionButtonsResult result = {
-        .isFlockPaused = flockState->isPaused,
+        .isFlockPaused = flockSnapshot->isPaused,
         .doFlockStep = false,
     };
 
@@ -324,8 +448,8 @@ struct Debug_PanelInspectionButtonsResult {
         .width = config->buttonHeight,
         .height = config->buttonHeight,
     };
-    if (GuiButton(buttonBounds, GuiIconText((flockState->isPaused ? ICON_PLAYER_PLAY : ICON_PLAYER_PAUSE), NULL))) {
-        result.isFlockPaused = !flockState->isPaused;
+    if (GuiButton(buttonBounds, GuiIconText((flockSnapshot->isPaused ? ICON_PLAYER_PLAY : ICON_PLAYER_PAUSE), NULL))) {
+        result.isFlockPaused = !flockSnapshot->isPaused;
     }
     buttonBounds.x += buttonBounds.width + config->padding;
     result.doFlockStep = GuiButton(buttonBounds, GuiIconText(ICON_PLAYER_NEXT, NULL));
@@ -336,19 +460,20 @@ struct Debug_PanelInspectionButtonsResult {
 }
 
 struct Debug_InspectionPanelResult Debug_DrawInspectionPanel(struct GuiState *guiState,
-                                                             const struct FlockState *flockState) {
+                                                             const struct FlockSnapshot *flockSnapshot) {
     struct Debug_InspectionPanelResult result;
     struct PanelState *panelState = &guiState->debug_inspectionPanelState;
     if (panelState == NULL) {
         TraceLog(LOG_ERROR, "Debug_DrawInspectionPanel: Recieved NULL pointer to debug_inspectionPanelState.");
         return result;
     }
-    Boid *boid = &flockState->boids[guiState->debug_inspectedBoidIndex];
-    if (boid == NULL) {
-        TraceLog(LOG_ERROR, "Debug_DrawInspectionPanel: Recieved index of invalid boid.");
+    if (guiState->debug_inspectedBoidId < 0 || guiState->debug_inspectedBoidId >= flockSnapshot->boidsCount) {
+        TraceLog(LOG_ERROR, "Debug_DrawInspectionPanel: Recieved ID of invalid boid.");
         return result;
     }
-    struct Debug_BoidData *boidData = &flockState->debug_boidData[guiState->debug_inspectedBoidIndex];
+    const int boidIndex = flockSnapshot->debug_boidIndices[guiState->debug_inspectedBoidId];
+    const Boid boid = GetFlockSnapshotBoid(flockSnapshot, boidIndex);
+    struct Debug_BoidData *boidData = &flockSnapshot->debug_boidData[boidIndex];
     if (boidData == NULL) {
         TraceLog(LOG_ERROR, "Debug_DrawInspectionPanel: Boid does not have valid debug data.");
         return result;
@@ -364,16 +489,20 @@ struct Debug_InspectionPanelResult Debug_DrawInspectionPanel(struct GuiState *gu
     // Set the initial height offset
     panelState->heightOffset = 25.F + guiState->config.padding;
 
+    // There is no simulation to pause while replaying
+    if (guiState->isFlockReadOnly) {
+        GuiDisable();
+    }
     struct Debug_PanelInspectionButtonsResult inspectionPanelButtonsResult =
-        Debug_PanelInspectionButtons(panelState, flockState);
+        Debug_PanelInspectionButtons(panelState, flockSnapshot);
+    GuiEnable();
     result.isFlockPaused = inspectionPanelButtonsResult.isFlockPaused;
     result.doStepFlock = inspectionPanelButtonsResult.doFlockStep;
 
     PanelHeader("Inspect Boid", panelState);
-    PanelParameterInt("Boid Index", &guiState->debug_inspectedBoidIndex, 0, flockState->config.numberOfBoids - 1,
-                      panelState);
-    PanelValueVector2("Position", &boid->position, false, panelState);
-    PanelValueVector2("Velocity", &boid->velocity, true, panelState);
+    PanelParameterInt("Boid ID", &guiState->debug_inspectedBoidId, 0, flockSnapshot->boidsCount - 1, panelState);
+    PanelValueVector2("Position", &boid.position, false, panelState);
+    PanelValueVector2("Velocity", &boid.velocity, true, panelState);
     PanelParameterBool("Draw Velocity", &guiState->debug_showVelocity, panelState);
     PanelValueVector2("Separation Vector", &boidData->separationVector, true, panelState);
     PanelParameterBool("Draw Separation", &guiState->debug_showSeparation, panelState);
@@ -381,24 +510,28 @@ struct Debug_InspectionPanelResult Debug_DrawInspectionPanel(struct GuiState *gu
     PanelParameterBool("Draw Alignment", &guiState->debug_showAlignment, panelState);
     PanelValueVector2("Cohesion Vector", &boidData->cohesionVector, true, panelState);
     PanelParameterBool("Draw Cohesion", &guiState->debug_showCohesion, panelState);
+    PanelValueVector2("Obstacle Vector", &boidData->obstacleVector, true, panelState);
+    PanelParameterBool("Draw Avoidance", &guiState->debug_showObstacleAvoidance, panelState);
 
     PanelParameterBool("Show Ranges", &guiState->debug_showRanges, panelState);
 
     PanelHeader("Flock Stats", panelState);
-    float collisionRate = (float)(flockState->collisionTime / (GetTime() - flockState->collisionTimeStart));
+    float collisionRate = flockSnapshot->collisionSampleTime > 0.F
+                              ? flockSnapshot->collisionTime / flockSnapshot->collisionSampleTime
+                              : 0.F;
     PanelValueFloat("Collision Rate", &collisionRate, panelState);
 
     return result;
 }
 
-static void Debug_DrawInspectionHighlight(const struct FlockState *flockState, const int boidIndex) {
-    Boid *boid = &flockState->boids[boidIndex];
-    if (boid == NULL) {
+static void Debug_DrawInspectionHighlight(const struct FlockSnapshot *flockSnapshot, const int boidIndex) {
+    if (boidIndex < 0 || boidIndex >= flockSnapshot->boidsCount) {
         TraceLog(LOG_ERROR, "DrawBoidRanges: Recieved index of invalid boid.");
         return;
     }
+    const Boid boid = GetFlockSnapshotBoid(flockSnapshot, boidIndex);
 
-    const Vector2 forwardVector = Vector2Normalize(boid->velocity);
+    const Vector2 forwardVector = Vector2Normalize(boid.velocity);
     Vector2 perpRight = (Vector2){.x = forwardVector.y, .y = -forwardVector.x};
     Vector2 perpLeft = (Vector2){.x = -forwardVector.y, .y = forwardVector.x};
     Vector2 vertex1 = Vector2Scale(forwardVector, BOID_LENGTH / 2.F);
@@ -406,23 +539,23 @@ static void Debug_DrawInspectionHighlight(const struct FlockState *flockState, c
     Vector2 vertex3 = Vector2Add(Vector2Negate(vertex1), Vector2Scale(perpLeft, BOID_WIDTH / 2.F));
 
     // Transform vertices from local space to world space
-    vertex1 = Vector2Add(vertex1, boid->position);
-    vertex2 = Vector2Add(vertex2, boid->position);
-    vertex3 = Vector2Add(vertex3, boid->position);
+    vertex1 = Vector2Add(vertex1, boid.position);
+    vertex2 = Vector2Add(vertex2, boid.position);
+    vertex3 = Vector2Add(vertex3, boid.position);
 
     DrawTriangleLines(vertex1, vertex2, vertex3, YELLOW);
 }
 
-static void Debug_DrawBoidRanges(const struct FlockState *flockState, const int boidIndex) {
-    Boid *boid = &flockState->boids[boidIndex];
-    if (boid == NULL) {
+static void Debug_DrawBoidRanges(const struct FlockSnapshot *flockSnapshot, const int boidIndex) {
+    if (boidIndex < 0 || boidIndex >= flockSnapshot->boidsCount) {
         TraceLog(LOG_ERROR, "DrawBoidRanges: Recieved index of invalid boid.");
         return;
     }
+    const Boid boid = GetFlockSnapshotBoid(flockSnapshot, boidIndex);
 
-    DrawCircleV(boid->position, flockState->config.separationRange, Fade(GRAY, 0.2F));
-    DrawCircleV(boid->position, flockState->config.alignmentRange, Fade(GRAY, 0.2F));
-    DrawCircleV(boid->position, flockState->config.cohesionRange, Fade(GRAY, 0.2F));
+    DrawCircleV(boid.position, flockSnapshot->config.separationRange, Fade(GRAY, 0.2F));
+    DrawCircleV(boid.position, flockSnapshot->config.alignmentRange, Fade(GRAY, 0.2F));
+    DrawCircleV(boid.position, flockSnapshot->config.cohesionRange, Fade(GRAY, 0.2F));
 }
 
 static void Debug_DrawVector2(Vector2 origin, Vector2 displacement, Color color) {
@@ -441,60 +574,115 @@ static void Debug_DrawVector2(Vector2 origin, Vector2 displacement, Color color)
     DrawTriangle(tipPosition, point2, point1, color);
 }
 
-static void Debug_DrawGuiBoidOverlay(const struct GuiState *guiState, const struct FlockState *flockState,
+static void Debug_DrawGuiBoidOverlay(const struct GuiState *guiState, const struct FlockSnapshot *flockSnapshot,
                                      const int boidIndex) {
-    Debug_DrawInspectionHighlight(flockState, boidIndex);
+    if (boidIndex < 0 || boidIndex >= flockSnapshot->boidsCount) {
+        return;
+    }
+    const Boid boid = GetFlockSnapshotBoid(flockSnapshot, boidIndex);
+
+    Debug_DrawInspectionHighlight(flockSnapshot, boidIndex);
     if (guiState->debug_showRanges) {
-        Debug_DrawBoidRanges(flockState, boidIndex);
+        Debug_DrawBoidRanges(flockSnapshot, boidIndex);
     }
     if (guiState->debug_showVelocity) {
-        Debug_DrawVector2(flockState->boids[boidIndex].position, flockState->boids[boidIndex].velocity, RED);
+        Debug_DrawVector2(boid.position, boid.velocity, RED);
     }
     if (guiState->debug_showSeparation) {
-        Debug_DrawVector2(flockState->boids[boidIndex].position, flockState->debug_boidData[boidIndex].separationVector,
-                          RED);
+        Debug_DrawVector2(boid.position, flockSnapshot->debug_boidData[boidIndex].separationVector, RED);
     }
     if (guiState->debug_showAlignment) {
-        Debug_DrawVector2(flockState->boids[boidIndex].position, flockState->debug_boidData[boidIndex].alignmentVector,
-                          RED);
+        Debug_DrawVector2(boid.position, flockSnapshot->debug_boidData[boidIndex].alignmentVector, RED);
     }
     if (guiState->debug_showCohesion) {
-        Debug_DrawVector2(flockState->boids[boidIndex].position, flockState->debug_boidData[boidIndex].cohesionVector,
-                          RED);
+        Debug_DrawVector2(boid.position, flockSnapshot->debug_boidData[boidIndex].cohesionVector, RED);
+    }
+    if (guiState->debug_showObstacleAvoidance) {
+        Debug_DrawVector2(boid.position, flockSnapshot->debug_boidData[boidIndex].obstacleVector, RED);
     }
 }
 #endif /* ifdef DEBUG */
 
-struct GuiResult DrawGui(struct GuiState *state, const struct FlockState *flockState) {
+#ifdef PROFILER
+// Internal function that draws the profiler's summary of each phase
+static void DrawProfilerPanel(struct GuiState *guiState, const struct FlockSnapshot *flockSnapshot) {
+    struct PanelState *panelState = &guiState->profilerPanelState;
+
+    // Draw the panel
+    GuiPanel((Rectangle){0.F, 0.F, guiState->config.panelWidth, guiState->config.panelHeight}, "Profiler");
+    // Reset the ID counter (it will be incremented as we draw each element)
+    panelState->currentId = 0;
+    // Set the initial height offset
+    panelState->heightOffset = 25.F + guiState->config.padding;
+
+    for (int phase = 0; phase < PROFILER_PHASES_COUNT; phase++) {
+        const struct Profiler *profiler =
+            phase < PROFILER_FIRST_FRAME_PHASE ? &flockSnapshot->profiler : guiState->frameProfiler;
+        if (profiler == NULL) {
+            continue;
+        }
+        const struct ProfilerPhaseSummary summary = SummarizeProfilerPhase(profiler, (enum ProfilerPhase)phase);
+        // Phases that didn't happen, such as recording without a recorder, are left out
+        if (summary.samplesCount == 0) {
+            continue;
+        }
+
+        PanelHeader(GetProfilerPhaseName((enum ProfilerPhase)phase), panelState);
+        PanelValueFloat("Mean (ms)", &summary.mean, panelState);
+        PanelValueFloat("P99 (ms)", &summary.percentile99, panelState);
+        PanelValueFloat("ns/boid", &summary.nanosecondsPerBoid, panelState);
+    }
+}
+#endif /* ifdef PROFILER */
+
+struct GuiResult DrawGui(struct GuiState *state, const struct FlockSnapshot *flockSnapshot) {
     struct GuiResult result;
     if (state == NULL) {
         TraceLog(LOG_ERROR, "DrawGui: Recieved NULL pointer to guiState.");
         return result;
     }
-    if (flockState == NULL) {
-        TraceLog(LOG_ERROR, "DrawGui: Recieved NULL pointer to flockState.");
+    if (flockSnapshot == NULL) {
+        TraceLog(LOG_ERROR, "DrawGui: Recieved NULL pointer to flockSnapshot.");
         return result;
     }
 
+#ifdef DEBUG
+    // The flock may have been shrunk past the inspected boid
+    if (flockSnapshot->boidsCount > 0 && state->debug_inspectedBoidId >= flockSnapshot->boidsCount) {
+        state->debug_inspectedBoidId = flockSnapshot->boidsCount - 1;
+    }
+#endif /* ifdef DEBUG */
+
     switch (state->activeTab) {
     case PARAMETERS_TAB:
         result = (struct GuiResult){
-            .parametersPanelResult = DrawParametersPanel(state, flockState),
+            .parametersPanelResult = DrawParametersPanel(state, flockSnapshot),
         };
         break;
 #ifdef DEBUG
     case DEBUG_INSPECTION_TAB:
         result = (struct GuiResult){
-            .debug_inspectionPanelResult = Debug_DrawInspectionPanel(state, flockState),
+            .debug_inspectionPanelResult = Debug_DrawInspectionPanel(state, flockSnapshot),
         };
         break;
 #endif /* ifdef DEBUG */
+#ifdef PROFILER
+    case PROFILER_TAB:
+        // Nothing on this tab changes the flock
+        result = (struct GuiResult){0};
+        DrawProfilerPanel(state, flockSnapshot);
+        break;
+#endif /* ifdef PROFILER */
     default:
         break;
     }
 
 #ifdef DEBUG
-    Debug_DrawGuiBoidOverlay(state, flockState, state->debug_inspectedBoidIndex);
+    BeginMode2D(state->camera);
+    if (state->debug_inspectedBoidId >= 0 && state->debug_inspectedBoidId < flockSnapshot->boidsCount) {
+        Debug_DrawGuiBoidOverlay(state, flockSnapshot, flockSnapshot->debug_boidIndices[state->debug_inspectedBoidId]);
+    }
+    EndMode2D();
 #endif /* ifdef DEBUG */
 
     Rectangle tabBarBounds = {.x = 0.F, .y = 0.F, .width = state->config.panelWidth, .height = 25.F};
@@ -507,3 +695,50 @@ struct GuiResult DrawGui(struct GuiState *state, const struct FlockState *flockS
 
     return result;
 }
+
+struct ReplayBarResult DrawReplayBar(const struct GuiState *state, const struct FlockSnapshot *flockSnapshot,
+                                     const double playheadTime, const double startTime, const double endTime,
+                                     const bool isPlaying, const float speed) {
+    struct ReplayBarResult result = {
+        .togglePlaying = false,
+        .hasSeeked = false,
+        .seekTime = playheadTime,
+    };
+
+    if (state == NULL) {
+        TraceLog(LOG_ERROR, "DrawReplayBar: Recieved NULL pointer to state.");
+        return result;
+    }
+    if (flockSnapshot == NULL) {
+        TraceLog(LOG_ERROR, "DrawReplayBar: Recieved NULL pointer to flockSnapshot.");
+        return result;
+    }
+
+    const struct GuiConfig *config = &state->config;
+    Rectangle bounds = {
+        .x = config->panelWidth + config->padding,
+        .y = (float)GetScreenHeight() - config->buttonHeight - config->padding,
+        .width = config->buttonHeight,
+        .height = config->buttonHeight,
+    };
+    result.togglePlaying = GuiButton(bounds, GuiIconText((isPlaying ? ICON_PLAYER_PAUSE : ICON_PLAYER_PLAY), NULL));
+
+    // The slider works in seconds from the start so the float doesn't lose precision on long recordings
+    bounds.x += bounds.width + config->padding;
+    bounds.width = (float)GetScreenWidth() - bounds.x - config->panelWidth - config->padding;
+    float sliderTime = (float)(playheadTime - startTime);
+    const float previousSliderTime = sliderTime;
+    GuiSliderBar(bounds, NULL, NULL, &sliderTime, 0.F, (float)(endTime - startTime));
+    if (sliderTime != previousSliderTime) {
+        result.hasSeeked = true;
+        result.seekTime = startTime + (double)sliderTime;
+    }
+
+    bounds.x += bounds.width + config->padding;
+    bounds.width = config->panelWidth - config->padding;
+    GuiDrawText(TextFormat("Step %llu  %.2fs  x%g", (unsigned long long)flockSnapshot->clock.stepsCount,
+                           playheadTime, speed),
+                bounds, TEXT_ALIGN_LEFT, RAYWHITE);
+
+    return result;
+}
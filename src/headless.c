@@ -0,0 +1,304 @@
+#include "flock.h"
+#include "flock_log.h"
+#include "obstacle_field.h"
+#include "profiler.h"
+#include "steering.h"
+#include "timer.h"
+#include "trace.h"
+#include "trajectory.h"
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct HeadlessOptions {
+    struct FlockConfig flockConfig;
+    // Number of obstacles spread over the bounds of a new flock
+    int obstaclesCount;
+    int steps;
+    float deltaTime;
+
+    // Checkpoint to start from instead of spawning a new flock, and checkpoint to write after the last step
+    const char *loadPath;
+    const char *savePath;
+    // Trajectory file to record every step to
+    const char *recordPath;
+#ifdef PROFILER
+    // CSV file to write every profiler sample to
+    const char *profilerCsvPath;
+#endif /* ifdef PROFILER */
+#ifdef TRACING
+    // Chrome trace file to write after the last step
+    const char *tracePath;
+#endif /* ifdef TRACING */
+};
+
+// Internal function that prints the command line options
+static void PrintUsage(const char *program) {
+    printf("Usage: %s [options]\n"
+           "  --boids <count>             Number of boids (default 10000)\n"
+           "  --steps <count>             Number of steps to simulate (default 1000)\n"
+           "  --dt <seconds>              Timestep (default 1/60)\n"
+           "  --seed <seed>               Seed for the spawn positions (default 0)\n"
+           "  --threads <count>           Number of update threads (default 1)\n"
+           "  --width <units>             Width of the flock bounds (default 1600)\n"
+           "  --height <units>            Height of the flock bounds (default 900)\n"
+           "  --open-world <0|1>          Let boids leave the bounds instead of wrapping around (default 0)\n"
+           "  --separation-range <units>  Separation range (default 50)\n"
+           "  --alignment-range <units>   Alignment range (default 100)\n"
+           "  --cohesion-range <units>    Cohesion range (default 100)\n"
+           "  --quadtree <angle>          Use the quadtree for alignment and cohesion with this opening angle\n"
+           "  --neighbour-lists <skin>    Reuse neighbour lists with this skin across steps\n"
+           "  --steering-interval <steps> Recompute each boid's steering force every this many steps (default 1)\n"
+           "  --species <count>           Split the boids evenly between this many species, 1 to 4 (default 1)\n"
+           "  --obstacles <count>         Spread this many circular obstacles evenly over the bounds (default 0)\n"
+           "  --compact <0|1>             Pack the grid's copy of the boids into 8 bytes each (default 0)\n"
+           "  --sort-interval <steps>     Re-sort the boids in memory every this many steps, 0 never (default 16)\n"
+           "  --load <path>               Resume from a checkpoint, only --steps, --dt and --threads apply\n"
+           "  --save <path>               Save a checkpoint after the last step\n"
+           "  --record <path>             Record every step to a trajectory file\n"
+#ifdef PROFILER
+           "  --profile-csv <path>        Write the time of every update phase to a CSV file\n"
+#endif /* ifdef PROFILER */
+#ifdef TRACING
+           "  --trace <path>              Write a Chrome trace of the last steps to a file\n"
+#endif /* ifdef TRACING */
+           "  --help                      Show this message\n",
+           program);
+}
+
+// Internal function that parses the command line, returns false if the program should exit
+static bool ParseOptions(int argc, char *argv[], struct HeadlessOptions *options, int *exitCode) {
+    *options = (struct HeadlessOptions){
+        .flockConfig = CreateDefaultFlockConfig((Rectangle){.x = 0.F, .y = 0.F, .width = 1600.F, .height = 900.F}),
+        .steps = 1000,
+        .deltaTime = 1.F / 60.F,
+    };
+    options->flockConfig.numberOfBoids = 10000;
+
+    for (int i = 1; i < argc; i++) {
+        const char *option = argv[i];
+        if (strcmp(option, "--help") == 0) {
+            PrintUsage(argv[0]);
+            *exitCode = EXIT_SUCCESS;
+            return false;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for option %s\n", option);
+            PrintUsage(argv[0]);
+            *exitCode = EXIT_FAILURE;
+            return false;
+        }
+
+        const char *value = argv[++i];
+        struct FlockConfig *config = &options->flockConfig;
+        if (strcmp(option, "--boids") == 0) {
+            config->numberOfBoids = atoi(value);
+        } else if (strcmp(option, "--steps") == 0) {
+            options->steps = atoi(value);
+        } else if (strcmp(option, "--dt") == 0) {
+            options->deltaTime = strtof(value, NULL);
+        } else if (strcmp(option, "--seed") == 0) {
+            config->seed = (unsigned int)strtoul(value, NULL, 10);
+        } else if (strcmp(option, "--threads") == 0) {
+            config->threadCount = atoi(value);
+        } else if (strcmp(option, "--width") == 0) {
+            config->flockBounds.width = strtof(value, NULL);
+        } else if (strcmp(option, "--height") == 0) {
+            config->flockBounds.height = strtof(value, NULL);
+        } else if (strcmp(option, "--open-world") == 0) {
+            config->useOpenWorld = atoi(value) != 0;
+        } else if (strcmp(option, "--separation-range") == 0) {
+            config->separationRange = strtof(value, NULL);
+        } else if (strcmp(option, "--alignment-range") == 0) {
+            config->alignmentRange = strtof(value, NULL);
+        } else if (strcmp(option, "--cohesion-range") == 0) {
+            config->cohesionRange = strtof(value, NULL);
+        } else if (strcmp(option, "--quadtree") == 0) {
+            config->useQuadtree = true;
+            config->quadtreeOpeningAngle = strtof(value, NULL);
+        } else if (strcmp(option, "--neighbour-lists") == 0) {
+            config->useNeighbourLists = true;
+            config->neighbourListSkin = strtof(value, NULL);
+        } else if (strcmp(option, "--steering-interval") == 0) {
+            config->steeringInterval = atoi(value);
+        } else if (strcmp(option, "--sort-interval") == 0) {
+            config->sortInterval = atoi(value);
+        } else if (strcmp(option, "--compact") == 0) {
+            config->useCompactStorage = atoi(value) != 0;
+        } else if (strcmp(option, "--species") == 0) {
+            config->speciesCount = atoi(value);
+        } else if (strcmp(option, "--obstacles") == 0) {
+            options->obstaclesCount = atoi(value);
+        } else if (strcmp(option, "--load") == 0) {
+            options->loadPath = value;
+        } else if (strcmp(option, "--save") == 0) {
+            options->savePath = value;
+        } else if (strcmp(option, "--record") == 0) {
+            options->recordPath = value;
+#ifdef PROFILER
+        } else if (strcmp(option, "--profile-csv") == 0) {
+            options->profilerCsvPath = value;
+#endif /* ifdef PROFILER */
+#ifdef TRACING
+        } else if (strcmp(option, "--trace") == 0) {
+            options->tracePath = value;
+#endif /* ifdef TRACING */
+        } else {
+            fprintf(stderr, "Unknown option %s\n", option);
+            PrintUsage(argv[0]);
+            *exitCode = EXIT_FAILURE;
+            return false;
+        }
+    }
+
+    if (options->steps <= 0 || options->deltaTime <= 0.F) {
+        fprintf(stderr, "Steps and timestep must be greater than 0\n");
+        *exitCode = EXIT_FAILURE;
+        return false;
+    }
+    if (options->obstaclesCount < 0) {
+        fprintf(stderr, "The number of obstacles must not be negative\n");
+        *exitCode = EXIT_FAILURE;
+        return false;
+    }
+
+    return true;
+}
+
+// Runs the flock simulation without a window for a fixed number of steps and reports the throughput
+int main(int argc, char *argv[]) {
+    struct HeadlessOptions options;
+    int exitCode = EXIT_SUCCESS;
+    if (!ParseOptions(argc, argv, &options, &exitCode)) {
+        return exitCode;
+    }
+
+    struct FlockState flockState;
+    if (options.loadPath != NULL) {
+        if (!InitializeFlockFromCheckpoint(&flockState, options.loadPath)) {
+            FlockLog(LOG_FATAL, "Failed to load flock from %s. Exiting.", options.loadPath);
+            return EXIT_FAILURE;
+        }
+        // The thread count depends on the machine rather than the run, so it isn't taken from the checkpoint
+        struct FlockConfig config = flockState.config;
+        config.threadCount = options.flockConfig.threadCount;
+        ModifyFlockConfig(&flockState, config);
+        options.flockConfig = flockState.config;
+    } else if (!InitializeFlock(&flockState, options.flockConfig)) {
+        FlockLog(LOG_FATAL, "Failed to initialise flock. Exiting.");
+        return EXIT_FAILURE;
+    } else if (options.obstaclesCount > 0) {
+        struct FlockObstacle *obstacles = malloc(sizeof(struct FlockObstacle) * options.obstaclesCount);
+        if (obstacles != NULL) {
+            SpreadFlockObstacles(obstacles, options.obstaclesCount, options.flockConfig.flockBounds);
+        }
+        if (obstacles == NULL || !SetFlockObstacles(&flockState, obstacles, options.obstaclesCount)) {
+            FlockLog(LOG_FATAL, "Failed to add %d obstacles. Exiting.", options.obstaclesCount);
+            free(obstacles);
+            DestroyFlock(&flockState);
+            return EXIT_FAILURE;
+        }
+        free(obstacles);
+    }
+
+    printf("Simulating %d boids and %d obstacles in %.0fx%.0f for %d steps of %.4fs (%d threads, %s steering kernel)\n",
+           flockState.boidsCount, flockState.obstaclesCount, options.flockConfig.flockBounds.width,
+           options.flockConfig.flockBounds.height, options.steps, options.deltaTime, options.flockConfig.threadCount,
+           GetSteeringKernelName(flockState.steeringKernel));
+
+    struct TrajectoryRecorder recorder;
+    if (options.recordPath != NULL) {
+        if (!StartTrajectoryRecorder(&recorder, CreateDefaultTrajectoryRecorderConfig(options.recordPath),
+                                     &flockState.config)) {
+            FlockLog(LOG_FATAL, "Failed to start recording to %s. Exiting.", options.recordPath);
+            DestroyFlock(&flockState);
+            return EXIT_FAILURE;
+        }
+        // The starting state is recorded too so the trajectory covers the whole run
+        RecordTrajectoryFrame(&recorder, &flockState.boids, flockState.boidIndices, flockState.boidsCount,
+                              flockState.clock.stepsCount, flockState.clock.time);
+        flockState.recorder = &recorder;
+    }
+
+#ifdef PROFILER
+    FILE *profilerCsvFile = NULL;
+    if (options.profilerCsvPath != NULL) {
+        profilerCsvFile = OpenProfilerCsv(options.profilerCsvPath);
+        flockState.profiler.csvFile = profilerCsvFile;
+    }
+#endif /* ifdef PROFILER */
+
+#ifdef TRACING
+    SetTraceThreadName("Main");
+#endif /* ifdef TRACING */
+
+    const double startTime = GetMonotonicTime();
+    for (int step = 0; step < options.steps; step++) {
+        UpdateFlock(&flockState, options.deltaTime);
+    }
+    const double elapsedTime = GetMonotonicTime() - startTime;
+
+    const double stepsPerSecond = (double)options.steps / elapsedTime;
+    printf("%d steps in %.3fs: %.2f steps/s, %.1f ns/boid/step\n", options.steps, elapsedTime, stepsPerSecond,
+           (elapsedTime * 1e9) / ((double)options.steps * (double)flockState.boidsCount));
+
+#ifdef PROFILER
+    // Summaries only cover the last PROFILER_HISTORY_SIZE steps
+    for (int phase = 0; phase < PROFILER_FIRST_FRAME_PHASE; phase++) {
+        const struct ProfilerPhaseSummary summary =
+            SummarizeProfilerPhase(&flockState.profiler, (enum ProfilerPhase)phase);
+        if (summary.samplesCount > 0) {
+            printf("  %-12s mean %.3fms, p50 %.3fms, p99 %.3fms, max %.3fms, %.1f ns/boid\n",
+                   GetProfilerPhaseName((enum ProfilerPhase)phase), summary.mean, summary.median,
+                   summary.percentile99, summary.maximum, summary.nanosecondsPerBoid);
+        }
+    }
+    if (profilerCsvFile != NULL) {
+        flockState.profiler.csvFile = NULL;
+        fclose(profilerCsvFile);
+    }
+#endif /* ifdef PROFILER */
+
+    if (options.recordPath != NULL) {
+        flockState.recorder = NULL;
+        const uint64_t stallsCount = recorder.stallsCount;
+        const double stopStartTime = GetMonotonicTime();
+        if (StopTrajectoryRecorder(&recorder)) {
+            printf("Recorded %d steps to %s (stalled %llu times, %.3fs to finish writing)\n", options.steps + 1,
+                   options.recordPath, (unsigned long long)stallsCount, GetMonotonicTime() - stopStartTime);
+        } else {
+            FlockLog(LOG_ERROR, "Failed to record flock to %s.", options.recordPath);
+            exitCode = EXIT_FAILURE;
+        }
+    }
+
+    if (options.savePath != NULL) {
+        if (SaveFlockCheckpoint(&flockState, options.savePath)) {
+            printf("Saved step %llu to %s\n", (unsigned long long)flockState.clock.stepsCount, options.savePath);
+        } else {
+            FlockLog(LOG_ERROR, "Failed to save flock to %s.", options.savePath);
+            exitCode = EXIT_FAILURE;
+        }
+    }
+
+#ifdef TRACING
+    if (options.tracePath != NULL) {
+        if (WriteTrace(options.tracePath)) {
+            printf("Wrote trace to %s\n", options.tracePath);
+        } else {
+            FlockLog(LOG_ERROR, "Failed to write trace to %s.", options.tracePath);
+            exitCode = EXIT_FAILURE;
+        }
+    }
+#endif /* ifdef TRACING */
+
+    DestroyFlock(&flockState);
+#ifdef TRACING
+    ShutdownTrace();
+#endif /* ifdef TRACING */
+    return exitCode;
+}
@@ -1,67 +1,477 @@
 #include "boid.h"
+#include "boid_batch.h"
 #include "flock.h"
+#include "flock_log.h"
+#include "flock_thread.h"
 #include "gui.h"
+#include "profiler.h"
+#include "trace.h"
+#include "trajectory.h"
 
+#include <limits.h>
+#include <math.h>
 #include <raylib.h>
+#include <raymath.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Forwards messages from the flock library to raylib's log
+static void ForwardFlockLog(int logLevel, const char *text, va_list args) {
+    char message[512];
+    vsnprintf(message, sizeof(message), text, args);
+    TraceLog(logLevel, "%s", message);
+}
+
+#define WINDOW_WIDTH 1600
+#define WINDOW_HEIGHT 900
+
+// Size of the obstacles placed with the O key, in world units
+#define PLACED_OBSTACLE_SIZE 80.F
+
+// Limits of the camera's zoom, in pixels per world unit
+#define CAMERA_MIN_ZOOM 0.001F
+#define CAMERA_MAX_ZOOM 64.F
+
+// Creates a camera that fits the whole of the bounds on screen
+static Camera2D CreateFlockCamera(const Rectangle bounds) {
+    const float zoom = fminf((float)GetScreenWidth() / bounds.width, (float)GetScreenHeight() / bounds.height);
+    return (Camera2D){
+        .offset = (Vector2){.x = (float)GetScreenWidth() / 2.F, .y = (float)GetScreenHeight() / 2.F},
+        .target = (Vector2){.x = bounds.x + (bounds.width / 2.F), .y = bounds.y + (bounds.height / 2.F)},
+        .rotation = 0.F,
+        .zoom = Clamp(zoom, CAMERA_MIN_ZOOM, CAMERA_MAX_ZOOM),
+    };
+}
+
+// Returns the part of the world that should fit on screen: the bounds, or in an open world wherever the boids have
+// got to
+static Rectangle GetFlockCameraBounds(const struct FlockSnapshot *flockSnapshot) {
+    if (!flockSnapshot->config.useOpenWorld || flockSnapshot->boidsCount == 0) {
+        return flockSnapshot->config.flockBounds;
+    }
+    return GetBoidArraysExtent(&flockSnapshot->boids, flockSnapshot->boidsCount);
+}
+
+// Zooms the camera around the mouse with the wheel and pans it by dragging with the right mouse button. R fits the
+// flock on screen again (see GetFlockCameraBounds).
+static void UpdateFlockCamera(Camera2D *camera, const struct FlockSnapshot *flockSnapshot) {
+    if (IsKeyPressed(KEY_R)) {
+        *camera = CreateFlockCamera(GetFlockCameraBounds(flockSnapshot));
+        return;
+    }
+
+    if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
+        camera->target = Vector2Add(camera->target, Vector2Scale(GetMouseDelta(), -1.F / camera->zoom));
+    }
+
+    const float wheelMove = GetMouseWheelMove();
+    if (wheelMove != 0.F) {
+        // Keep the point under the mouse where it is
+        const Vector2 mousePosition = GetMousePosition();
+        camera->target = GetScreenToWorld2D(mousePosition, *camera);
+        camera->offset = mousePosition;
+        camera->zoom = Clamp(camera->zoom * expf(wheelMove * 0.1F), CAMERA_MIN_ZOOM, CAMERA_MAX_ZOOM);
+    }
+}
+
+// Returns the part of the world that the camera shows on screen
+static Rectangle GetFlockCameraView(const Camera2D camera) {
+    const Vector2 topLeft = GetScreenToWorld2D((Vector2){0.F, 0.F}, camera);
+    const Vector2 bottomRight =
+        GetScreenToWorld2D((Vector2){(float)GetScreenWidth(), (float)GetScreenHeight()}, camera);
+    return (Rectangle){
+        .x = topLeft.x,
+        .y = topLeft.y,
+        .width = bottomRight.x - topLeft.x,
+        .height = bottomRight.y - topLeft.y,
+    };
+}
+
+// Draws the snapshot's obstacles, in world space
+static void DrawFlockObstacles(const struct FlockSnapshot *flockSnapshot) {
+    const Color color = Fade(LIGHTGRAY, 0.5F);
+    for (int i = 0; i < flockSnapshot->obstaclesCount; i++) {
+        const struct FlockObstacle *obstacle = &flockSnapshot->obstacles[i];
+        switch (obstacle->shape) {
+        case FLOCK_OBSTACLE_CIRCLE:
+            DrawCircleV(obstacle->center, obstacle->radius, color);
+            break;
+        case FLOCK_OBSTACLE_RECTANGLE:
+            DrawRectangleRec(obstacle->rectangle, color);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// Creates the obstacle placed by pressing O, a circle centred on the position or a square when shift is held
+static struct FlockObstacle CreatePlacedObstacle(const Vector2 position) {
+    if (IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT)) {
+        return (struct FlockObstacle){
+            .shape = FLOCK_OBSTACLE_RECTANGLE,
+            .rectangle =
+                {
+                    .x = position.x - (PLACED_OBSTACLE_SIZE / 2.F),
+                    .y = position.y - (PLACED_OBSTACLE_SIZE / 2.F),
+                    .width = PLACED_OBSTACLE_SIZE,
+                    .height = PLACED_OBSTACLE_SIZE,
+                },
+        };
+    }
+    return (struct FlockObstacle){
+        .shape = FLOCK_OBSTACLE_CIRCLE,
+        .center = position,
+        .radius = PLACED_OBSTACLE_SIZE / 2.F,
+    };
+}
+
+// Returns the species to colour the snapshot's boids by, or NULL when they are all the same species so the batch can
+// keep its colours
+static const uint8_t *GetDrawnBoidSpecies(const struct FlockSnapshot *flockSnapshot) {
+    return flockSnapshot->config.speciesCount > 1 ? flockSnapshot->boidSpecies : NULL;
+}
+
+// Plays back a trajectory file (see StartTrajectoryRecorder) without simulating the flock. Space plays and pauses,
+// left and right step a frame, up and down change the speed, home and end jump to the start and end. The camera is
+// controlled as in the game.
+static int RunReplay(const char *path) {
+    struct TrajectoryReader reader;
+    if (!OpenTrajectory(&reader, path)) {
+        TraceLog(LOG_FATAL, "Failed to open %s. Exiting.", path);
+        return EXIT_FAILURE;
+    }
+
+    // Frames are decoded into a snapshot, so they are drawn the same way as a running flock
+    struct FlockSnapshot flockSnapshot = {0};
+    uint64_t frame = 0;
+    if (!ReadTrajectoryFrame(&reader, frame, &flockSnapshot)) {
+        TraceLog(LOG_FATAL, "Failed to read %s. Exiting.", path);
+        CloseTrajectory(&reader);
+        return EXIT_FAILURE;
+    }
+
+    struct GuiState guiState;
+    InitializeGui(&guiState, CreateDefaultGuiConfig((float)WINDOW_HEIGHT));
+    guiState.isFlockReadOnly = true;
+
+    InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Boids Replay");
+    SetTargetFPS(144);
+    Camera2D camera = CreateFlockCamera(GetFlockCameraBounds(&flockSnapshot));
+
+    struct BoidBatch boidBatch;
+    if (!InitializeBoidBatch(&boidBatch, flockSnapshot.boidsCount)) {
+        TraceLog(LOG_FATAL, "Failed to initialise boid renderer. Exiting.");
+        DestroyFlockSnapshot(&flockSnapshot);
+        CloseTrajectory(&reader);
+        CloseWindow();
+        return EXIT_FAILURE;
+    }
+
+    const double startTime = reader.index[0].time;
+    const double endTime = reader.index[reader.framesCount - 1].time;
+    double playheadTime = startTime;
+    float speed = 1.F;
+    bool isPlaying = true;
+
+    while (!WindowShouldClose()) {
+        // Update
+        if (IsKeyPressed(KEY_SPACE)) {
+            isPlaying = !isPlaying;
+        }
+        if (IsKeyPressed(KEY_UP)) {
+            speed = fminf(speed * 2.F, 64.F);
+        }
+        if (IsKeyPressed(KEY_DOWN)) {
+            speed = fmaxf(speed / 2.F, 1.F / 16.F);
+        }
+        if (IsKeyPressed(KEY_RIGHT) && frame + 1 < reader.framesCount) {
+            playheadTime = reader.index[frame + 1].time;
+            isPlaying = false;
+        }
+        if (IsKeyPressed(KEY_LEFT) && frame > 0) {
+            playheadTime = reader.index[frame - 1].time;
+            isPlaying = false;
+        }
+        if (IsKeyPressed(KEY_HOME)) {
+            playheadTime = startTime;
+        }
+        if (IsKeyPressed(KEY_END)) {
+            playheadTime = endTime;
+        }
+
+        if (isPlaying) {
+            // Playing from the end starts again from the start
+            if (playheadTime >= endTime) {
+                playheadTime = startTime;
+            }
+            playheadTime += (double)(GetFrameTime() * speed);
+            if (playheadTime >= endTime) {
+                playheadTime = endTime;
+                isPlaying = false;
+            }
+        }
+
+        const uint64_t playheadFrame = FindTrajectoryFrame(&reader, playheadTime);
+        if (playheadFrame != frame) {
+            if (ReadTrajectoryFrame(&reader, playheadFrame, &flockSnapshot)) {
+                frame = playheadFrame;
+            } else {
+                TraceLog(LOG_ERROR, "Failed to read step %llu of %s.",
+                         (unsigned long long)reader.index[playheadFrame].stepsCount, path);
+                playheadTime = flockSnapshot.clock.time;
+                isPlaying = false;
+            }
+        }
+        // Boids are moved along their velocity between frames, just like between steps of a running flock
+        flockSnapshot.clock.accumulator = (float)(playheadTime - flockSnapshot.clock.time);
+
+        UpdateFlockCamera(&camera, &flockSnapshot);
+        guiState.camera = camera;
+
+        // Draw
+        BeginDrawing();
+
+        ClearBackground(DARKGRAY);
+
+        BeginMode2D(camera);
+        DrawBoidBatch(&boidBatch, &flockSnapshot.boids, GetDrawnBoidSpecies(&flockSnapshot), flockSnapshot.boidsCount,
+                      flockSnapshot.clock.accumulator, GetFlockCameraView(camera), camera.zoom);
+        EndMode2D();
+
+        // Nothing is simulated, so changes made in the GUI are ignored
+        DrawGui(&guiState, &flockSnapshot);
+        const struct ReplayBarResult replayBarResult =
+            DrawReplayBar(&guiState, &flockSnapshot, playheadTime, startTime, endTime, isPlaying, speed);
+        if (replayBarResult.togglePlaying) {
+            isPlaying = !isPlaying;
+        }
+        if (replayBarResult.hasSeeked) {
+            playheadTime = replayBarResult.seekTime;
+        }
+
+        EndDrawing();
+    }
+
+    DestroyBoidBatch(&boidBatch);
+    DestroyFlockSnapshot(&flockSnapshot);
+    CloseTrajectory(&reader);
+    CloseWindow();
+    return EXIT_SUCCESS;
+}
 
 int main(int argc, char *argv[]) {
-    const int screenWidth = 1600;
-    const int screenHeight = 900;
+    SetFlockLogCallback(ForwardFlockLog);
 
-    const Rectangle flockBounds = {
+    const char *replayPath = NULL;
+    // The world is the size of the window unless it is set with --world, in an open world it is just where boids
+    // spawn
+    bool useOpenWorld = false;
+    Rectangle flockBounds = {
         .x = 0.F,
         .y = 0.F,
-        .width = (float)screenWidth,
-        .height = (float)screenHeight,
+        .width = (float)WINDOW_WIDTH,
+        .height = (float)WINDOW_HEIGHT,
     };
+#ifdef PROFILER
+    const char *profilerCsvPath = NULL;
+#endif /* ifdef PROFILER */
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--replay") == 0) {
+            replayPath = argv[++i];
+            continue;
+        }
+        if (i + 1 < argc && strcmp(argv[i], "--world") == 0) {
+            Rectangle bounds = flockBounds;
+            if (sscanf(argv[++i], "%fx%f", &bounds.width, &bounds.height) == 2 && bounds.width > 0.F &&
+                bounds.height > 0.F) {
+                flockBounds = bounds;
+            } else {
+                TraceLog(LOG_WARNING, "Ignoring invalid world size %s, expected <width>x<height>.", argv[i]);
+            }
+            continue;
+        }
+        if (i + 1 < argc && strcmp(argv[i], "--open-world") == 0) {
+            useOpenWorld = atoi(argv[++i]) != 0;
+            continue;
+        }
+#ifdef PROFILER
+        if (i + 1 < argc && strcmp(argv[i], "--profile-csv") == 0) {
+            profilerCsvPath = argv[++i];
+            continue;
+        }
+#endif /* ifdef PROFILER */
+        TraceLog(LOG_WARNING,
+                 "Ignoring unknown option %s. Usage: %s [--replay <trajectory>] [--world <width>x<height>] "
+                 "[--open-world <0|1>] [--profile-csv <path>]",
+                 argv[i], argv[0]);
+    }
+    if (replayPath != NULL) {
+        return RunReplay(replayPath);
+    }
+
+    struct FlockConfig flockConfig = CreateDefaultFlockConfig(flockBounds);
+    flockConfig.useOpenWorld = useOpenWorld;
+    flockConfig.seed = (unsigned int)time(NULL);
+
     struct FlockState flockState;
-    if (!InitializeFlock(&flockState, CreateDefaultFlockConfig(flockBounds))) {
+    if (!InitializeFlock(&flockState, flockConfig)) {
         TraceLog(LOG_FATAL, "Failed to initialise flock. Exiting.");
         CloseWindow();
         return EXIT_FAILURE;
     }
 
     struct GuiState guiState;
-    InitializeGui(&guiState, CreateDefaultGuiConfig((float)screenHeight));
+    InitializeGui(&guiState, CreateDefaultGuiConfig((float)WINDOW_HEIGHT));
+
+    InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Boids");
+    // The flock is simulated at its own fixed rate (config.timeStep), independent of the frame rate
+    SetTargetFPS(144);
+    Camera2D camera = CreateFlockCamera(flockBounds);
+
+    struct BoidBatch boidBatch;
+    if (!InitializeBoidBatch(&boidBatch, flockState.boidsCount)) {
+        TraceLog(LOG_FATAL, "Failed to initialise boid renderer. Exiting.");
+        DestroyFlock(&flockState);
+        CloseWindow();
+        return EXIT_FAILURE;
+    }
+
+#ifdef PROFILER
+    // The flock times its own phases on the simulation thread, the frame's phases are timed here
+    struct Profiler frameProfiler;
+    InitializeProfiler(&frameProfiler);
+    guiState.frameProfiler = &frameProfiler;
+    FILE *profilerCsvFile = NULL;
+    if (profilerCsvPath != NULL) {
+        profilerCsvFile = OpenProfilerCsv(profilerCsvPath);
+        flockState.profiler.csvFile = profilerCsvFile;
+        frameProfiler.csvFile = profilerCsvFile;
+    }
+#endif /* ifdef PROFILER */
+
+    // The flock is updated on a background thread while the previous update is drawn
+    struct FlockThread flockThread;
+    if (!StartFlockThread(&flockThread, &flockState)) {
+        TraceLog(LOG_FATAL, "Failed to start simulation thread. Exiting.");
+#ifdef PROFILER
+        if (profilerCsvFile != NULL) {
+            fclose(profilerCsvFile);
+        }
+#endif /* ifdef PROFILER */
+        DestroyBoidBatch(&boidBatch);
+        DestroyFlock(&flockState);
+        CloseWindow();
+        return EXIT_FAILURE;
+    }
 
-    InitWindow(screenWidth, screenHeight, "Boids");
-    SetTargetFPS(60);
+#ifdef TRACING
+    SetTraceThreadName("Main");
+    int tracesCount = 0;
+#endif /* ifdef TRACING */
 
     while (!WindowShouldClose()) {
         // Update
-        UpdateFlock(&flockState);
+        // Start this frame's update and get the result of the last one, the flock must not be touched directly until
+        // the thread is stopped
+#ifdef TRACING
+        // Captures the last few seconds of every thread, for when something goes wrong while playing
+        if (IsKeyPressed(KEY_F9)) {
+            const char *tracePath = TextFormat("boids-trace-%d.json", ++tracesCount);
+            if (WriteTrace(tracePath)) {
+                TraceLog(LOG_INFO, "Wrote trace to %s", tracePath);
+            }
+        }
+#endif /* ifdef TRACING */
+
+        PROFILER_BEGIN(PROFILER_PHASE_FLOCK_WAIT);
+        TRACE_BEGIN(SwapFlockThread);
+        const struct FlockSnapshot *flockSnapshot = SwapFlockThread(&flockThread, GetFrameTime());
+        TRACE_END(SwapFlockThread);
+        PROFILER_END(&frameProfiler, PROFILER_PHASE_FLOCK_WAIT, flockSnapshot->boidsCount);
+
+        UpdateFlockCamera(&camera, flockSnapshot);
+        guiState.camera = camera;
+
+        if (IsKeyPressed(KEY_O)) {
+            PushFlockCommand(&flockThread,
+                             (struct FlockCommand){
+                                 .type = FLOCK_COMMAND_ADD_OBSTACLE,
+                                 .obstacle = CreatePlacedObstacle(GetScreenToWorld2D(GetMousePosition(), camera)),
+                             });
+        }
 
         // Draw
         BeginDrawing();
 
         ClearBackground(DARKGRAY);
 
-        // Draw boids
-        for (int i = 0; i < flockState.boidsCount; i++) {
-            DrawBoid(&flockState.boids[i]);
-        }
+        // Draw boids, moved along their velocity by the time since the last step so they move smoothly between steps
+        PROFILER_BEGIN(PROFILER_PHASE_DRAW_BOIDS);
+        TRACE_BEGIN(DrawBoidBatch);
+        BeginMode2D(camera);
+        DrawFlockObstacles(flockSnapshot);
+        DrawBoidBatch(&boidBatch, &flockSnapshot->boids, GetDrawnBoidSpecies(flockSnapshot), flockSnapshot->boidsCount,
+                      flockSnapshot->clock.accumulator, GetFlockCameraView(camera), camera.zoom);
+        EndMode2D();
+        TRACE_END(DrawBoidBatch);
+        PROFILER_END(&frameProfiler, PROFILER_PHASE_DRAW_BOIDS, flockSnapshot->boidsCount);
 
-        // Draw GUI
-        const struct GuiResult guiResult = DrawGui(&guiState, &flockState);
+        // Draw GUI, changes are applied by the simulation thread before its next update
+        PROFILER_BEGIN(PROFILER_PHASE_DRAW_GUI);
+        TRACE_BEGIN(DrawGui);
+        struct GuiResult guiResult = DrawGui(&guiState, flockSnapshot);
+        TRACE_END(DrawGui);
+        PROFILER_END(&frameProfiler, PROFILER_PHASE_DRAW_GUI, flockSnapshot->boidsCount);
         if (guiResult.parametersPanelResult.hasFlockConfigChanged) {
+            struct FlockCommand command = {
+                .type = FLOCK_COMMAND_MODIFY_CONFIG,
+                .config = guiResult.parametersPanelResult.newFlockConfig,
+            };
             if (guiResult.parametersPanelResult.resetBoids) {
-                DestroyFlock(&flockState);
-                if (!InitializeFlock(&flockState, guiResult.parametersPanelResult.newFlockConfig)) {
-                    TraceLog(LOG_FATAL, "Failed to reinitialise flock. Exiting.");
-                }
-            } else {
-                ModifyFlockConfig(&flockState, guiResult.parametersPanelResult.newFlockConfig);
+                // Respawn with a new seed rather than repeating the same flock
+                command.type = FLOCK_COMMAND_RESET;
+                command.config.seed = (unsigned int)GetRandomValue(0, INT_MAX);
             }
+            PushFlockCommand(&flockThread, command);
+        }
+        if (guiResult.parametersPanelResult.clearObstacles) {
+            PushFlockCommand(&flockThread, (struct FlockCommand){.type = FLOCK_COMMAND_CLEAR_OBSTACLES});
         }
 #ifdef DEBUG
-        flockState.isPaused = guiResult.debug_inspectionPanelResult.isFlockPaused;
-        flockState.doStep = guiResult.debug_inspectionPanelResult.doStepFlock;
+        PushFlockCommand(&flockThread, (struct FlockCommand){
+                                           .type = FLOCK_COMMAND_DEBUG_SET_PAUSED,
+                                           .isPaused = guiResult.debug_inspectionPanelResult.isFlockPaused,
+                                           .doStep = guiResult.debug_inspectionPanelResult.doStepFlock,
+                                       });
 #endif /* ifdef DEBUG */
 
+        // Includes waiting for the GPU and for the target frame rate
+        PROFILER_BEGIN(PROFILER_PHASE_PRESENT);
+        TRACE_BEGIN(EndDrawing);
         EndDrawing();
+        TRACE_END(EndDrawing);
+        PROFILER_END(&frameProfiler, PROFILER_PHASE_PRESENT, flockSnapshot->boidsCount);
     }
 
+    StopFlockThread(&flockThread);
+#ifdef TRACING
+    if (WriteTrace("boids-trace.json")) {
+        TraceLog(LOG_INFO, "Wrote trace to boids-trace.json");
+    }
+    ShutdownTrace();
+#endif /* ifdef TRACING */
+#ifdef PROFILER
+    if (profilerCsvFile != NULL) {
+        fclose(profilerCsvFile);
+    }
+#endif /* ifdef PROFILER */
+    DestroyBoidBatch(&boidBatch);
     DestroyFlock(&flockState);
     CloseWindow();
     return EXIT_SUCCESS;
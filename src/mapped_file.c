@@ -0,0 +1,182 @@
+#include "mapped_file.h"
+
+#include "flock_log.h"
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+// Leave out the parts of windows.h that clash with raylib.h
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#define NOUSER
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* ifdef _WIN32 */
+
+bool OpenMappedFile(struct MappedFile *mappedFile, const char *path) {
+    if (mappedFile == NULL || path == NULL) {
+        FlockLog(LOG_ERROR, "OpenMappedFile: Recieved NULL pointer.");
+        return false;
+    }
+
+    *mappedFile = (struct MappedFile){0};
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        FlockLog(LOG_ERROR, "OpenMappedFile: Failed to open %s.", path);
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        FlockLog(LOG_ERROR, "OpenMappedFile: %s is empty or its size couldn't be read.", path);
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void *data = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (data == NULL) {
+        FlockLog(LOG_ERROR, "OpenMappedFile: Failed to map %s.", path);
+        if (mapping != NULL) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return false;
+    }
+
+    *mappedFile = (struct MappedFile){
+        .data = data,
+        .size = (size_t)fileSize.QuadPart,
+        .isWritable = false,
+        .file = file,
+        .mapping = mapping,
+    };
+#else
+    const int file = open(path, O_RDONLY);
+    if (file < 0) {
+        FlockLog(LOG_ERROR, "OpenMappedFile: Failed to open %s.", path);
+        return false;
+    }
+    struct stat fileStatus;
+    if (fstat(file, &fileStatus) != 0 || fileStatus.st_size == 0) {
+        FlockLog(LOG_ERROR, "OpenMappedFile: %s is empty or its size couldn't be read.", path);
+        close(file);
+        return false;
+    }
+    void *data = mmap(NULL, (size_t)fileStatus.st_size, PROT_READ, MAP_SHARED, file, 0);
+    if (data == MAP_FAILED) {
+        FlockLog(LOG_ERROR, "OpenMappedFile: Failed to map %s.", path);
+        close(file);
+        return false;
+    }
+
+    *mappedFile = (struct MappedFile){
+        .data = data,
+        .size = (size_t)fileStatus.st_size,
+        .isWritable = false,
+        .file = file,
+    };
+#endif /* ifdef _WIN32 */
+
+    return true;
+}
+
+bool CreateMappedFile(struct MappedFile *mappedFile, const char *path, const size_t size) {
+    if (mappedFile == NULL || path == NULL) {
+        FlockLog(LOG_ERROR, "CreateMappedFile: Recieved NULL pointer.");
+        return false;
+    }
+    if (size == 0) {
+        FlockLog(LOG_ERROR, "CreateMappedFile: Can't map an empty file.");
+        return false;
+    }
+
+    *mappedFile = (struct MappedFile){0};
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        FlockLog(LOG_ERROR, "CreateMappedFile: Failed to create %s.", path);
+        return false;
+    }
+    // Mapping a view larger than the file grows the file to the mapping's size
+    HANDLE mapping =
+        CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)size >> 32U), (DWORD)size, NULL);
+    void *data = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size) : NULL;
+    if (data == NULL) {
+        FlockLog(LOG_ERROR, "CreateMappedFile: Failed to map %zu bytes of %s.", size, path);
+        if (mapping != NULL) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return false;
+    }
+
+    *mappedFile = (struct MappedFile){
+        .data = data,
+        .size = size,
+        .isWritable = true,
+        .file = file,
+        .mapping = mapping,
+    };
+#else
+    const int file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) {
+        FlockLog(LOG_ERROR, "CreateMappedFile: Failed to create %s.", path);
+        return false;
+    }
+    if (ftruncate(file, (off_t)size) != 0) {
+        FlockLog(LOG_ERROR, "CreateMappedFile: Failed to grow %s to %zu bytes.", path, size);
+        close(file);
+        return false;
+    }
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (data == MAP_FAILED) {
+        FlockLog(LOG_ERROR, "CreateMappedFile: Failed to map %zu bytes of %s.", size, path);
+        close(file);
+        return false;
+    }
+
+    *mappedFile = (struct MappedFile){
+        .data = data,
+        .size = size,
+        .isWritable = true,
+        .file = file,
+    };
+#endif /* ifdef _WIN32 */
+
+    return true;
+}
+
+void CloseMappedFile(struct MappedFile *mappedFile) {
+    if (mappedFile == NULL) {
+        FlockLog(LOG_ERROR, "CloseMappedFile: Recieved NULL pointer to mappedFile.");
+        return;
+    }
+    if (mappedFile->data == NULL) {
+        return;
+    }
+
+#ifdef _WIN32
+    if (mappedFile->isWritable) {
+        FlushViewOfFile(mappedFile->data, 0);
+    }
+    UnmapViewOfFile(mappedFile->data);
+    CloseHandle(mappedFile->mapping);
+    CloseHandle(mappedFile->file);
+#else
+    if (mappedFile->isWritable) {
+        msync(mappedFile->data, mappedFile->size, MS_SYNC);
+    }
+    munmap(mappedFile->data, mappedFile->size);
+    close(mappedFile->file);
+#endif /* ifdef _WIN32 */
+
+    *mappedFile = (struct MappedFile){0};
+}
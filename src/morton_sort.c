@@ -0,0 +1,125 @@
+#include "morton_sort.h"
+
+#include "arena.h"
+#include "boid.h"
+#include "flock_log.h"
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MORTON_RADIX_BUCKETS (1 << MORTON_RADIX_BITS)
+#define MORTON_COORDINATE_MAX ((1U << MORTON_COORDINATE_BITS) - 1U)
+
+size_t GetMortonSortArenaSize(const int boidsCapacity) {
+    return (GetArenaAllocationSize(sizeof(uint32_t) * (size_t)boidsCapacity) +
+            GetArenaAllocationSize(sizeof(int) * (size_t)boidsCapacity)) *
+           2;
+}
+
+bool InitializeMortonSortBuffers(struct MortonSortBuffers *buffers, struct Arena *arena, const int boidsCapacity) {
+    if (buffers == NULL || arena == NULL) {
+        FlockLog(LOG_ERROR, "InitializeMortonSortBuffers: Recieved NULL pointer.");
+        return false;
+    }
+
+    *buffers = (struct MortonSortBuffers){.boidsCapacity = boidsCapacity};
+    for (int half = 0; half < 2; half++) {
+        buffers->keys[half] = AllocateFromArena(arena, sizeof(uint32_t) * (size_t)boidsCapacity);
+        buffers->indices[half] = AllocateFromArena(arena, sizeof(int) * (size_t)boidsCapacity);
+        if (buffers->keys[half] == NULL || buffers->indices[half] == NULL) {
+            FlockLog(LOG_ERROR, "InitializeMortonSortBuffers: The arena has no room for %d boids.", boidsCapacity);
+            *buffers = (struct MortonSortBuffers){0};
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Internal function that quantises a coordinate to MORTON_COORDINATE_BITS bits across [start, start + size]
+static uint32_t QuantiseMortonCoordinate(const float value, const float start, const float size) {
+    const float scaled = ((value - start) / size) * (float)MORTON_COORDINATE_MAX;
+    // Also catches NaN
+    if (!(scaled > 0.F)) {
+        return 0U;
+    }
+    if (scaled >= (float)MORTON_COORDINATE_MAX) {
+        return MORTON_COORDINATE_MAX;
+    }
+    return (uint32_t)scaled;
+}
+
+// Internal function that spreads the low 16 bits of the value out to the even bits
+static uint32_t SpreadMortonBits(uint32_t value) {
+    value = (value | (value << 8)) & 0x00FF00FFU;
+    value = (value | (value << 4)) & 0x0F0F0F0FU;
+    value = (value | (value << 2)) & 0x33333333U;
+    value = (value | (value << 1)) & 0x55555555U;
+    return value;
+}
+
+uint32_t GetMortonKey(const Vector2 position, const Rectangle bounds) {
+    const uint32_t x = QuantiseMortonCoordinate(position.x, bounds.x, bounds.width);
+    const uint32_t y = QuantiseMortonCoordinate(position.y, bounds.y, bounds.height);
+    return SpreadMortonBits(x) | (SpreadMortonBits(y) << 1);
+}
+
+const int *SortBoidsByMortonKey(struct MortonSortBuffers *buffers, const struct BoidArrays *boids,
+                                const int boidsCount, const Rectangle bounds) {
+    if (buffers == NULL || boids == NULL) {
+        FlockLog(LOG_ERROR, "SortBoidsByMortonKey: Recieved NULL pointer.");
+        return NULL;
+    }
+    if (boidsCount > buffers->boidsCapacity) {
+        FlockLog(LOG_ERROR, "SortBoidsByMortonKey: %d boids exceeds the capacity of %d.", boidsCount,
+                 buffers->boidsCapacity);
+        return NULL;
+    }
+
+    uint32_t *keys = buffers->keys[0];
+    int *indices = buffers->indices[0];
+    uint32_t mixedBits = 0U;
+    for (int i = 0; i < boidsCount; i++) {
+        keys[i] = GetMortonKey((Vector2){.x = boids->positionsX[i], .y = boids->positionsY[i]}, bounds);
+        indices[i] = i;
+        mixedBits |= keys[i] ^ keys[0];
+    }
+
+    // Least significant digit first, each pass is stable so the earlier passes' order is kept within each bucket
+    int half = 0;
+    for (int shift = 0; shift < 32; shift += MORTON_RADIX_BITS) {
+        // Skip digits that are the same for every boid, e.g. the high bits when the flock only covers part of the
+        // bounds
+        if (((mixedBits >> shift) & (MORTON_RADIX_BUCKETS - 1U)) == 0U) {
+            continue;
+        }
+
+        const uint32_t *sourceKeys = buffers->keys[half];
+        const int *sourceIndices = buffers->indices[half];
+        uint32_t *targetKeys = buffers->keys[1 - half];
+        int *targetIndices = buffers->indices[1 - half];
+
+        int bucketStarts[MORTON_RADIX_BUCKETS];
+        memset(bucketStarts, 0, sizeof(bucketStarts));
+        for (int n = 0; n < boidsCount; n++) {
+            bucketStarts[(sourceKeys[n] >> shift) & (MORTON_RADIX_BUCKETS - 1U)]++;
+        }
+        int start = 0;
+        for (int bucket = 0; bucket < MORTON_RADIX_BUCKETS; bucket++) {
+            const int count = bucketStarts[bucket];
+            bucketStarts[bucket] = start;
+            start += count;
+        }
+        for (int n = 0; n < boidsCount; n++) {
+            const int target = bucketStarts[(sourceKeys[n] >> shift) & (MORTON_RADIX_BUCKETS - 1U)]++;
+            targetKeys[target] = sourceKeys[n];
+            targetIndices[target] = sourceIndices[n];
+        }
+        half = 1 - half;
+    }
+
+    return buffers->indices[half];
+}
@@ -0,0 +1,298 @@
+#include "neighbour_list.h"
+
+#include "boid.h"
+#include "flock_log.h"
+#include "grid.h"
+#include "steering.h"
+#include "worker_pool.h"
+
+#include <limits.h>
+#include <math.h>
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+void InitializeNeighbourLists(struct NeighbourLists *lists) {
+    if (lists == NULL) {
+        FlockLog(LOG_ERROR, "InitializeNeighbourLists: Recieved NULL pointer to lists.");
+        return;
+    }
+
+    *lists = (struct NeighbourLists){0};
+}
+
+// Internal function that frees the per boid buffers, leaving the neighbours themselves
+static void FreeNeighbourListBoids(struct NeighbourLists *lists) {
+    free(lists->starts);
+    free(lists->builtPositionsX);
+    free(lists->builtPositionsY);
+    free(lists->isMoved);
+    free(lists->movedIndices);
+    free(lists->movedSlots);
+    FreeBoidArrays(&lists->movedBoids);
+    DestroySpatialGrid(&lists->movedGrid);
+
+    lists->movedBoids = (struct BoidArrays){0};
+    lists->starts = NULL;
+    lists->builtPositionsX = NULL;
+    lists->builtPositionsY = NULL;
+    lists->isMoved = NULL;
+    lists->movedIndices = NULL;
+    lists->movedSlots = NULL;
+    lists->boidsCapacity = 0;
+    lists->movedCapacity = 0;
+}
+
+// Internal function that grows the per boid buffers to hold at least the given number of boids, the contents are not
+// kept.
+static bool ReserveNeighbourListBoids(struct NeighbourLists *lists, const int boidsCount) {
+    if (boidsCount <= lists->boidsCapacity) {
+        return true;
+    }
+
+    FreeNeighbourListBoids(lists);
+
+    const int movedCapacity = (boidsCount / NEIGHBOUR_LIST_MAX_MOVED_DIVISOR) + 1;
+    lists->starts = malloc(sizeof(int) * (boidsCount + 1));
+    lists->builtPositionsX = malloc(sizeof(float) * boidsCount);
+    lists->builtPositionsY = malloc(sizeof(float) * boidsCount);
+    lists->isMoved = malloc(sizeof(bool) * boidsCount);
+    lists->movedSlots = malloc(sizeof(int) * boidsCount);
+    lists->movedIndices = malloc(sizeof(int) * movedCapacity);
+    if (lists->starts == NULL || lists->builtPositionsX == NULL || lists->builtPositionsY == NULL ||
+        lists->isMoved == NULL || lists->movedSlots == NULL || lists->movedIndices == NULL ||
+        !AllocateBoidArrays(&lists->movedBoids, movedCapacity) ||
+        !InitializeSpatialGrid(&lists->movedGrid, movedCapacity)) {
+        FlockLog(LOG_ERROR, "BuildNeighbourLists: Failed to allocate memory for the lists of %d boids.", boidsCount);
+        FreeNeighbourListBoids(lists);
+        return false;
+    }
+    lists->boidsCapacity = boidsCount;
+    lists->movedCapacity = movedCapacity;
+
+    return true;
+}
+
+// Shared inputs of the tasks that build the lists
+struct NeighbourListTaskContext {
+    struct NeighbourLists *lists;
+    const struct SpatialGrid *grid;
+    float rangeSquared;
+};
+
+// Internal function that counts the neighbours of the boids at [start, end) of the grid's cell order, the count for
+// slot s is written to starts[s + 1]
+static void CountNeighboursTask(void *context, const int start, const int end) {
+    const struct NeighbourListTaskContext *taskContext = context;
+    const struct SpatialGrid *grid = taskContext->grid;
+    const float *positionsX = grid->sortedBoids.positionsX;
+    const float *positionsY = grid->sortedBoids.positionsY;
+
+    for (int slot = start; slot < end; slot++) {
+        const Vector2 position = {.x = positionsX[slot], .y = positionsY[slot]};
+        struct SpatialGridSpan spans[SPATIAL_GRID_MAX_SPANS];
+        const int spansCount = GetSpatialGridNeighbourSpans(grid, position, spans);
+
+        int count = 0;
+        for (int span = 0; span < spansCount; span++) {
+            for (int other = spans[span].start; other < spans[span].end; other++) {
+                const float offsetX = position.x - positionsX[other];
+                const float offsetY = position.y - positionsY[other];
+                const bool isInRange = (offsetX * offsetX) + (offsetY * offsetY) < taskContext->rangeSquared;
+                count += (isInRange && other != slot) ? 1 : 0;
+            }
+        }
+        taskContext->lists->starts[slot + 1] = count;
+    }
+}
+
+// Internal function that writes the neighbours of the boids at [start, end) of the grid's cell order, starting at the
+// offsets found from the counts
+static void FillNeighboursTask(void *context, const int start, const int end) {
+    const struct NeighbourListTaskContext *taskContext = context;
+    const struct SpatialGrid *grid = taskContext->grid;
+    struct NeighbourLists *lists = taskContext->lists;
+    const float *positionsX = grid->sortedBoids.positionsX;
+    const float *positionsY = grid->sortedBoids.positionsY;
+
+    for (int slot = start; slot < end; slot++) {
+        const Vector2 position = {.x = positionsX[slot], .y = positionsY[slot]};
+        struct SpatialGridSpan spans[SPATIAL_GRID_MAX_SPANS];
+        const int spansCount = GetSpatialGridNeighbourSpans(grid, position, spans);
+
+        int *neighbour = &lists->neighbours[lists->starts[slot]];
+        for (int span = 0; span < spansCount; span++) {
+            for (int other = spans[span].start; other < spans[span].end; other++) {
+                const float offsetX = position.x - positionsX[other];
+                const float offsetY = position.y - positionsY[other];
+                if (other != slot && (offsetX * offsetX) + (offsetY * offsetY) < taskContext->rangeSquared) {
+                    *neighbour++ = other;
+                }
+            }
+        }
+    }
+}
+
+bool BuildNeighbourLists(struct NeighbourLists *lists, const struct SpatialGrid *grid, const struct BoidArrays *boids,
+                         const int boidsCount, const float range, const float skin, struct WorkerPool *workerPool) {
+    if (lists == NULL || grid == NULL || boids == NULL || workerPool == NULL) {
+        FlockLog(LOG_ERROR, "BuildNeighbourLists: Recieved NULL pointer.");
+        return false;
+    }
+
+    lists->boidsCount = 0;
+    if (!ReserveNeighbourListBoids(lists, boidsCount)) {
+        return false;
+    }
+
+    const float listRange = range + skin;
+    struct NeighbourListTaskContext context = {
+        .lists = lists,
+        .grid = grid,
+        .rangeSquared = listRange * listRange,
+    };
+    RunWorkerPool(workerPool, CountNeighboursTask, &context, boidsCount);
+
+    // Turn the counts into offsets
+    long long neighboursCount = 0;
+    lists->starts[0] = 0;
+    for (int slot = 0; slot < boidsCount; slot++) {
+        neighboursCount += lists->starts[slot + 1];
+        if (neighboursCount > INT_MAX) {
+            FlockLog(LOG_ERROR, "BuildNeighbourLists: Too many neighbours for the lists, the range is too large.");
+            return false;
+        }
+        lists->starts[slot + 1] = (int)neighboursCount;
+    }
+
+    if (neighboursCount > lists->neighboursCapacity) {
+        // Leave some room so the lists don't have to grow on every build while the flock gathers
+        long long newCapacity = neighboursCount + (neighboursCount / 4);
+        newCapacity = newCapacity > INT_MAX ? INT_MAX : newCapacity;
+        int *neighbours = realloc(lists->neighbours, sizeof(int) * (size_t)newCapacity);
+        if (neighbours == NULL) {
+            FlockLog(LOG_ERROR, "BuildNeighbourLists: Failed to allocate memory for %lld neighbours.", newCapacity);
+            return false;
+        }
+        lists->neighbours = neighbours;
+        lists->neighboursCapacity = (int)newCapacity;
+    }
+    RunWorkerPool(workerPool, FillNeighboursTask, &context, boidsCount);
+
+    memcpy(lists->builtPositionsX, grid->sortedBoids.positionsX, sizeof(float) * boidsCount);
+    memcpy(lists->builtPositionsY, grid->sortedBoids.positionsY, sizeof(float) * boidsCount);
+    memset(lists->isMoved, 0, sizeof(bool) * boidsCount);
+    lists->movedCount = 0;
+    lists->boidsCount = boidsCount;
+    lists->range = range;
+    lists->skin = skin;
+
+    return true;
+}
+
+bool UpdateNeighbourListMoves(struct NeighbourLists *lists, struct SpatialGrid *grid, const struct BoidArrays *boids,
+                              const int boidsCount, const float range, const float skin, const Rectangle bounds) {
+    if (lists == NULL || grid == NULL || boids == NULL) {
+        FlockLog(LOG_ERROR, "UpdateNeighbourListMoves: Recieved NULL pointer.");
+        return false;
+    }
+    if (lists->boidsCount == 0 || lists->boidsCount != boidsCount || lists->range != range || lists->skin != skin) {
+        return false;
+    }
+
+    const float halfSkin = skin / 2.F;
+    const float halfSkinSquared = halfSkin * halfSkin;
+    lists->movedCount = 0;
+    for (int slot = 0; slot < boidsCount; slot++) {
+        const int i = grid->sortedIndices[slot];
+        Boid boid = GetBoidFromArrays(boids, i);
+        const float offsetX = boid.position.x - lists->builtPositionsX[slot];
+        const float offsetY = boid.position.y - lists->builtPositionsY[slot];
+        const bool isMoved = (offsetX * offsetX) + (offsetY * offsetY) > halfSkinSquared;
+        lists->isMoved[slot] = isMoved;
+        if (isMoved) {
+            if (lists->movedCount == lists->movedCapacity) {
+                return false;
+            }
+            SetBoidInArrays(&lists->movedBoids, lists->movedCount, boid);
+            lists->movedIndices[lists->movedCount++] = slot;
+            // Out of range of every position, the kernels' masks also clear the infinities from their sums
+            boid = (Boid){.position = {.x = INFINITY, .y = INFINITY}, .velocity = {.x = 0.F, .y = 0.F}};
+        }
+        SetBoidInArrays(&grid->sortedBoids, slot, boid);
+    }
+    if (lists->movedCount == 0) {
+        return true;
+    }
+
+    // Built the same way as the grid the lists were built from, so boids far outside the bounds of an open world
+    // aren't all put in the edge cells
+    if (grid->isSparse) {
+        BuildSparseSpatialGrid(&lists->movedGrid, &lists->movedBoids, NULL, 1, lists->movedCount, range);
+    } else {
+        BuildSpatialGrid(&lists->movedGrid, &lists->movedBoids, NULL, 1, lists->movedCount, bounds, range);
+    }
+    for (int movedSlot = 0; movedSlot < lists->movedCount; movedSlot++) {
+        lists->movedSlots[lists->movedIndices[lists->movedGrid.sortedIndices[movedSlot]]] = movedSlot;
+    }
+
+    return true;
+}
+
+void AccumulateNeighbourListSteering(const struct NeighbourLists *lists, const struct SpatialGrid *grid,
+                                     const int sortedIndex, const struct SteeringQuery *query, SteeringKernel kernel,
+                                     SteeringIndexedKernel indexedKernel, struct SteeringSums *sums) {
+    const Vector2 position = {.x = query->positionX, .y = query->positionY};
+    struct SpatialGridSpan spans[SPATIAL_GRID_MAX_SPANS];
+
+    if (lists->isMoved[sortedIndex]) {
+        // The boid's list is out of date. Every boid that hasn't moved and is now in range of it was within range plus
+        // half the skin of it when the grid was built, so it is in the cells around it. The moved boids, including
+        // this one, are hidden in the grid.
+        const int spansCount = GetSpatialGridNeighbourSpans(grid, position, spans);
+        for (int span = 0; span < spansCount; span++) {
+            kernel(query, &grid->sortedBoids, spans[span].start, spans[span].end, sums);
+        }
+    } else {
+        const int start = lists->starts[sortedIndex];
+        indexedKernel(query, &grid->sortedBoids, &lists->neighbours[start], lists->starts[sortedIndex + 1] - start,
+                      sums);
+    }
+
+    // Boids that have moved are only found through their own grid, skipping the boid itself
+    if (lists->movedCount == 0) {
+        return;
+    }
+    const int movedSlot = lists->isMoved[sortedIndex] ? lists->movedSlots[sortedIndex] : -1;
+    const int spansCount = GetSpatialGridNeighbourSpans(&lists->movedGrid, position, spans);
+    for (int span = 0; span < spansCount; span++) {
+        if (movedSlot >= spans[span].start && movedSlot < spans[span].end) {
+            kernel(query, &lists->movedGrid.sortedBoids, spans[span].start, movedSlot, sums);
+            kernel(query, &lists->movedGrid.sortedBoids, movedSlot + 1, spans[span].end, sums);
+        } else {
+            kernel(query, &lists->movedGrid.sortedBoids, spans[span].start, spans[span].end, sums);
+        }
+    }
+}
+
+void InvalidateNeighbourLists(struct NeighbourLists *lists) {
+    if (lists == NULL) {
+        FlockLog(LOG_ERROR, "InvalidateNeighbourLists: Recieved NULL pointer to lists.");
+        return;
+    }
+
+    lists->boidsCount = 0;
+}
+
+void DestroyNeighbourLists(struct NeighbourLists *lists) {
+    if (lists == NULL) {
+        FlockLog(LOG_ERROR, "DestroyNeighbourLists: Recieved NULL pointer to lists.");
+        return;
+    }
+
+    FreeNeighbourListBoids(lists);
+    free(lists->neighbours);
+
+    *lists = (struct NeighbourLists){0};
+}
@@ -0,0 +1,240 @@
+#include "obstacle_field.h"
+
+#include "flock_log.h"
+
+#include <math.h>
+#include <raylib.h>
+#include <raymath.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+void InitializeObstacleField(struct ObstacleField *field) {
+    if (field == NULL) {
+        FlockLog(LOG_ERROR, "InitializeObstacleField: Recieved NULL pointer to field.");
+        return;
+    }
+
+    *field = (struct ObstacleField){0};
+}
+
+// Internal function that gets the signed distance to a circle's edge and the direction away from its centre
+static float GetCircleDistance(const Vector2 center, const float radius, const Vector2 point, Vector2 *gradient) {
+    const Vector2 offset = Vector2Subtract(point, center);
+    const float length = Vector2Length(offset);
+    // Any direction leads out from the centre
+    *gradient = length > 0.F ? Vector2Scale(offset, 1.F / length) : (Vector2){.x = 1.F, .y = 0.F};
+    return length - radius;
+}
+
+// Internal function that gets the signed distance to a rectangle's edge and the direction away from the nearest edge
+static float GetRectangleDistance(const Rectangle rectangle, const Vector2 point, Vector2 *gradient) {
+    // Works from the centre so rectangles with a negative width or height are handled too
+    const Vector2 halfSize = {.x = fabsf(rectangle.width) / 2.F, .y = fabsf(rectangle.height) / 2.F};
+    const Vector2 offset = {
+        .x = point.x - (rectangle.x + (rectangle.width / 2.F)),
+        .y = point.y - (rectangle.y + (rectangle.height / 2.F)),
+    };
+    const float signX = offset.x < 0.F ? -1.F : 1.F;
+    const float signY = offset.y < 0.F ? -1.F : 1.F;
+    // Distances past each pair of edges, negative inside them
+    const float outsideX = fabsf(offset.x) - halfSize.x;
+    const float outsideY = fabsf(offset.y) - halfSize.y;
+
+    if (outsideX > 0.F || outsideY > 0.F) {
+        // Outside, the nearest point is on an edge or a corner
+        const Vector2 outside = {.x = fmaxf(outsideX, 0.F) * signX, .y = fmaxf(outsideY, 0.F) * signY};
+        const float length = Vector2Length(outside);
+        *gradient = Vector2Scale(outside, 1.F / length);
+        return length;
+    }
+
+    // Inside, the nearest edge is the way out
+    if (outsideX > outsideY) {
+        *gradient = (Vector2){.x = signX, .y = 0.F};
+        return outsideX;
+    }
+    *gradient = (Vector2){.x = 0.F, .y = signY};
+    return outsideY;
+}
+
+float GetFlockObstacleDistance(const struct FlockObstacle *obstacle, const Vector2 point, Vector2 *gradient) {
+    if (obstacle == NULL || gradient == NULL) {
+        FlockLog(LOG_ERROR, "GetFlockObstacleDistance: Recieved NULL pointer.");
+        return INFINITY;
+    }
+
+    switch (obstacle->shape) {
+    case FLOCK_OBSTACLE_CIRCLE:
+        return GetCircleDistance(obstacle->center, obstacle->radius, point, gradient);
+    case FLOCK_OBSTACLE_RECTANGLE:
+        return GetRectangleDistance(obstacle->rectangle, point, gradient);
+    default:
+        *gradient = Vector2Zero();
+        return INFINITY;
+    }
+}
+
+// Internal function that grows the samples to hold at least the given number, the contents are not kept
+static bool ReserveObstacleFieldSamples(struct ObstacleField *field, const int samplesCount) {
+    if (samplesCount <= field->samplesCapacity) {
+        return true;
+    }
+
+    struct ObstacleFieldSample *samples = realloc(field->samples, sizeof(struct ObstacleFieldSample) * samplesCount);
+    if (samples == NULL) {
+        return false;
+    }
+    field->samples = samples;
+    field->samplesCapacity = samplesCount;
+    return true;
+}
+
+bool BakeObstacleField(struct ObstacleField *field, const struct FlockObstacle *obstacles, const int obstaclesCount,
+                       const Rectangle bounds) {
+    if (field == NULL || (obstacles == NULL && obstaclesCount > 0)) {
+        FlockLog(LOG_ERROR, "BakeObstacleField: Recieved NULL pointer.");
+        return false;
+    }
+
+    field->obstaclesCount = 0;
+    field->columns = 0;
+    field->rows = 0;
+    if (obstaclesCount <= 0) {
+        return true;
+    }
+
+    // Start from the size that keeps the samples under the limit for the area, then grow it until the rounding up to
+    // whole cells fits too (very long and thin bounds need a few steps)
+    float cellSize =
+        fmaxf(OBSTACLE_FIELD_CELL_SIZE, sqrtf((bounds.width * bounds.height) / (float)OBSTACLE_FIELD_MAX_SAMPLES));
+    int columns;
+    int rows;
+    for (;;) {
+        columns = (int)fmaxf(ceilf(bounds.width / cellSize), 1.F);
+        rows = (int)fmaxf(ceilf(bounds.height / cellSize), 1.F);
+        if ((double)(columns + 1) * (double)(rows + 1) <= (double)OBSTACLE_FIELD_MAX_SAMPLES) {
+            break;
+        }
+        cellSize *= 1.1F;
+    }
+
+    const int samplesCount = (columns + 1) * (rows + 1);
+    if (!ReserveObstacleFieldSamples(field, samplesCount)) {
+        FlockLog(LOG_ERROR, "BakeObstacleField: Failed to allocate memory for %d samples.", samplesCount);
+        return false;
+    }
+
+    for (int row = 0; row <= rows; row++) {
+        for (int column = 0; column <= columns; column++) {
+            const Vector2 point = {
+                .x = bounds.x + ((float)column * cellSize),
+                .y = bounds.y + ((float)row * cellSize),
+            };
+
+            // Only the nearest obstacle matters
+            struct ObstacleFieldSample sample = {.distance = INFINITY};
+            for (int i = 0; i < obstaclesCount; i++) {
+                Vector2 gradient = Vector2Zero();
+                const float distance = GetFlockObstacleDistance(&obstacles[i], point, &gradient);
+                if (distance < sample.distance) {
+                    sample = (struct ObstacleFieldSample){
+                        .distance = distance,
+                        .gradientX = gradient.x,
+                        .gradientY = gradient.y,
+                    };
+                }
+            }
+            field->samples[(row * (columns + 1)) + column] = sample;
+        }
+    }
+
+    field->columns = columns;
+    field->rows = rows;
+    field->origin = (Vector2){.x = bounds.x, .y = bounds.y};
+    field->cellSize = cellSize;
+    field->inverseCellSize = 1.F / cellSize;
+    field->obstaclesCount = obstaclesCount;
+    return true;
+}
+
+// Internal function that converts a coordinate to cells from the field's origin, clamped to [0, cellsCount]
+static float GetObstacleFieldCoordinate(const float value, const float origin, const float inverseCellSize,
+                                        const int cellsCount) {
+    const float cells = (value - origin) * inverseCellSize;
+    // Also catches NaN
+    if (!(cells > 0.F)) {
+        return 0.F;
+    }
+    return fminf(cells, (float)cellsCount);
+}
+
+struct ObstacleFieldSample SampleObstacleField(const struct ObstacleField *field, const Vector2 position) {
+    if (field == NULL || field->obstaclesCount == 0) {
+        return (struct ObstacleFieldSample){.distance = INFINITY};
+    }
+
+    const float x = GetObstacleFieldCoordinate(position.x, field->origin.x, field->inverseCellSize, field->columns);
+    const float y = GetObstacleFieldCoordinate(position.y, field->origin.y, field->inverseCellSize, field->rows);
+    // The far edge of the field belongs to the last cell
+    const int column = x < (float)field->columns ? (int)x : field->columns - 1;
+    const int row = y < (float)field->rows ? (int)y : field->rows - 1;
+    const float weightX = x - (float)column;
+    const float weightY = y - (float)row;
+
+    const struct ObstacleFieldSample *top = &field->samples[(row * (field->columns + 1)) + column];
+    const struct ObstacleFieldSample *bottom = top + field->columns + 1;
+    const float topWeights[2] = {(1.F - weightX) * (1.F - weightY), weightX * (1.F - weightY)};
+    const float bottomWeights[2] = {(1.F - weightX) * weightY, weightX * weightY};
+
+    struct ObstacleFieldSample sample = {0};
+    for (int corner = 0; corner < 2; corner++) {
+        sample.distance +=
+            (top[corner].distance * topWeights[corner]) + (bottom[corner].distance * bottomWeights[corner]);
+        sample.gradientX +=
+            (top[corner].gradientX * topWeights[corner]) + (bottom[corner].gradientX * bottomWeights[corner]);
+        sample.gradientY +=
+            (top[corner].gradientY * topWeights[corner]) + (bottom[corner].gradientY * bottomWeights[corner]);
+    }
+
+    // Blending directions shortens them, most of all where the nearest obstacle changes
+    const float gradientLength = sqrtf((sample.gradientX * sample.gradientX) + (sample.gradientY * sample.gradientY));
+    if (gradientLength > 0.F) {
+        sample.gradientX /= gradientLength;
+        sample.gradientY /= gradientLength;
+    }
+    return sample;
+}
+
+void SpreadFlockObstacles(struct FlockObstacle *obstacles, const int obstaclesCount, const Rectangle bounds) {
+    if (obstacles == NULL || obstaclesCount <= 0) {
+        FlockLog(LOG_ERROR, "SpreadFlockObstacles: Recieved NULL pointer or no obstacles.");
+        return;
+    }
+
+    // A grid of cells about as square as the bounds allow, with an obstacle in the middle of each
+    const int columns = (int)fmaxf(ceilf(sqrtf((float)obstaclesCount * bounds.width / bounds.height)), 1.F);
+    const int rows = (obstaclesCount + columns - 1) / columns;
+    const float cellWidth = bounds.width / (float)columns;
+    const float cellHeight = bounds.height / (float)rows;
+    for (int i = 0; i < obstaclesCount; i++) {
+        obstacles[i] = (struct FlockObstacle){
+            .shape = FLOCK_OBSTACLE_CIRCLE,
+            .center =
+                {
+                    .x = bounds.x + (((float)(i % columns) + 0.5F) * cellWidth),
+                    .y = bounds.y + (((float)(i / columns) + 0.5F) * cellHeight),
+                },
+            .radius = fminf(cellWidth, cellHeight) / 4.F,
+        };
+    }
+}
+
+void DestroyObstacleField(struct ObstacleField *field) {
+    if (field == NULL) {
+        FlockLog(LOG_ERROR, "DestroyObstacleField: Recieved NULL pointer to field.");
+        return;
+    }
+
+    free(field->samples);
+    *field = (struct ObstacleField){0};
+}
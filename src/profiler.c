@@ -0,0 +1,115 @@
+#include "profiler.h"
+
+#include "flock_log.h"
+#include "timer.h"
+
+#include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void InitializeProfiler(struct Profiler *profiler) {
+    if (profiler == NULL) {
+        FlockLog(LOG_ERROR, "InitializeProfiler: Recieved NULL pointer to profiler.");
+        return;
+    }
+
+    memset(profiler, 0, sizeof(*profiler));
+}
+
+void RecordProfilerSample(struct Profiler *profiler, const enum ProfilerPhase phase, const double duration,
+                          const int boidsCount) {
+    struct ProfilerPhaseHistory *history = &profiler->phases[phase];
+    history->durations[history->nextSample] = (float)duration;
+    history->boidsCounts[history->nextSample] = boidsCount;
+    history->nextSample = (history->nextSample + 1) % PROFILER_HISTORY_SIZE;
+    if (history->samplesCount < PROFILER_HISTORY_SIZE) {
+        history->samplesCount++;
+    }
+
+    if (profiler->csvFile != NULL) {
+        fprintf(profiler->csvFile, "%.9f,%s,%d,%.0f\n", GetMonotonicTime(), GetProfilerPhaseName(phase), boidsCount,
+                duration * 1e9);
+    }
+}
+
+// Internal function used to sort the durations
+static int CompareFloats(const void *a, const void *b) {
+    const float left = *(const float *)a;
+    const float right = *(const float *)b;
+    return (left > right) - (left < right);
+}
+
+struct ProfilerPhaseSummary SummarizeProfilerPhase(const struct Profiler *profiler, const enum ProfilerPhase phase) {
+    struct ProfilerPhaseSummary summary = {0};
+    if (profiler == NULL || phase < 0 || phase >= PROFILER_PHASES_COUNT) {
+        FlockLog(LOG_ERROR, "SummarizeProfilerPhase: Recieved NULL pointer or invalid phase.");
+        return summary;
+    }
+
+    const struct ProfilerPhaseHistory *history = &profiler->phases[phase];
+    if (history->samplesCount == 0) {
+        return summary;
+    }
+
+    float durations[PROFILER_HISTORY_SIZE];
+    double totalDuration = 0.0;
+    double totalDurationPerBoid = 0.0;
+    int boidSamplesCount = 0;
+    for (int i = 0; i < history->samplesCount; i++) {
+        durations[i] = history->durations[i];
+        totalDuration += history->durations[i];
+        if (history->boidsCounts[i] > 0) {
+            totalDurationPerBoid += history->durations[i] / (double)history->boidsCounts[i];
+            boidSamplesCount++;
+        }
+    }
+    qsort(durations, (size_t)history->samplesCount, sizeof(float), CompareFloats);
+
+    const int lastSample = history->samplesCount - 1;
+    summary.samplesCount = history->samplesCount;
+    summary.mean = (float)(totalDuration * 1e3 / history->samplesCount);
+    summary.median = durations[lastSample / 2] * 1e3F;
+    summary.percentile99 = durations[(lastSample * 99) / 100] * 1e3F;
+    summary.maximum = durations[lastSample] * 1e3F;
+    if (boidSamplesCount > 0) {
+        summary.nanosecondsPerBoid = (float)(totalDurationPerBoid * 1e9 / boidSamplesCount);
+    }
+
+    return summary;
+}
+
+const char *GetProfilerPhaseName(const enum ProfilerPhase phase) {
+    static const char *names[PROFILER_PHASES_COUNT] = {
+        [PROFILER_PHASE_GRID] = "Grid",
+        [PROFILER_PHASE_STEERING] = "Steering",
+        [PROFILER_PHASE_INTEGRATION] = "Integration",
+        [PROFILER_PHASE_SORTING] = "Sorting",
+        [PROFILER_PHASE_RECORDING] = "Recording",
+        [PROFILER_PHASE_FLOCK_WAIT] = "Flock Wait",
+        [PROFILER_PHASE_DRAW_BOIDS] = "Draw Boids",
+        [PROFILER_PHASE_DRAW_GUI] = "Draw GUI",
+        [PROFILER_PHASE_PRESENT] = "Present",
+    };
+
+    if (phase < 0 || phase >= PROFILER_PHASES_COUNT) {
+        return "Unknown";
+    }
+    return names[phase];
+}
+
+FILE *OpenProfilerCsv(const char *path) {
+    if (path == NULL) {
+        FlockLog(LOG_ERROR, "OpenProfilerCsv: Recieved NULL pointer to path.");
+        return NULL;
+    }
+
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        FlockLog(LOG_ERROR, "OpenProfilerCsv: Failed to create %s.", path);
+        return NULL;
+    }
+    fprintf(file, "seconds,phase,boids,nanoseconds\n");
+
+    return file;
+}
@@ -0,0 +1,383 @@
+#include "quadtree.h"
+
+#include "boid.h"
+#include "flock_log.h"
+#include "steering.h"
+
+#include <math.h>
+#include <raylib.h>
+#include <raymath.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Forces that still have to be summed for a node, see AccumulateQuadtreeSteering
+#define QUADTREE_ALIGNMENT 1U
+#define QUADTREE_COHESION 2U
+
+// Each visited node is replaced by at most 4 children, so the stack never holds more than 3 nodes per level
+#define QUADTREE_STACK_SIZE ((QUADTREE_MAX_DEPTH * 3) + 4)
+
+void InitializeFlockQuadtree(struct FlockQuadtree *tree) {
+    if (tree == NULL) {
+        FlockLog(LOG_ERROR, "InitializeFlockQuadtree: Recieved NULL pointer to tree.");
+        return;
+    }
+
+    *tree = (struct FlockQuadtree){0};
+}
+
+// Internal function that grows the per boid buffers to hold at least the given number of boids, the contents are not
+// kept.
+static bool ReserveQuadtreeBoids(struct FlockQuadtree *tree, const int boidsCount) {
+    if (boidsCount <= tree->boidsCapacity) {
+        return true;
+    }
+
+    struct BoidArrays sortedBoids;
+    int *sortedIndices = malloc(sizeof(int) * boidsCount);
+    int *boidSlots = malloc(sizeof(int) * boidsCount);
+    if (sortedIndices == NULL || boidSlots == NULL || !AllocateBoidArrays(&sortedBoids, boidsCount)) {
+        FlockLog(LOG_ERROR, "BuildFlockQuadtree: Failed to allocate memory for a tree of %d boids.", boidsCount);
+        free(sortedIndices);
+        free(boidSlots);
+        return false;
+    }
+
+    if (tree->boidsCapacity > 0) {
+        FreeBoidArrays(&tree->sortedBoids);
+    }
+    free(tree->sortedIndices);
+    free(tree->boidSlots);
+    tree->sortedBoids = sortedBoids;
+    tree->sortedIndices = sortedIndices;
+    tree->boidSlots = boidSlots;
+    tree->boidsCapacity = boidsCount;
+    // The order was lost with the old buffers
+    tree->boidsCount = 0;
+
+    return true;
+}
+
+// Internal function that adds nodes to the end of the tree, returns the index of the first one or -1 if the nodes
+// couldn't be grown.
+static int AddQuadtreeNodes(struct FlockQuadtree *tree, const int count) {
+    if (tree->nodesCount + count > tree->nodesCapacity) {
+        int newCapacity = tree->nodesCapacity * 2;
+        if (newCapacity < tree->nodesCount + count) {
+            newCapacity = tree->nodesCount + count;
+        }
+        struct QuadtreeNode *nodes = realloc(tree->nodes, sizeof(struct QuadtreeNode) * newCapacity);
+        if (nodes == NULL) {
+            FlockLog(LOG_ERROR, "BuildFlockQuadtree: Failed to allocate memory for %d tree nodes.", newCapacity);
+            return -1;
+        }
+        tree->nodes = nodes;
+        tree->nodesCapacity = newCapacity;
+    }
+
+    const int first = tree->nodesCount;
+    tree->nodesCount += count;
+    return first;
+}
+
+// Internal function that moves the boids at [start, end) of the indices with a coordinate below the split to the
+// front, returns the index of the first boid at or above the split.
+static int PartitionQuadtreeBoids(int *indices, const float *coordinates, const int start, const int end,
+                                  const float split) {
+    int low = start;
+    int high = end;
+    while (low < high) {
+        if (coordinates[indices[low]] < split) {
+            low++;
+        } else {
+            high--;
+            const int index = indices[low];
+            indices[low] = indices[high];
+            indices[high] = index;
+        }
+    }
+    return low;
+}
+
+// Internal function that fills in the node for the boids at [start, end) of the sorted indices, which lie in the
+// square with the given corner and size, and builds its children.
+static bool BuildQuadtreeNode(struct FlockQuadtree *tree, const struct BoidArrays *boids, const int nodeIndex,
+                              const int start, const int end, const float squareX, const float squareY,
+                              const float squareSize, const int depth) {
+    struct QuadtreeNode node = {
+        .minX = INFINITY,
+        .minY = INFINITY,
+        .maxX = -INFINITY,
+        .maxY = -INFINITY,
+        .start = start,
+        .end = end,
+    };
+
+    if (end - start <= QUADTREE_LEAF_SIZE || depth >= QUADTREE_MAX_DEPTH) {
+        for (int slot = start; slot < end; slot++) {
+            const int i = tree->sortedIndices[slot];
+            node.minX = fminf(node.minX, boids->positionsX[i]);
+            node.minY = fminf(node.minY, boids->positionsY[i]);
+            node.maxX = fmaxf(node.maxX, boids->positionsX[i]);
+            node.maxY = fmaxf(node.maxY, boids->positionsY[i]);
+            node.positionX += boids->positionsX[i];
+            node.positionY += boids->positionsY[i];
+            node.velocityX += boids->velocitiesX[i];
+            node.velocityY += boids->velocitiesY[i];
+        }
+        tree->nodes[nodeIndex] = node;
+        return true;
+    }
+
+    // Split into quadrants, first by row then by column, so the quadrants are [bounds[q], bounds[q + 1])
+    const float halfSize = squareSize / 2.F;
+    const int rowSplit = PartitionQuadtreeBoids(tree->sortedIndices, boids->positionsY, start, end, squareY + halfSize);
+    const int bounds[5] = {
+        start,
+        PartitionQuadtreeBoids(tree->sortedIndices, boids->positionsX, start, rowSplit, squareX + halfSize),
+        rowSplit,
+        PartitionQuadtreeBoids(tree->sortedIndices, boids->positionsX, rowSplit, end, squareX + halfSize),
+        end,
+    };
+
+    for (int quadrant = 0; quadrant < 4; quadrant++) {
+        if (bounds[quadrant + 1] > bounds[quadrant]) {
+            node.childrenCount++;
+        }
+    }
+    node.firstChild = AddQuadtreeNodes(tree, node.childrenCount);
+    if (node.firstChild < 0) {
+        return false;
+    }
+
+    int child = node.firstChild;
+    for (int quadrant = 0; quadrant < 4; quadrant++) {
+        if (bounds[quadrant + 1] == bounds[quadrant]) {
+            continue;
+        }
+        const float childX = squareX + ((quadrant & 1) != 0 ? halfSize : 0.F);
+        const float childY = squareY + ((quadrant & 2) != 0 ? halfSize : 0.F);
+        if (!BuildQuadtreeNode(tree, boids, child, bounds[quadrant], bounds[quadrant + 1], childX, childY, halfSize,
+                               depth + 1)) {
+            return false;
+        }
+
+        // The nodes may have moved while the child was built
+        const struct QuadtreeNode *childNode = &tree->nodes[child];
+        node.minX = fminf(node.minX, childNode->minX);
+        node.minY = fminf(node.minY, childNode->minY);
+        node.maxX = fmaxf(node.maxX, childNode->maxX);
+        node.maxY = fmaxf(node.maxY, childNode->maxY);
+        node.positionX += childNode->positionX;
+        node.positionY += childNode->positionY;
+        node.velocityX += childNode->velocityX;
+        node.velocityY += childNode->velocityY;
+        child++;
+    }
+
+    tree->nodes[nodeIndex] = node;
+    return true;
+}
+
+bool BuildFlockQuadtree(struct FlockQuadtree *tree, const struct BoidArrays *boids, const int boidsCount) {
+    if (tree == NULL || boids == NULL) {
+        FlockLog(LOG_ERROR, "BuildFlockQuadtree: Recieved NULL pointer.");
+        return false;
+    }
+    if (boidsCount <= 0) {
+        FlockLog(LOG_ERROR, "BuildFlockQuadtree: Failed due to invalid number of boids (%d).", boidsCount);
+        return false;
+    }
+
+    if (!ReserveQuadtreeBoids(tree, boidsCount)) {
+        return false;
+    }
+    // Most boids stay in the same leaf between updates, so starting from the last order keeps the partitioning mostly
+    // within memory it has just touched
+    if (tree->boidsCount != boidsCount) {
+        for (int i = 0; i < boidsCount; i++) {
+            tree->sortedIndices[i] = i;
+        }
+    }
+    tree->boidsCount = 0;
+
+    // Boids can be slightly outside the flock bounds before they wrap around, so the root covers the boids themselves
+    float minX = INFINITY;
+    float minY = INFINITY;
+    float maxX = -INFINITY;
+    float maxY = -INFINITY;
+    for (int i = 0; i < boidsCount; i++) {
+        minX = fminf(minX, boids->positionsX[i]);
+        minY = fminf(minY, boids->positionsY[i]);
+        maxX = fmaxf(maxX, boids->positionsX[i]);
+        maxY = fmaxf(maxY, boids->positionsY[i]);
+    }
+    // Quadrants are square so that the opening angle means the same thing in both directions
+    const float squareSize = fmaxf(fmaxf(maxX - minX, maxY - minY), EPSILON);
+
+    tree->nodesCount = 0;
+    if (AddQuadtreeNodes(tree, 1) < 0 || !BuildQuadtreeNode(tree, boids, 0, 0, boidsCount, minX, minY, squareSize, 0)) {
+        return false;
+    }
+
+    for (int slot = 0; slot < boidsCount; slot++) {
+        const int i = tree->sortedIndices[slot];
+        tree->sortedBoids.positionsX[slot] = boids->positionsX[i];
+        tree->sortedBoids.positionsY[slot] = boids->positionsY[i];
+        tree->sortedBoids.velocitiesX[slot] = boids->velocitiesX[i];
+        tree->sortedBoids.velocitiesY[slot] = boids->velocitiesY[i];
+        tree->boidSlots[i] = slot;
+    }
+    tree->boidsCount = boidsCount;
+
+    return true;
+}
+
+// Internal function that adds a whole node to the sums of the given forces, leaving out the boid at boidSlot if the
+// node contains it
+static void AddQuadtreeNodeSums(const struct FlockQuadtree *tree, const struct QuadtreeNode *node,
+                                const unsigned int forces, const int boidSlot, struct SteeringSums *sums) {
+    const bool containsBoid = boidSlot >= node->start && boidSlot < node->end;
+    const int count = (node->end - node->start) - (containsBoid ? 1 : 0);
+
+    if ((forces & QUADTREE_ALIGNMENT) != 0) {
+        sums->velocityX += node->velocityX;
+        sums->velocityY += node->velocityY;
+        if (containsBoid) {
+            sums->velocityX -= tree->sortedBoids.velocitiesX[boidSlot];
+            sums->velocityY -= tree->sortedBoids.velocitiesY[boidSlot];
+        }
+        sums->alignmentCount += count;
+    }
+    if ((forces & QUADTREE_COHESION) != 0) {
+        sums->positionX += node->positionX;
+        sums->positionY += node->positionY;
+        if (containsBoid) {
+            sums->positionX -= tree->sortedBoids.positionsX[boidSlot];
+            sums->positionY -= tree->sortedBoids.positionsY[boidSlot];
+        }
+        sums->cohesionCount += count;
+    }
+}
+
+void AccumulateQuadtreeSteering(const struct FlockQuadtree *tree, const struct SteeringQuery *query,
+                                const int boidSlot, const float openingAngle, SteeringKernel kernel,
+                                struct SteeringSums *sums) {
+    if (tree->nodesCount == 0) {
+        return;
+    }
+
+    const float rangesSquared[2] = {query->alignmentRangeSquared, query->cohesionRangeSquared};
+    const unsigned int forceBits[2] = {QUADTREE_ALIGNMENT, QUADTREE_COHESION};
+    const float openingAngleSquared = openingAngle * openingAngle;
+
+    struct {
+        int node;
+        unsigned int forces;
+    } stack[QUADTREE_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize].node = 0;
+    stack[stackSize].forces = (rangesSquared[0] > 0.F ? QUADTREE_ALIGNMENT : 0U) |
+                              (rangesSquared[1] > 0.F ? QUADTREE_COHESION : 0U);
+    stackSize++;
+
+    while (stackSize > 0) {
+        stackSize--;
+        const struct QuadtreeNode *node = &tree->nodes[stack[stackSize].node];
+        const unsigned int forces = stack[stackSize].forces;
+        const bool containsBoid = boidSlot >= node->start && boidSlot < node->end;
+
+        // Nearest and furthest distances from the position to the node's bounds
+        const float nearX = fmaxf(fmaxf(node->minX - query->positionX, query->positionX - node->maxX), 0.F);
+        const float nearY = fmaxf(fmaxf(node->minY - query->positionY, query->positionY - node->maxY), 0.F);
+        const float farX = fmaxf(query->positionX - node->minX, node->maxX - query->positionX);
+        const float farY = fmaxf(query->positionY - node->minY, node->maxY - query->positionY);
+        const float nearSquared = (nearX * nearX) + (nearY * nearY);
+        const float farSquared = (farX * farX) + (farY * farY);
+
+        unsigned int addedForces = 0U;
+        unsigned int edgeForces = 0U;
+        for (int force = 0; force < 2; force++) {
+            if ((forces & forceBits[force]) == 0 || nearSquared >= rangesSquared[force]) {
+                continue;
+            }
+            if (farSquared < rangesSquared[force]) {
+                addedForces |= forceBits[force];
+            } else {
+                edgeForces |= forceBits[force];
+            }
+        }
+
+        // Nodes on the edge of a range are counted as a whole if they are small enough compared to the distance to
+        // their centre of mass. The node containing the boid is never approximated, its centre of mass would include
+        // the boid itself.
+        unsigned int openForces = edgeForces;
+        if (edgeForces != 0U && !containsBoid) {
+            const float count = (float)(node->end - node->start);
+            const float offsetX = node->positionX - (query->positionX * count);
+            const float offsetY = node->positionY - (query->positionY * count);
+            // Squared distance to the centre of mass scaled by count^2, to avoid dividing
+            const float centerDistanceSquared = (offsetX * offsetX) + (offsetY * offsetY);
+            const float size = fmaxf(node->maxX - node->minX, node->maxY - node->minY) * count;
+            if (size * size < openingAngleSquared * centerDistanceSquared) {
+                openForces = 0U;
+                for (int force = 0; force < 2; force++) {
+                    if ((edgeForces & forceBits[force]) != 0 &&
+                        centerDistanceSquared < rangesSquared[force] * count * count) {
+                        addedForces |= forceBits[force];
+                    }
+                }
+            }
+        }
+
+        if (addedForces != 0U) {
+            AddQuadtreeNodeSums(tree, node, addedForces, boidSlot, sums);
+        }
+        if (openForces == 0U) {
+            continue;
+        }
+
+        if (node->childrenCount > 0) {
+            for (int child = 0; child < node->childrenCount; child++) {
+                stack[stackSize].node = node->firstChild + child;
+                stack[stackSize].forces = openForces;
+                stackSize++;
+            }
+            continue;
+        }
+
+        // Leaves on the edge of the range are summed boid by boid, skipping the boid itself
+        const float alignmentRangeSquared = (openForces & QUADTREE_ALIGNMENT) != 0 ? rangesSquared[0] : 0.F;
+        const float cohesionRangeSquared = (openForces & QUADTREE_COHESION) != 0 ? rangesSquared[1] : 0.F;
+        const struct SteeringQuery leafQuery = {
+            .positionX = query->positionX,
+            .positionY = query->positionY,
+            .alignmentRangeSquared = alignmentRangeSquared,
+            .cohesionRangeSquared = cohesionRangeSquared,
+            .interactionRangeSquared = fmaxf(alignmentRangeSquared, cohesionRangeSquared),
+        };
+        if (containsBoid) {
+            kernel(&leafQuery, &tree->sortedBoids, node->start, boidSlot, sums);
+            kernel(&leafQuery, &tree->sortedBoids, boidSlot + 1, node->end, sums);
+        } else {
+            kernel(&leafQuery, &tree->sortedBoids, node->start, node->end, sums);
+        }
+    }
+}
+
+void DestroyFlockQuadtree(struct FlockQuadtree *tree) {
+    if (tree == NULL) {
+        FlockLog(LOG_ERROR, "DestroyFlockQuadtree: Recieved NULL pointer to tree.");
+        return;
+    }
+
+    if (tree->boidsCapacity > 0) {
+        FreeBoidArrays(&tree->sortedBoids);
+    }
+    free(tree->sortedIndices);
+    free(tree->boidSlots);
+    free(tree->nodes);
+
+    *tree = (struct FlockQuadtree){0};
+}
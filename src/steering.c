@@ -0,0 +1,185 @@
+#include "steering.h"
+
+#include "boid.h"
+#include "flock_log.h"
+
+#include <math.h>
+#include <raylib.h>
+#include <raymath.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(BOIDS_X86_KERNELS) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif /* if defined(BOIDS_X86_KERNELS) && defined(_MSC_VER) */
+
+// Internal function that adds the contribution of a neighbour at the given position to the sums, except for its
+// velocity. Returns true if the neighbour is in alignment range, the caller then adds its velocity so that it is only
+// loaded when it is needed.
+static inline bool AccumulateSteeringPosition(const struct SteeringQuery *query, const float otherPositionX,
+                                              const float otherPositionY, struct SteeringSums *sums) {
+    const float offsetX = query->positionX - otherPositionX;
+    const float offsetY = query->positionY - otherPositionY;
+    const float distanceSquared = (offsetX * offsetX) + (offsetY * offsetY);
+
+    // Compare squared distances so that boids out of range don't need a square root
+    if (distanceSquared >= query->interactionRangeSquared) {
+        return false;
+    }
+
+    // Separation
+    if (distanceSquared < query->separationRangeSquared && distanceSquared > EPSILON * EPSILON) {
+        const float distance = sqrtf(distanceSquared);
+        // Normalise the offset and scale it from 0 at the edge of the range towards infinity as the distance closes
+        const float scale = ((query->separationRange / distance) - 1.F) / distance;
+        sums->separationX += offsetX * scale;
+        sums->separationY += offsetY * scale;
+        sums->separationCount++;
+    }
+
+    // Cohesion
+    if (distanceSquared < query->cohesionRangeSquared) {
+        sums->positionX += otherPositionX;
+        sums->positionY += otherPositionY;
+        sums->cohesionCount++;
+    }
+
+#ifdef DEBUG
+    if (distanceSquared < query->collisionDistanceSquared) {
+        sums->collisionCount++;
+    }
+#endif /* ifdef DEBUG */
+
+    // Alignment
+    return distanceSquared < query->alignmentRangeSquared;
+}
+
+// Internal function that adds the contribution of the boid at index i of the arrays to the sums
+static inline void AccumulateSteeringNeighbour(const struct SteeringQuery *query, const struct BoidArrays *boids,
+                                               const int i, struct SteeringSums *sums) {
+    if (AccumulateSteeringPosition(query, boids->positionsX[i], boids->positionsY[i], sums)) {
+        sums->velocityX += boids->velocitiesX[i];
+        sums->velocityY += boids->velocitiesY[i];
+        sums->alignmentCount++;
+    }
+}
+
+void AccumulateSteeringScalar(const struct SteeringQuery *query, const struct BoidArrays *boids, const int start,
+                              const int end, struct SteeringSums *sums) {
+    for (int i = start; i < end; i++) {
+        AccumulateSteeringNeighbour(query, boids, i, sums);
+    }
+}
+
+void AccumulateSteeringIndexedScalar(const struct SteeringQuery *query, const struct BoidArrays *boids,
+                                     const int *indices, const int count, struct SteeringSums *sums) {
+    for (int n = 0; n < count; n++) {
+        AccumulateSteeringNeighbour(query, boids, indices[n], sums);
+    }
+}
+
+void AccumulateCompactSteeringScalar(const struct SteeringQuery *query, const struct CompactBoidArrays *boids,
+                                     const int start, const int end, struct SteeringSums *sums) {
+    const Vector2 origin = boids->positionOrigin;
+    const Vector2 scale = boids->positionScale;
+    for (int i = start; i < end; i++) {
+        const float otherPositionX = UnpackBoidPosition(boids->positionsX[i], origin.x, scale.x);
+        const float otherPositionY = UnpackBoidPosition(boids->positionsY[i], origin.y, scale.y);
+        if (AccumulateSteeringPosition(query, otherPositionX, otherPositionY, sums)) {
+            sums->velocityX += UnpackBoidVelocity(boids->velocitiesX[i]);
+            sums->velocityY += UnpackBoidVelocity(boids->velocitiesY[i]);
+            sums->alignmentCount++;
+        }
+    }
+}
+
+#ifdef BOIDS_X86_KERNELS
+// Internal function that checks if the CPU (and OS) supports AVX2
+static bool CpuSupportsAvx2(void) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    // The OS must save the AVX registers (OSXSAVE and the XMM/YMM state bits of XCR0)
+    __cpuid(info, 1);
+    const bool hasOsxsave = (info[2] & (1 << 27)) != 0;
+    const bool hasAvx = (info[2] & (1 << 28)) != 0;
+    if (!hasOsxsave || !hasAvx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif /* ifdef _MSC_VER */
+}
+#endif /* ifdef BOIDS_X86_KERNELS */
+
+SteeringKernel GetSteeringKernel(void) {
+    SteeringKernel kernel = AccumulateSteeringScalar;
+#ifdef BOIDS_X86_KERNELS
+    // SSE2 is part of the x86-64 baseline
+    kernel = AccumulateSteeringSse2;
+    if (CpuSupportsAvx2()) {
+        kernel = AccumulateSteeringAvx2;
+    }
+#endif /* ifdef BOIDS_X86_KERNELS */
+
+    const char *override = getenv("BOIDS_STEERING_KERNEL");
+    if (override != NULL) {
+        if (strcmp(override, "scalar") == 0) {
+            kernel = AccumulateSteeringScalar;
+#ifdef BOIDS_X86_KERNELS
+        } else if (strcmp(override, "sse2") == 0) {
+            kernel = AccumulateSteeringSse2;
+        } else if (strcmp(override, "avx2") == 0 && CpuSupportsAvx2()) {
+            kernel = AccumulateSteeringAvx2;
+#endif /* ifdef BOIDS_X86_KERNELS */
+        } else {
+            FlockLog(LOG_WARNING, "GetSteeringKernel: Steering kernel \"%s\" is not available, using %s.", override,
+                     GetSteeringKernelName(kernel));
+        }
+    }
+
+    return kernel;
+}
+
+const char *GetSteeringKernelName(SteeringKernel kernel) {
+    if (kernel == AccumulateSteeringScalar) {
+        return "scalar";
+    }
+#ifdef BOIDS_X86_KERNELS
+    if (kernel == AccumulateSteeringSse2) {
+        return "sse2";
+    }
+    if (kernel == AccumulateSteeringAvx2) {
+        return "avx2";
+    }
+#endif /* ifdef BOIDS_X86_KERNELS */
+    return "unknown";
+}
+
+SteeringIndexedKernel GetSteeringIndexedKernel(SteeringKernel kernel) {
+#ifdef BOIDS_X86_KERNELS
+    // Gathers need AVX2, SSE2 has to load each lane separately so it is no faster than the scalar kernel
+    if (kernel == AccumulateSteeringAvx2) {
+        return AccumulateSteeringIndexedAvx2;
+    }
+#endif /* ifdef BOIDS_X86_KERNELS */
+    return AccumulateSteeringIndexedScalar;
+}
+
+CompactSteeringKernel GetCompactSteeringKernel(SteeringKernel kernel) {
+#ifdef BOIDS_X86_KERNELS
+    // Only AVX2 has a compact vector kernel, the others fall back to unpacking one boid at a time
+    if (kernel == AccumulateSteeringAvx2) {
+        return AccumulateCompactSteeringAvx2;
+    }
+#endif /* ifdef BOIDS_X86_KERNELS */
+    return AccumulateCompactSteeringScalar;
+}
@@ -0,0 +1,243 @@
+#include "steering.h"
+
+#ifdef BOIDS_X86_KERNELS
+
+#include "boid.h"
+
+#include <immintrin.h>
+#include <stdint.h>
+#include <raylib.h>
+#include <raymath.h>
+
+// NOTE: This file is compiled with AVX2 enabled, nothing in it may run before the CPU has been checked for support.
+
+// Internal function that adds the eight lanes of a vector together
+static float SumLanes(const __m256 vector) {
+    const __m128 halves = _mm_add_ps(_mm256_castps256_ps128(vector), _mm256_extractf128_ps(vector, 1));
+    float lanes[4];
+    _mm_storeu_ps(lanes, halves);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+// Internal function that adds the eight lanes of an integer vector together
+static int SumIntegerLanes(const __m256i vector) {
+    const __m128i halves = _mm_add_epi32(_mm256_castsi256_si128(vector), _mm256_extracti128_si256(vector, 1));
+    int lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, halves);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+// Kernel constants and running totals, kept in vectors until the kernel finishes
+struct Avx2SteeringState {
+    __m256 positionX;
+    __m256 positionY;
+    __m256 separationRange;
+    __m256 separationRangeSquared;
+    __m256 alignmentRangeSquared;
+    __m256 cohesionRangeSquared;
+    __m256 interactionRangeSquared;
+    __m256 minimumDistanceSquared;
+    __m256 one;
+#ifdef DEBUG
+    __m256 collisionDistanceSquared;
+    __m256i collisionCount;
+#endif /* ifdef DEBUG */
+
+    __m256 separationX;
+    __m256 separationY;
+    __m256i separationCount;
+    __m256 velocityX;
+    __m256 velocityY;
+    __m256i alignmentCount;
+    __m256 cohesionX;
+    __m256 cohesionY;
+    __m256i cohesionCount;
+};
+
+// Internal function that sets up the constants for the query and clears the totals
+static inline void StartAvx2Steering(struct Avx2SteeringState *state, const struct SteeringQuery *query) {
+    state->positionX = _mm256_set1_ps(query->positionX);
+    state->positionY = _mm256_set1_ps(query->positionY);
+    state->separationRange = _mm256_set1_ps(query->separationRange);
+    state->separationRangeSquared = _mm256_set1_ps(query->separationRangeSquared);
+    state->alignmentRangeSquared = _mm256_set1_ps(query->alignmentRangeSquared);
+    state->cohesionRangeSquared = _mm256_set1_ps(query->cohesionRangeSquared);
+    state->interactionRangeSquared = _mm256_set1_ps(query->interactionRangeSquared);
+    state->minimumDistanceSquared = _mm256_set1_ps(EPSILON * EPSILON);
+    state->one = _mm256_set1_ps(1.F);
+#ifdef DEBUG
+    state->collisionDistanceSquared = _mm256_set1_ps(query->collisionDistanceSquared);
+    state->collisionCount = _mm256_setzero_si256();
+#endif /* ifdef DEBUG */
+
+    state->separationX = _mm256_setzero_ps();
+    state->separationY = _mm256_setzero_ps();
+    state->separationCount = _mm256_setzero_si256();
+    state->velocityX = _mm256_setzero_ps();
+    state->velocityY = _mm256_setzero_ps();
+    state->alignmentCount = _mm256_setzero_si256();
+    state->cohesionX = _mm256_setzero_ps();
+    state->cohesionY = _mm256_setzero_ps();
+    state->cohesionCount = _mm256_setzero_si256();
+}
+
+// Internal function that loads the eight values at [i, i + 8) of the array, or at the indices at [i, i + 8) of the
+// indices if there are any
+static inline __m256 LoadLanes(const float *values, const int *indices, const int i) {
+    if (indices == NULL) {
+        // Spans start at any boid so the loads can't assume alignment
+        return _mm256_loadu_ps(&values[i]);
+    }
+    return _mm256_i32gather_ps(values, _mm256_loadu_si256((const __m256i *)&indices[i]), sizeof(float));
+}
+
+// Internal function that adds the contributions of eight boids at the given positions, except for their velocities.
+// Returns the mask of the lanes in alignment range, the caller then adds their velocities so that they are only loaded
+// when they are needed.
+static inline __m256 AccumulatePositionsAvx2(struct Avx2SteeringState *state, const __m256 otherPositionX,
+                                             const __m256 otherPositionY) {
+    const __m256 offsetX = _mm256_sub_ps(state->positionX, otherPositionX);
+    const __m256 offsetY = _mm256_sub_ps(state->positionY, otherPositionY);
+    const __m256 distanceSquared = _mm256_add_ps(_mm256_mul_ps(offsetX, offsetX), _mm256_mul_ps(offsetY, offsetY));
+
+    // Skip the whole batch if none of the boids are in range
+    if (_mm256_movemask_ps(_mm256_cmp_ps(distanceSquared, state->interactionRangeSquared, _CMP_LT_OQ)) == 0) {
+        return _mm256_setzero_ps();
+    }
+
+    // Separation
+    const __m256 inSeparationRange =
+        _mm256_and_ps(_mm256_cmp_ps(distanceSquared, state->separationRangeSquared, _CMP_LT_OQ),
+                      _mm256_cmp_ps(distanceSquared, state->minimumDistanceSquared, _CMP_GT_OQ));
+    if (_mm256_movemask_ps(inSeparationRange) != 0) {
+        // Lanes out of range may produce infinities here, the mask clears them
+        const __m256 distance = _mm256_sqrt_ps(distanceSquared);
+        const __m256 scale =
+            _mm256_div_ps(_mm256_sub_ps(_mm256_div_ps(state->separationRange, distance), state->one), distance);
+        state->separationX =
+            _mm256_add_ps(state->separationX, _mm256_and_ps(inSeparationRange, _mm256_mul_ps(offsetX, scale)));
+        state->separationY =
+            _mm256_add_ps(state->separationY, _mm256_and_ps(inSeparationRange, _mm256_mul_ps(offsetY, scale)));
+        // Masks are all ones (-1) in the selected lanes
+        state->separationCount = _mm256_sub_epi32(state->separationCount, _mm256_castps_si256(inSeparationRange));
+    }
+
+    // Cohesion
+    const __m256 inCohesionRange = _mm256_cmp_ps(distanceSquared, state->cohesionRangeSquared, _CMP_LT_OQ);
+    state->cohesionX = _mm256_add_ps(state->cohesionX, _mm256_and_ps(inCohesionRange, otherPositionX));
+    state->cohesionY = _mm256_add_ps(state->cohesionY, _mm256_and_ps(inCohesionRange, otherPositionY));
+    state->cohesionCount = _mm256_sub_epi32(state->cohesionCount, _mm256_castps_si256(inCohesionRange));
+
+#ifdef DEBUG
+    state->collisionCount = _mm256_sub_epi32(
+        state->collisionCount,
+        _mm256_castps_si256(_mm256_cmp_ps(distanceSquared, state->collisionDistanceSquared, _CMP_LT_OQ)));
+#endif /* ifdef DEBUG */
+
+    // Alignment
+    return _mm256_cmp_ps(distanceSquared, state->alignmentRangeSquared, _CMP_LT_OQ);
+}
+
+// Internal function that adds the velocities of the lanes in alignment range
+static inline void AccumulateVelocitiesAvx2(struct Avx2SteeringState *state, const __m256 inAlignmentRange,
+                                            const __m256 otherVelocityX, const __m256 otherVelocityY) {
+    state->velocityX = _mm256_add_ps(state->velocityX, _mm256_and_ps(inAlignmentRange, otherVelocityX));
+    state->velocityY = _mm256_add_ps(state->velocityY, _mm256_and_ps(inAlignmentRange, otherVelocityY));
+    state->alignmentCount = _mm256_sub_epi32(state->alignmentCount, _mm256_castps_si256(inAlignmentRange));
+}
+
+// Internal function that adds the contributions of eight boids, see LoadLanes for which boids
+static inline void AccumulateBatchAvx2(struct Avx2SteeringState *state, const struct BoidArrays *boids,
+                                       const int *indices, const int i) {
+    const __m256 inAlignmentRange = AccumulatePositionsAvx2(state, LoadLanes(boids->positionsX, indices, i),
+                                                            LoadLanes(boids->positionsY, indices, i));
+    if (_mm256_movemask_ps(inAlignmentRange) != 0) {
+        AccumulateVelocitiesAvx2(state, inAlignmentRange, LoadLanes(boids->velocitiesX, indices, i),
+                                 LoadLanes(boids->velocitiesY, indices, i));
+    }
+}
+
+// Internal function that loads and unpacks the eight compact positions at [i, i + 8) of the array
+static inline __m256 LoadCompactPositionLanes(const uint16_t *steps, const int i, const __m256 origin,
+                                              const __m256 scale) {
+    const __m256i lanes = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&steps[i]));
+    return _mm256_add_ps(origin, _mm256_mul_ps(_mm256_cvtepi32_ps(lanes), scale));
+}
+
+// Internal function that loads and unpacks the eight half-precision velocities at [i, i + 8) of the array, the same
+// way as UnpackBoidVelocity
+static inline __m256 LoadCompactVelocityLanes(const uint16_t *halves, const int i) {
+    const __m256i lanes = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&halves[i]));
+    const __m256i magnitude = _mm256_slli_epi32(_mm256_and_si256(lanes, _mm256_set1_epi32(0x7FFF)), 13);
+    const __m256i sign = _mm256_slli_epi32(_mm256_and_si256(lanes, _mm256_set1_epi32(0x8000)), 16);
+    const __m256 value = _mm256_mul_ps(_mm256_castsi256_ps(magnitude), _mm256_set1_ps(0x1p112F));
+    return _mm256_or_ps(value, _mm256_castsi256_ps(sign));
+}
+
+// Internal function that adds the totals to the sums
+static inline void FinishAvx2Steering(const struct Avx2SteeringState *state, struct SteeringSums *sums) {
+    sums->separationX += SumLanes(state->separationX);
+    sums->separationY += SumLanes(state->separationY);
+    sums->separationCount += SumIntegerLanes(state->separationCount);
+    sums->velocityX += SumLanes(state->velocityX);
+    sums->velocityY += SumLanes(state->velocityY);
+    sums->alignmentCount += SumIntegerLanes(state->alignmentCount);
+    sums->positionX += SumLanes(state->cohesionX);
+    sums->positionY += SumLanes(state->cohesionY);
+    sums->cohesionCount += SumIntegerLanes(state->cohesionCount);
+#ifdef DEBUG
+    sums->collisionCount += SumIntegerLanes(state->collisionCount);
+#endif /* ifdef DEBUG */
+}
+
+void AccumulateSteeringAvx2(const struct SteeringQuery *query, const struct BoidArrays *boids, const int start,
+                            const int end, struct SteeringSums *sums) {
+    struct Avx2SteeringState state;
+    StartAvx2Steering(&state, query);
+    int i = start;
+    for (; i + 8 <= end; i += 8) {
+        AccumulateBatchAvx2(&state, boids, NULL, i);
+    }
+    FinishAvx2Steering(&state, sums);
+
+    // Remaining boids that don't fill a vector
+    AccumulateSteeringScalar(query, boids, i, end, sums);
+}
+
+void AccumulateCompactSteeringAvx2(const struct SteeringQuery *query, const struct CompactBoidArrays *boids,
+                                   const int start, const int end, struct SteeringSums *sums) {
+    struct Avx2SteeringState state;
+    StartAvx2Steering(&state, query);
+    const __m256 originX = _mm256_set1_ps(boids->positionOrigin.x);
+    const __m256 originY = _mm256_set1_ps(boids->positionOrigin.y);
+    const __m256 scaleX = _mm256_set1_ps(boids->positionScale.x);
+    const __m256 scaleY = _mm256_set1_ps(boids->positionScale.y);
+    int i = start;
+    for (; i + 8 <= end; i += 8) {
+        const __m256 inAlignmentRange =
+            AccumulatePositionsAvx2(&state, LoadCompactPositionLanes(boids->positionsX, i, originX, scaleX),
+                                    LoadCompactPositionLanes(boids->positionsY, i, originY, scaleY));
+        if (_mm256_movemask_ps(inAlignmentRange) != 0) {
+            AccumulateVelocitiesAvx2(&state, inAlignmentRange, LoadCompactVelocityLanes(boids->velocitiesX, i),
+                                     LoadCompactVelocityLanes(boids->velocitiesY, i));
+        }
+    }
+    FinishAvx2Steering(&state, sums);
+
+    AccumulateCompactSteeringScalar(query, boids, i, end, sums);
+}
+
+void AccumulateSteeringIndexedAvx2(const struct SteeringQuery *query, const struct BoidArrays *boids,
+                                   const int *indices, const int count, struct SteeringSums *sums) {
+    struct Avx2SteeringState state;
+    StartAvx2Steering(&state, query);
+    int n = 0;
+    for (; n + 8 <= count; n += 8) {
+        AccumulateBatchAvx2(&state, boids, indices, n);
+    }
+    FinishAvx2Steering(&state, sums);
+
+    AccumulateSteeringIndexedScalar(query, boids, &indices[n], count - n, sums);
+}
+
+#endif /* ifdef BOIDS_X86_KERNELS */
@@ -0,0 +1,115 @@
+#include "steering.h"
+
+#ifdef BOIDS_X86_KERNELS
+
+#include "boid.h"
+
+#include <emmintrin.h>
+#include <raylib.h>
+#include <raymath.h>
+
+// Internal function that adds the four lanes of a vector together
+static float SumLanes(const __m128 vector) {
+    float lanes[4];
+    _mm_storeu_ps(lanes, vector);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+// Internal function that adds the four lanes of an integer vector together
+static int SumIntegerLanes(const __m128i vector) {
+    int lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, vector);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+void AccumulateSteeringSse2(const struct SteeringQuery *query, const struct BoidArrays *boids, const int start,
+                            const int end, struct SteeringSums *sums) {
+    const __m128 positionX = _mm_set1_ps(query->positionX);
+    const __m128 positionY = _mm_set1_ps(query->positionY);
+    const __m128 separationRange = _mm_set1_ps(query->separationRange);
+    const __m128 separationRangeSquared = _mm_set1_ps(query->separationRangeSquared);
+    const __m128 alignmentRangeSquared = _mm_set1_ps(query->alignmentRangeSquared);
+    const __m128 cohesionRangeSquared = _mm_set1_ps(query->cohesionRangeSquared);
+    const __m128 interactionRangeSquared = _mm_set1_ps(query->interactionRangeSquared);
+    const __m128 minimumDistanceSquared = _mm_set1_ps(EPSILON * EPSILON);
+    const __m128 one = _mm_set1_ps(1.F);
+#ifdef DEBUG
+    const __m128 collisionDistanceSquared = _mm_set1_ps(query->collisionDistanceSquared);
+    __m128i collisionCount = _mm_setzero_si128();
+#endif /* ifdef DEBUG */
+
+    __m128 separationX = _mm_setzero_ps();
+    __m128 separationY = _mm_setzero_ps();
+    __m128i separationCount = _mm_setzero_si128();
+    __m128 velocityX = _mm_setzero_ps();
+    __m128 velocityY = _mm_setzero_ps();
+    __m128i alignmentCount = _mm_setzero_si128();
+    __m128 cohesionX = _mm_setzero_ps();
+    __m128 cohesionY = _mm_setzero_ps();
+    __m128i cohesionCount = _mm_setzero_si128();
+
+    int i = start;
+    for (; i + 4 <= end; i += 4) {
+        // Spans start at any boid so the loads can't assume alignment
+        const __m128 otherPositionX = _mm_loadu_ps(&boids->positionsX[i]);
+        const __m128 otherPositionY = _mm_loadu_ps(&boids->positionsY[i]);
+        const __m128 offsetX = _mm_sub_ps(positionX, otherPositionX);
+        const __m128 offsetY = _mm_sub_ps(positionY, otherPositionY);
+        const __m128 distanceSquared = _mm_add_ps(_mm_mul_ps(offsetX, offsetX), _mm_mul_ps(offsetY, offsetY));
+
+        // Skip the whole batch if none of the boids are in range
+        if (_mm_movemask_ps(_mm_cmplt_ps(distanceSquared, interactionRangeSquared)) == 0) {
+            continue;
+        }
+
+        // Separation
+        const __m128 inSeparationRange = _mm_and_ps(_mm_cmplt_ps(distanceSquared, separationRangeSquared),
+                                                    _mm_cmpgt_ps(distanceSquared, minimumDistanceSquared));
+        if (_mm_movemask_ps(inSeparationRange) != 0) {
+            // Lanes out of range may produce infinities here, the mask clears them
+            const __m128 distance = _mm_sqrt_ps(distanceSquared);
+            const __m128 scale = _mm_div_ps(_mm_sub_ps(_mm_div_ps(separationRange, distance), one), distance);
+            separationX = _mm_add_ps(separationX, _mm_and_ps(inSeparationRange, _mm_mul_ps(offsetX, scale)));
+            separationY = _mm_add_ps(separationY, _mm_and_ps(inSeparationRange, _mm_mul_ps(offsetY, scale)));
+            // Masks are all ones (-1) in the selected lanes
+            separationCount = _mm_sub_epi32(separationCount, _mm_castps_si128(inSeparationRange));
+        }
+
+        // Alignment
+        const __m128 inAlignmentRange = _mm_cmplt_ps(distanceSquared, alignmentRangeSquared);
+        if (_mm_movemask_ps(inAlignmentRange) != 0) {
+            velocityX = _mm_add_ps(velocityX, _mm_and_ps(inAlignmentRange, _mm_loadu_ps(&boids->velocitiesX[i])));
+            velocityY = _mm_add_ps(velocityY, _mm_and_ps(inAlignmentRange, _mm_loadu_ps(&boids->velocitiesY[i])));
+            alignmentCount = _mm_sub_epi32(alignmentCount, _mm_castps_si128(inAlignmentRange));
+        }
+
+        // Cohesion
+        const __m128 inCohesionRange = _mm_cmplt_ps(distanceSquared, cohesionRangeSquared);
+        cohesionX = _mm_add_ps(cohesionX, _mm_and_ps(inCohesionRange, otherPositionX));
+        cohesionY = _mm_add_ps(cohesionY, _mm_and_ps(inCohesionRange, otherPositionY));
+        cohesionCount = _mm_sub_epi32(cohesionCount, _mm_castps_si128(inCohesionRange));
+
+#ifdef DEBUG
+        collisionCount = _mm_sub_epi32(
+            collisionCount, _mm_castps_si128(_mm_cmplt_ps(distanceSquared, collisionDistanceSquared)));
+#endif /* ifdef DEBUG */
+    }
+
+    sums->separationX += SumLanes(separationX);
+    sums->separationY += SumLanes(separationY);
+    sums->separationCount += SumIntegerLanes(separationCount);
+    sums->velocityX += SumLanes(velocityX);
+    sums->velocityY += SumLanes(velocityY);
+    sums->alignmentCount += SumIntegerLanes(alignmentCount);
+    sums->positionX += SumLanes(cohesionX);
+    sums->positionY += SumLanes(cohesionY);
+    sums->cohesionCount += SumIntegerLanes(cohesionCount);
+#ifdef DEBUG
+    sums->collisionCount += SumIntegerLanes(collisionCount);
+#endif /* ifdef DEBUG */
+
+    // Remaining boids that don't fill a vector
+    AccumulateSteeringScalar(query, boids, i, end, sums);
+}
+
+#endif /* ifdef BOIDS_X86_KERNELS */
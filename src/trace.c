@@ -0,0 +1,205 @@
+#include "trace.h"
+
+#include "flock_log.h"
+#include "timer.h"
+
+#include <pthread.h>
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct TraceEvent {
+    const char *name;
+    double startTime;
+    double endTime;
+};
+
+// Events recorded by one thread. The mutex is only ever contended while the trace is being written.
+struct TraceBuffer {
+    pthread_mutex_t mutex;
+    struct TraceEvent *events;
+    // Total number of events recorded, the newest is at (eventsCount - 1) % TRACE_EVENTS_PER_THREAD
+    uint64_t eventsCount;
+    char threadName[TRACE_THREAD_NAME_SIZE];
+    // Set when the thread exits, its events are kept until another thread takes over the buffer
+    bool isRetired;
+};
+
+static pthread_once_t traceOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t traceBufferKey;
+static double traceStartTime;
+
+// Guards the list of buffers
+static pthread_mutex_t traceMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct TraceBuffer traceBuffers[TRACE_MAX_THREADS];
+static int traceBuffersCount = 0;
+
+// Internal function called when a thread that recorded events exits
+static void RetireTraceBuffer(void *argument) {
+    struct TraceBuffer *buffer = argument;
+    pthread_mutex_lock(&buffer->mutex);
+    buffer->isRetired = true;
+    pthread_mutex_unlock(&buffer->mutex);
+}
+
+// Internal function that sets up the trace the first time any thread records
+static void InitializeTrace(void) {
+    traceStartTime = GetMonotonicTime();
+    if (pthread_key_create(&traceBufferKey, RetireTraceBuffer) != 0) {
+        FlockLog(LOG_ERROR, "InitializeTrace: Failed to create thread-local key, nothing will be traced.");
+    }
+}
+
+// Internal function that gets the calling thread's buffer, giving it one the first time. Returns NULL if there are
+// no buffers left.
+static struct TraceBuffer *GetTraceBuffer(void) {
+    pthread_once(&traceOnce, InitializeTrace);
+
+    struct TraceBuffer *buffer = pthread_getspecific(traceBufferKey);
+    if (buffer != NULL) {
+        return buffer;
+    }
+
+    pthread_mutex_lock(&traceMutex);
+    // Reuse the buffer of a thread that has exited before taking a new one, the worker pool's threads are replaced
+    // whenever the thread count changes
+    for (int i = 0; i < traceBuffersCount && buffer == NULL; i++) {
+        pthread_mutex_lock(&traceBuffers[i].mutex);
+        if (traceBuffers[i].isRetired) {
+            buffer = &traceBuffers[i];
+            buffer->eventsCount = 0;
+            buffer->isRetired = false;
+            snprintf(buffer->threadName, sizeof(buffer->threadName), "Thread");
+        }
+        pthread_mutex_unlock(&traceBuffers[i].mutex);
+    }
+    if (buffer == NULL && traceBuffersCount < TRACE_MAX_THREADS) {
+        struct TraceEvent *events = malloc(sizeof(struct TraceEvent) * TRACE_EVENTS_PER_THREAD);
+        if (events != NULL && pthread_mutex_init(&traceBuffers[traceBuffersCount].mutex, NULL) == 0) {
+            buffer = &traceBuffers[traceBuffersCount++];
+            buffer->events = events;
+            buffer->eventsCount = 0;
+            buffer->isRetired = false;
+            snprintf(buffer->threadName, sizeof(buffer->threadName), "Thread");
+        } else {
+            free(events);
+        }
+    }
+    pthread_mutex_unlock(&traceMutex);
+
+    if (buffer == NULL) {
+        FlockLog(LOG_WARNING, "GetTraceBuffer: Out of trace buffers, events from this thread will be dropped.");
+        return NULL;
+    }
+    pthread_setspecific(traceBufferKey, buffer);
+    return buffer;
+}
+
+void SetTraceThreadName(const char *name) {
+    if (name == NULL) {
+        FlockLog(LOG_ERROR, "SetTraceThreadName: Recieved NULL pointer to name.");
+        return;
+    }
+
+    struct TraceBuffer *buffer = GetTraceBuffer();
+    if (buffer == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&buffer->mutex);
+    snprintf(buffer->threadName, sizeof(buffer->threadName), "%s", name);
+    pthread_mutex_unlock(&buffer->mutex);
+}
+
+void AddTraceEvent(const char *name, const double startTime, const double endTime) {
+    struct TraceBuffer *buffer = GetTraceBuffer();
+    if (buffer == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&buffer->mutex);
+    buffer->events[buffer->eventsCount % TRACE_EVENTS_PER_THREAD] = (struct TraceEvent){
+        .name = name,
+        .startTime = startTime,
+        .endTime = endTime,
+    };
+    buffer->eventsCount++;
+    pthread_mutex_unlock(&buffer->mutex);
+}
+
+bool WriteTrace(const char *path) {
+    if (path == NULL) {
+        FlockLog(LOG_ERROR, "WriteTrace: Recieved NULL pointer to path.");
+        return false;
+    }
+    pthread_once(&traceOnce, InitializeTrace);
+
+    // Events are copied out of each buffer so its thread is only held up for the copy, not the write
+    struct TraceEvent *events = malloc(sizeof(struct TraceEvent) * TRACE_EVENTS_PER_THREAD);
+    if (events == NULL) {
+        FlockLog(LOG_ERROR, "WriteTrace: Failed to allocate memory to copy the events.");
+        return false;
+    }
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        FlockLog(LOG_ERROR, "WriteTrace: Failed to create %s.", path);
+        free(events);
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool isFirstEvent = true;
+
+    pthread_mutex_lock(&traceMutex);
+    for (int threadId = 0; threadId < traceBuffersCount; threadId++) {
+        struct TraceBuffer *buffer = &traceBuffers[threadId];
+
+        pthread_mutex_lock(&buffer->mutex);
+        const uint64_t eventsCount = buffer->eventsCount;
+        const int keptEventsCount =
+            eventsCount < TRACE_EVENTS_PER_THREAD ? (int)eventsCount : TRACE_EVENTS_PER_THREAD;
+        // Oldest first, so the events start after the newest one once the ring has wrapped around
+        const int firstEvent = eventsCount < TRACE_EVENTS_PER_THREAD ? 0 : (int)(eventsCount % TRACE_EVENTS_PER_THREAD);
+        memcpy(events, &buffer->events[firstEvent], sizeof(struct TraceEvent) * (size_t)(keptEventsCount - firstEvent));
+        memcpy(&events[keptEventsCount - firstEvent], buffer->events, sizeof(struct TraceEvent) * (size_t)firstEvent);
+        char threadName[TRACE_THREAD_NAME_SIZE];
+        memcpy(threadName, buffer->threadName, sizeof(threadName));
+        pthread_mutex_unlock(&buffer->mutex);
+
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                isFirstEvent ? "" : ",\n", threadId, threadName);
+        isFirstEvent = false;
+        for (int i = 0; i < keptEventsCount; i++) {
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    events[i].name, threadId, (events[i].startTime - traceStartTime) * 1e6,
+                    (events[i].endTime - events[i].startTime) * 1e6);
+        }
+    }
+    pthread_mutex_unlock(&traceMutex);
+
+    fprintf(file, "\n]}\n");
+    free(events);
+    if (fclose(file) != 0) {
+        FlockLog(LOG_ERROR, "WriteTrace: Failed to write %s.", path);
+        return false;
+    }
+
+    return true;
+}
+
+void ShutdownTrace(void) {
+    pthread_mutex_lock(&traceMutex);
+    for (int i = 0; i < traceBuffersCount; i++) {
+        free(traceBuffers[i].events);
+        pthread_mutex_destroy(&traceBuffers[i].mutex);
+        traceBuffers[i] = (struct TraceBuffer){0};
+    }
+    traceBuffersCount = 0;
+    pthread_mutex_unlock(&traceMutex);
+
+    // The calling thread would otherwise keep pointing at its freed buffer
+    pthread_once(&traceOnce, InitializeTrace);
+    pthread_setspecific(traceBufferKey, NULL);
+}
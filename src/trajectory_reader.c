@@ -0,0 +1,283 @@
+#include "trajectory.h"
+
+#include "checkpoint.h"
+#include "flock.h"
+#include "flock_log.h"
+#include "mapped_file.h"
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Internal function that checks the header, footer and index of the mapped file, and copies the index out of it
+static bool ReadTrajectoryIndex(struct TrajectoryReader *reader, const char *path) {
+    const unsigned char *data = reader->file.data;
+    const size_t fileSize = reader->file.size;
+    if (fileSize < sizeof(struct TrajectoryFileHeader) + sizeof(struct TrajectoryFileFooter)) {
+        FlockLog(LOG_ERROR, "OpenTrajectory: %s is not a trajectory.", path);
+        return false;
+    }
+
+    memcpy(&reader->header, data, sizeof(reader->header));
+    if (memcmp(reader->header.magic, TRAJECTORY_MAGIC, sizeof(reader->header.magic)) != 0) {
+        FlockLog(LOG_ERROR, "OpenTrajectory: %s is not a trajectory.", path);
+        return false;
+    }
+    if (reader->header.byteOrderMark != TRAJECTORY_BYTE_ORDER_MARK) {
+        FlockLog(LOG_ERROR, "OpenTrajectory: %s was written on a machine with a different byte order.", path);
+        return false;
+    }
+    if (reader->header.version != TRAJECTORY_VERSION) {
+        FlockLog(LOG_ERROR, "OpenTrajectory: %s is version %u, only version %d is supported.", path,
+                 reader->header.version, TRAJECTORY_VERSION);
+        return false;
+    }
+    if (!(reader->header.positionQuantum > 0.F) || !(reader->header.velocityQuantum > 0.F)) {
+        FlockLog(LOG_ERROR, "OpenTrajectory: %s is corrupt.", path);
+        return false;
+    }
+
+    // A recording that was never stopped has no footer, so it can't be played
+    struct TrajectoryFileFooter footer;
+    memcpy(&footer, data + fileSize - sizeof(footer), sizeof(footer));
+    const uint64_t indexEnd = (uint64_t)fileSize - sizeof(footer);
+    if (memcmp(footer.magic, TRAJECTORY_INDEX_MAGIC, sizeof(footer.magic)) != 0 || footer.framesCount == 0 ||
+        footer.indexOffset < sizeof(struct TrajectoryFileHeader) || footer.indexOffset > indexEnd ||
+        footer.framesCount > (indexEnd - footer.indexOffset) / sizeof(struct TrajectoryIndexEntry) ||
+        footer.indexOffset + (footer.framesCount * sizeof(struct TrajectoryIndexEntry)) != indexEnd) {
+        FlockLog(LOG_ERROR, "OpenTrajectory: %s is truncated or wasn't finished.", path);
+        return false;
+    }
+
+    reader->index = malloc(sizeof(struct TrajectoryIndexEntry) * footer.framesCount);
+    if (reader->index == NULL) {
+        FlockLog(LOG_ERROR, "OpenTrajectory: Failed to allocate memory for the index of %s.", path);
+        return false;
+    }
+    memcpy(reader->index, data + footer.indexOffset, sizeof(struct TrajectoryIndexEntry) * footer.framesCount);
+    reader->framesCount = footer.framesCount;
+    reader->indexOffset = footer.indexOffset;
+
+    // Seeking relies on the first frame being a keyframe and the chunks being in order, the chunks themselves are
+    // checked as they are decoded
+    if ((reader->index[0].flags & TRAJECTORY_CHUNK_KEYFRAME) == 0) {
+        FlockLog(LOG_ERROR, "OpenTrajectory: %s is corrupt.", path);
+        return false;
+    }
+    for (uint64_t i = 0; i < reader->framesCount; i++) {
+        const struct TrajectoryIndexEntry *entry = &reader->index[i];
+        if (entry->offset < sizeof(struct TrajectoryFileHeader) || entry->offset >= reader->indexOffset ||
+            entry->boidsCount > INT32_MAX / 4 ||
+            (i > 0 && (entry->offset <= reader->index[i - 1].offset || entry->time < reader->index[i - 1].time))) {
+            FlockLog(LOG_ERROR, "OpenTrajectory: %s is corrupt.", path);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool OpenTrajectory(struct TrajectoryReader *reader, const char *path) {
+    if (reader == NULL || path == NULL) {
+        FlockLog(LOG_ERROR, "OpenTrajectory: Recieved NULL pointer.");
+        return false;
+    }
+
+    *reader = (struct TrajectoryReader){
+        .decodedFrame = -1,
+    };
+    if (!OpenMappedFile(&reader->file, path)) {
+        FlockLog(LOG_ERROR, "OpenTrajectory: Failed to open %s.", path);
+        return false;
+    }
+    if (!ReadTrajectoryIndex(reader, path)) {
+        CloseTrajectory(reader);
+        return false;
+    }
+    reader->config = ReadFlockCheckpointConfig(&reader->header.config);
+    // The species of each boid is found from the count, so it has to be usable even though the config isn't validated
+    if (reader->config.speciesCount < 1 || reader->config.speciesCount > FLOCK_MAX_SPECIES) {
+        FlockLog(LOG_ERROR, "OpenTrajectory: %s has an invalid number of species, %d.", path,
+                 reader->config.speciesCount);
+        CloseTrajectory(reader);
+        return false;
+    }
+
+    return true;
+}
+
+uint64_t FindTrajectoryFrame(const struct TrajectoryReader *reader, const double time) {
+    if (reader == NULL || reader->framesCount == 0) {
+        FlockLog(LOG_ERROR, "FindTrajectoryFrame: Recieved NULL pointer or empty trajectory.");
+        return 0;
+    }
+
+    // Binary search for the first frame after time
+    uint64_t low = 0;
+    uint64_t high = reader->framesCount;
+    while (low < high) {
+        const uint64_t middle = low + ((high - low) / 2);
+        if (reader->index[middle].time <= time) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low > 0 ? low - 1 : 0;
+}
+
+// Internal function that decodes a chunk onto the values of the frame before it, or from scratch for a keyframe
+static bool DecodeTrajectoryChunk(struct TrajectoryReader *reader, const uint64_t frameIndex) {
+    const struct TrajectoryIndexEntry *entry = &reader->index[frameIndex];
+    const unsigned char *data = reader->file.data;
+
+    struct TrajectoryChunkHeader chunkHeader;
+    if (reader->indexOffset - entry->offset < sizeof(chunkHeader)) {
+        return false;
+    }
+    memcpy(&chunkHeader, data + entry->offset, sizeof(chunkHeader));
+    const uint64_t dataOffset = entry->offset + sizeof(chunkHeader);
+    if (chunkHeader.boidsCount != entry->boidsCount || chunkHeader.flags != entry->flags ||
+        chunkHeader.encodedSize > reader->indexOffset - dataOffset) {
+        return false;
+    }
+
+    const bool isKeyframe = (chunkHeader.flags & TRAJECTORY_CHUNK_KEYFRAME) != 0;
+    const int valuesCount = (int)chunkHeader.boidsCount * 4;
+    // Other frames are only decoded straight after the frame before them
+    if (!isKeyframe && (reader->decodedFrame != (int64_t)frameIndex - 1 ||
+                        reader->index[frameIndex - 1].boidsCount != entry->boidsCount)) {
+        return false;
+    }
+    if (valuesCount > reader->valuesCapacity) {
+        int32_t *values = realloc(reader->values, sizeof(int32_t) * (size_t)valuesCount);
+        if (values == NULL) {
+            FlockLog(LOG_ERROR, "ReadTrajectoryFrame: Failed to allocate memory for %u boids.", entry->boidsCount);
+            return false;
+        }
+        reader->values = values;
+        reader->valuesCapacity = valuesCount;
+    }
+
+    const unsigned char *input = data + dataOffset;
+    const unsigned char *end = input + chunkHeader.encodedSize;
+    for (int i = 0; i < valuesCount; i++) {
+        uint32_t zigzag = 0;
+        for (unsigned int shift = 0;; shift += 7U) {
+            if (input == end || shift > 28U) {
+                return false;
+            }
+            const uint8_t byte = *input++;
+            zigzag |= (uint32_t)(byte & 0x7FU) << shift;
+            if (byte < 0x80U) {
+                break;
+            }
+        }
+
+        // Undo the zigzag encoding and add the difference with the same wrapping arithmetic it was taken with
+        const uint32_t delta = (zigzag >> 1U) ^ (0U - (zigzag & 1U));
+        reader->values[i] = (int32_t)((isKeyframe ? 0U : (uint32_t)reader->values[i]) + delta);
+    }
+
+    return input == end;
+}
+
+bool ReadTrajectoryFrame(struct TrajectoryReader *reader, const uint64_t frameIndex, struct FlockSnapshot *snapshot) {
+    if (reader == NULL || snapshot == NULL) {
+        FlockLog(LOG_ERROR, "ReadTrajectoryFrame: Recieved NULL pointer.");
+        return false;
+    }
+    if (frameIndex >= reader->framesCount) {
+        FlockLog(LOG_ERROR, "ReadTrajectoryFrame: Frame %llu is past the end of the trajectory.",
+                 (unsigned long long)frameIndex);
+        return false;
+    }
+
+    if (reader->decodedFrame != (int64_t)frameIndex) {
+        // Carry on from the decoded frame if it is between the frame's keyframe and the frame, otherwise start again
+        // from the keyframe
+        uint64_t keyframe = frameIndex;
+        while ((reader->index[keyframe].flags & TRAJECTORY_CHUNK_KEYFRAME) == 0) {
+            keyframe--;
+        }
+        uint64_t firstFrame = keyframe;
+        if (reader->decodedFrame >= (int64_t)keyframe && reader->decodedFrame < (int64_t)frameIndex) {
+            firstFrame = (uint64_t)reader->decodedFrame + 1;
+        }
+
+        for (uint64_t frame = firstFrame; frame <= frameIndex; frame++) {
+            if (!DecodeTrajectoryChunk(reader, frame)) {
+                FlockLog(LOG_ERROR, "ReadTrajectoryFrame: Frame %llu is corrupt.", (unsigned long long)frame);
+                reader->decodedFrame = -1;
+                return false;
+            }
+            reader->decodedFrame = (int64_t)frame;
+        }
+    }
+
+    const int boidsCount = (int)reader->index[frameIndex].boidsCount;
+    if (!ReserveFlockSnapshotCapacity(snapshot, boidsCount)) {
+        FlockLog(LOG_ERROR, "ReadTrajectoryFrame: Failed to grow snapshot to %d boids.", boidsCount);
+        return false;
+    }
+
+    float *arrays[4] = {
+        snapshot->boids.positionsX,
+        snapshot->boids.positionsY,
+        snapshot->boids.velocitiesX,
+        snapshot->boids.velocitiesY,
+    };
+    for (int array = 0; array < 4; array++) {
+        const float quantum = array < 2 ? reader->header.positionQuantum : reader->header.velocityQuantum;
+        const int32_t *values = &reader->values[(size_t)array * (size_t)boidsCount];
+        for (int i = 0; i < boidsCount; i++) {
+            arrays[array][i] = (float)values[i] * quantum;
+        }
+    }
+    snapshot->boidsCount = boidsCount;
+
+    snapshot->clock = (struct FlockClock){
+        .accumulator = 0.F,
+        .droppedTime = 0.0,
+        .stepsCount = reader->index[frameIndex].stepsCount,
+        .time = reader->index[frameIndex].time,
+    };
+    snapshot->config = reader->config;
+    snapshot->config.numberOfBoids = boidsCount;
+    // Boids are recorded in ID order and take their species from their ID
+    for (int id = 0; id < boidsCount; id++) {
+        snapshot->boidSpecies[id] = (uint8_t)(id % reader->config.speciesCount);
+    }
+
+#ifdef DEBUG
+    // Forces aren't recorded, and the boids are recorded in ID order
+    memset(snapshot->debug_boidData, 0, sizeof(struct Debug_BoidData) * (size_t)boidsCount);
+    for (int id = 0; id < boidsCount; id++) {
+        snapshot->debug_boidIndices[id] = id;
+    }
+    snapshot->isPaused = false;
+    snapshot->collisionTime = 0.F;
+    snapshot->collisionSampleTime = 0.F;
+#endif /* ifdef DEBUG */
+
+    return true;
+}
+
+void CloseTrajectory(struct TrajectoryReader *reader) {
+    if (reader == NULL) {
+        FlockLog(LOG_ERROR, "CloseTrajectory: Recieved NULL pointer to reader.");
+        return;
+    }
+
+    CloseMappedFile(&reader->file);
+    free(reader->index);
+    free(reader->values);
+
+    *reader = (struct TrajectoryReader){
+        .decodedFrame = -1,
+    };
+}
@@ -0,0 +1,392 @@
+#include "trajectory.h"
+
+#include "boid.h"
+#include "checkpoint.h"
+#include "flock.h"
+#include "flock_log.h"
+#include "trace.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Size of the file's write buffer, frames are written in a few large writes rather than many small ones
+#define TRAJECTORY_WRITE_BUFFER_SIZE (1 << 20)
+// Worst case size of a varint encoded 32 bit value
+#define TRAJECTORY_MAX_VARINT_SIZE 5
+
+struct TrajectoryRecorderConfig CreateDefaultTrajectoryRecorderConfig(const char *path) {
+    return (struct TrajectoryRecorderConfig){
+        .path = path,
+        .ringSize = 8,
+        .keyframeInterval = 60,
+        .positionQuantum = 1.F / 64.F,
+        .velocityQuantum = 1.F / 64.F,
+    };
+}
+
+// Internal function that quantises a value, rounding half away from zero. Boids in an open world can get arbitrarily
+// far away, so values are clamped to half the range of an int32 (which keeps the differences between them in range).
+static int32_t QuantiseTrajectoryValue(const float value, const float inverseQuantum) {
+    const float scaled = fminf(fmaxf(value * inverseQuantum, -TRAJECTORY_MAX_QUANTA), TRAJECTORY_MAX_QUANTA);
+    return (int32_t)(scaled >= 0.F ? scaled + 0.5F : scaled - 0.5F);
+}
+
+// Internal function that encodes one array of the frame, returns the position after the last byte written
+static uint8_t *EncodeTrajectoryArray(uint8_t *output, const float *values, int32_t *previousValues,
+                                      const int boidsCount, const float quantum, const bool isKeyframe) {
+    const float inverseQuantum = 1.F / quantum;
+    for (int i = 0; i < boidsCount; i++) {
+        const int32_t value = QuantiseTrajectoryValue(values[i], inverseQuantum);
+        const int32_t previousValue = isKeyframe ? 0 : previousValues[i];
+        previousValues[i] = value;
+
+        // Differences are taken with wrapping arithmetic so they can't overflow, then zigzag encoded so that small
+        // negative differences are small numbers too
+        const int32_t delta = (int32_t)((uint32_t)value - (uint32_t)previousValue);
+        uint32_t zigzag = ((uint32_t)delta << 1U) ^ (uint32_t)(delta >> 31);
+
+        while (zigzag >= 0x80U) {
+            *output++ = (uint8_t)(zigzag | 0x80U);
+            zigzag >>= 7U;
+        }
+        *output++ = (uint8_t)zigzag;
+    }
+    return output;
+}
+
+// Internal function that adds a chunk to the in-memory index, returns false if it couldn't grow
+static bool AddTrajectoryIndexEntry(struct TrajectoryRecorder *recorder, const struct TrajectoryIndexEntry entry) {
+    if (recorder->indexCount == recorder->indexCapacity) {
+        const uint64_t newCapacity = recorder->indexCapacity > 0 ? recorder->indexCapacity * 2 : 1024;
+        struct TrajectoryIndexEntry *index =
+            realloc(recorder->index, sizeof(struct TrajectoryIndexEntry) * newCapacity);
+        if (index == NULL) {
+            return false;
+        }
+        recorder->index = index;
+        recorder->indexCapacity = newCapacity;
+    }
+
+    recorder->index[recorder->indexCount++] = entry;
+    return true;
+}
+
+// Internal function that encodes a frame and appends it to the file, runs on the background thread
+static bool WriteTrajectoryFrame(struct TrajectoryRecorder *recorder, const struct TrajectoryFrame *frame) {
+    TRACE_BEGIN(WriteTrajectoryFrame);
+    const int boidsCount = frame->boidsCount;
+
+    // Grow the buffers for the largest frame seen so far
+    if (boidsCount > recorder->previousBoidsCount || recorder->previousValues == NULL) {
+        int32_t *previousValues = realloc(recorder->previousValues, sizeof(int32_t) * 4 * (size_t)boidsCount);
+        if (previousValues == NULL) {
+            FlockLog(LOG_ERROR, "WriteTrajectoryFrame: Failed to allocate memory for %d boids.", boidsCount);
+            return false;
+        }
+        recorder->previousValues = previousValues;
+    }
+    const size_t maximumEncodedSize = (size_t)boidsCount * 4 * TRAJECTORY_MAX_VARINT_SIZE;
+    if (maximumEncodedSize > recorder->encodedCapacity) {
+        uint8_t *encodedBuffer = realloc(recorder->encodedBuffer, maximumEncodedSize);
+        if (encodedBuffer == NULL) {
+            FlockLog(LOG_ERROR, "WriteTrajectoryFrame: Failed to allocate memory for %d boids.", boidsCount);
+            return false;
+        }
+        recorder->encodedBuffer = encodedBuffer;
+        recorder->encodedCapacity = maximumEncodedSize;
+    }
+
+    // A change in the number of boids also needs a keyframe since the previous values no longer line up
+    const bool isKeyframe = recorder->indexCount % (uint64_t)recorder->config.keyframeInterval == 0 ||
+                            boidsCount != recorder->previousBoidsCount;
+    recorder->previousBoidsCount = boidsCount;
+
+    const struct {
+        const float *values;
+        float quantum;
+    } arrays[4] = {
+        {frame->boids.positionsX, recorder->config.positionQuantum},
+        {frame->boids.positionsY, recorder->config.positionQuantum},
+        {frame->boids.velocitiesX, recorder->config.velocityQuantum},
+        {frame->boids.velocitiesY, recorder->config.velocityQuantum},
+    };
+    uint8_t *output = recorder->encodedBuffer;
+    for (int array = 0; array < 4; array++) {
+        output = EncodeTrajectoryArray(output, arrays[array].values,
+                                       &recorder->previousValues[(size_t)array * (size_t)boidsCount], boidsCount,
+                                       arrays[array].quantum, isKeyframe);
+    }
+
+    const struct TrajectoryChunkHeader chunkHeader = {
+        .stepsCount = frame->stepsCount,
+        .time = frame->time,
+        .boidsCount = (uint32_t)boidsCount,
+        .flags = isKeyframe ? TRAJECTORY_CHUNK_KEYFRAME : 0U,
+        .encodedSize = (uint64_t)(output - recorder->encodedBuffer),
+    };
+    if (fwrite(&chunkHeader, sizeof(chunkHeader), 1, recorder->file) != 1 ||
+        fwrite(recorder->encodedBuffer, 1, chunkHeader.encodedSize, recorder->file) != chunkHeader.encodedSize) {
+        FlockLog(LOG_ERROR, "WriteTrajectoryFrame: Failed to write step %llu to %s.",
+                 (unsigned long long)frame->stepsCount, recorder->config.path);
+        return false;
+    }
+
+    const struct TrajectoryIndexEntry entry = {
+        .stepsCount = frame->stepsCount,
+        .time = frame->time,
+        .offset = recorder->fileOffset,
+        .boidsCount = (uint32_t)boidsCount,
+        .flags = chunkHeader.flags,
+    };
+    recorder->fileOffset += sizeof(chunkHeader) + chunkHeader.encodedSize;
+    if (!AddTrajectoryIndexEntry(recorder, entry)) {
+        FlockLog(LOG_ERROR, "WriteTrajectoryFrame: Failed to grow the index of %s.", recorder->config.path);
+        return false;
+    }
+
+    TRACE_END(WriteTrajectoryFrame);
+    return true;
+}
+
+// Internal function run by the background thread, writes frames from the ring until the recorder is stopped
+static void *TrajectoryRecorderThread(void *argument) {
+    struct TrajectoryRecorder *recorder = argument;
+#ifdef TRACING
+    SetTraceThreadName("Trajectory Writer");
+#endif /* ifdef TRACING */
+
+    pthread_mutex_lock(&recorder->mutex);
+    for (;;) {
+        while (recorder->framesCount == 0 && !recorder->isStopping) {
+            pthread_cond_wait(&recorder->frameRecorded, &recorder->mutex);
+        }
+        // Frames recorded before stopping are still written
+        if (recorder->framesCount == 0) {
+            break;
+        }
+        const struct TrajectoryFrame *frame = &recorder->frames[recorder->firstFrame];
+        pthread_mutex_unlock(&recorder->mutex);
+
+        // After a failed write the frames are only drained, the file can't be trusted anymore
+        if (!recorder->hasWriteFailed && !WriteTrajectoryFrame(recorder, frame)) {
+            recorder->hasWriteFailed = true;
+        }
+
+        pthread_mutex_lock(&recorder->mutex);
+        recorder->firstFrame = (recorder->firstFrame + 1) % recorder->config.ringSize;
+        recorder->framesCount--;
+        pthread_cond_signal(&recorder->frameWritten);
+    }
+    pthread_mutex_unlock(&recorder->mutex);
+
+    return NULL;
+}
+
+// Internal function that frees everything owned by the recorder
+static void FreeTrajectoryRecorder(struct TrajectoryRecorder *recorder) {
+    if (recorder->frames != NULL) {
+        for (int i = 0; i < recorder->config.ringSize; i++) {
+            FreeBoidArrays(&recorder->frames[i].boids);
+        }
+        free(recorder->frames);
+        recorder->frames = NULL;
+    }
+    free(recorder->previousValues);
+    recorder->previousValues = NULL;
+    free(recorder->encodedBuffer);
+    recorder->encodedBuffer = NULL;
+    free(recorder->index);
+    recorder->index = NULL;
+    if (recorder->file != NULL) {
+        fclose(recorder->file);
+        recorder->file = NULL;
+    }
+}
+
+bool StartTrajectoryRecorder(struct TrajectoryRecorder *recorder, const struct TrajectoryRecorderConfig config,
+                             const struct FlockConfig *flockConfig) {
+    if (recorder == NULL || config.path == NULL || flockConfig == NULL) {
+        FlockLog(LOG_ERROR, "StartTrajectoryRecorder: Recieved NULL pointer.");
+        return false;
+    }
+    if (config.ringSize < 1 || config.keyframeInterval < 1 || config.positionQuantum <= 0.F ||
+        config.velocityQuantum <= 0.F) {
+        FlockLog(LOG_ERROR, "StartTrajectoryRecorder: Ring size, keyframe interval and quanta must be greater than 0.");
+        return false;
+    }
+
+    *recorder = (struct TrajectoryRecorder){
+        .config = config,
+        .frames = calloc((size_t)config.ringSize, sizeof(struct TrajectoryFrame)),
+    };
+    if (recorder->frames == NULL) {
+        FlockLog(LOG_ERROR, "StartTrajectoryRecorder: Failed to allocate memory for %d frames.", config.ringSize);
+        return false;
+    }
+    const int boidsCapacity = flockConfig->numberOfBoids;
+    for (int i = 0; i < config.ringSize; i++) {
+        if (!AllocateBoidArrays(&recorder->frames[i].boids, boidsCapacity)) {
+            FlockLog(LOG_ERROR, "StartTrajectoryRecorder: Failed to allocate memory for %d frames of %d boids.",
+                     config.ringSize, boidsCapacity);
+            FreeTrajectoryRecorder(recorder);
+            return false;
+        }
+        recorder->frames[i].boidsCapacity = boidsCapacity;
+    }
+
+    recorder->file = fopen(config.path, "wb");
+    if (recorder->file == NULL) {
+        FlockLog(LOG_ERROR, "StartTrajectoryRecorder: Failed to create %s.", config.path);
+        FreeTrajectoryRecorder(recorder);
+        return false;
+    }
+    setvbuf(recorder->file, NULL, _IOFBF, TRAJECTORY_WRITE_BUFFER_SIZE);
+
+    struct TrajectoryFileHeader header = {
+        .version = TRAJECTORY_VERSION,
+        .byteOrderMark = TRAJECTORY_BYTE_ORDER_MARK,
+        .positionQuantum = config.positionQuantum,
+        .velocityQuantum = config.velocityQuantum,
+        .keyframeInterval = (uint32_t)config.keyframeInterval,
+        .config = CreateFlockCheckpointConfig(flockConfig),
+    };
+    memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    if (fwrite(&header, sizeof(header), 1, recorder->file) != 1) {
+        FlockLog(LOG_ERROR, "StartTrajectoryRecorder: Failed to write the header of %s.", config.path);
+        FreeTrajectoryRecorder(recorder);
+        return false;
+    }
+    recorder->fileOffset = sizeof(header);
+
+    if (pthread_mutex_init(&recorder->mutex, NULL) != 0) {
+        FlockLog(LOG_ERROR, "StartTrajectoryRecorder: Failed to create mutex.");
+        FreeTrajectoryRecorder(recorder);
+        return false;
+    }
+    if (pthread_cond_init(&recorder->frameRecorded, NULL) != 0) {
+        FlockLog(LOG_ERROR, "StartTrajectoryRecorder: Failed to create condition variable.");
+        pthread_mutex_destroy(&recorder->mutex);
+        FreeTrajectoryRecorder(recorder);
+        return false;
+    }
+    if (pthread_cond_init(&recorder->frameWritten, NULL) != 0) {
+        FlockLog(LOG_ERROR, "StartTrajectoryRecorder: Failed to create condition variable.");
+        pthread_cond_destroy(&recorder->frameRecorded);
+        pthread_mutex_destroy(&recorder->mutex);
+        FreeTrajectoryRecorder(recorder);
+        return false;
+    }
+    if (pthread_create(&recorder->thread, NULL, TrajectoryRecorderThread, recorder) != 0) {
+        FlockLog(LOG_ERROR, "StartTrajectoryRecorder: Failed to create the writer thread.");
+        pthread_cond_destroy(&recorder->frameWritten);
+        pthread_cond_destroy(&recorder->frameRecorded);
+        pthread_mutex_destroy(&recorder->mutex);
+        FreeTrajectoryRecorder(recorder);
+        return false;
+    }
+
+    recorder->isRunning = true;
+    return true;
+}
+
+void RecordTrajectoryFrame(struct TrajectoryRecorder *recorder, const struct BoidArrays *boids,
+                           const int *boidIndices, const int boidsCount, const uint64_t stepsCount,
+                           const double time) {
+    if (recorder == NULL || boids == NULL || !recorder->isRunning) {
+        FlockLog(LOG_ERROR, "RecordTrajectoryFrame: Recieved NULL pointer or stopped recorder.");
+        return;
+    }
+
+    pthread_mutex_lock(&recorder->mutex);
+    if (recorder->framesCount == recorder->config.ringSize) {
+        recorder->stallsCount++;
+        while (recorder->framesCount == recorder->config.ringSize) {
+            pthread_cond_wait(&recorder->frameWritten, &recorder->mutex);
+        }
+    }
+    // The free frame belongs to this thread until it is counted
+    struct TrajectoryFrame *frame =
+        &recorder->frames[(recorder->firstFrame + recorder->framesCount) % recorder->config.ringSize];
+    pthread_mutex_unlock(&recorder->mutex);
+
+    if (boidsCount > frame->boidsCapacity) {
+        if (!ResizeBoidArrays(&frame->boids, 0, boidsCount)) {
+            FlockLog(LOG_ERROR, "RecordTrajectoryFrame: Failed to grow a frame to %d boids, skipping step %llu.",
+                     boidsCount, (unsigned long long)stepsCount);
+            return;
+        }
+        frame->boidsCapacity = boidsCount;
+    }
+
+    if (boidIndices != NULL) {
+        for (int id = 0; id < boidsCount; id++) {
+            SetBoidInArrays(&frame->boids, id, GetBoidFromArrays(boids, boidIndices[id]));
+        }
+    } else {
+        const size_t arraySize = sizeof(float) * (size_t)boidsCount;
+        memcpy(frame->boids.positionsX, boids->positionsX, arraySize);
+        memcpy(frame->boids.positionsY, boids->positionsY, arraySize);
+        memcpy(frame->boids.velocitiesX, boids->velocitiesX, arraySize);
+        memcpy(frame->boids.velocitiesY, boids->velocitiesY, arraySize);
+    }
+    frame->boidsCount = boidsCount;
+    frame->stepsCount = stepsCount;
+    frame->time = time;
+
+    pthread_mutex_lock(&recorder->mutex);
+    recorder->framesCount++;
+    pthread_cond_signal(&recorder->frameRecorded);
+    pthread_mutex_unlock(&recorder->mutex);
+}
+
+bool StopTrajectoryRecorder(struct TrajectoryRecorder *recorder) {
+    if (recorder == NULL) {
+        FlockLog(LOG_ERROR, "StopTrajectoryRecorder: Recieved NULL pointer to recorder.");
+        return false;
+    }
+    if (!recorder->isRunning) {
+        return false;
+    }
+
+    pthread_mutex_lock(&recorder->mutex);
+    recorder->isStopping = true;
+    pthread_cond_signal(&recorder->frameRecorded);
+    pthread_mutex_unlock(&recorder->mutex);
+    pthread_join(recorder->thread, NULL);
+
+    pthread_cond_destroy(&recorder->frameWritten);
+    pthread_cond_destroy(&recorder->frameRecorded);
+    pthread_mutex_destroy(&recorder->mutex);
+
+    bool isWritten = !recorder->hasWriteFailed;
+    if (isWritten) {
+        const struct TrajectoryFileFooter footer = {
+            .indexOffset = recorder->fileOffset,
+            .framesCount = recorder->indexCount,
+            .magic = TRAJECTORY_INDEX_MAGIC,
+        };
+        if ((recorder->indexCount > 0 && fwrite(recorder->index, sizeof(struct TrajectoryIndexEntry),
+                                                recorder->indexCount, recorder->file) != recorder->indexCount) ||
+            fwrite(&footer, sizeof(footer), 1, recorder->file) != 1) {
+            FlockLog(LOG_ERROR, "StopTrajectoryRecorder: Failed to write the index of %s.", recorder->config.path);
+            isWritten = false;
+        }
+    }
+    if (fclose(recorder->file) != 0) {
+        FlockLog(LOG_ERROR, "StopTrajectoryRecorder: Failed to close %s.", recorder->config.path);
+        isWritten = false;
+    }
+    recorder->file = NULL;
+
+    FreeTrajectoryRecorder(recorder);
+    recorder->isRunning = false;
+
+    return isWritten;
+}
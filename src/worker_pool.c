@@ -0,0 +1,167 @@
+#include "worker_pool.h"
+
+#include "flock_log.h"
+#include "trace.h"
+
+#include <pthread.h>
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Internal function that takes chunks of the current job until there are none left
+static void RunWorkerPoolChunks(struct WorkerPool *pool) {
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        const int start = pool->nextItem;
+        pool->nextItem += pool->chunkSize;
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (start >= pool->itemsCount) {
+            return;
+        }
+        const int end = start + pool->chunkSize < pool->itemsCount ? start + pool->chunkSize : pool->itemsCount;
+        pool->task(pool->context, start, end);
+    }
+}
+
+// Internal function run by each worker thread, waits for jobs until the pool is destroyed
+static void *WorkerPoolThread(void *argument) {
+    struct WorkerPool *pool = argument;
+    unsigned int lastJobId = 0;
+#ifdef TRACING
+    SetTraceThreadName("Flock Worker");
+#endif /* ifdef TRACING */
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->isShuttingDown && pool->jobId == lastJobId) {
+            pthread_cond_wait(&pool->jobStarted, &pool->mutex);
+        }
+        if (pool->isShuttingDown) {
+            break;
+        }
+        lastJobId = pool->jobId;
+        pthread_mutex_unlock(&pool->mutex);
+
+        RunWorkerPoolChunks(pool);
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->busyWorkers--;
+        if (pool->busyWorkers == 0) {
+            pthread_cond_signal(&pool->jobFinished);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+bool InitializeWorkerPool(struct WorkerPool *pool, const int threadCount) {
+    if (pool == NULL) {
+        FlockLog(LOG_ERROR, "InitializeWorkerPool: Recieved NULL pointer to pool.");
+        return false;
+    }
+    if (threadCount < 1 || threadCount > WORKER_POOL_MAX_THREADS) {
+        FlockLog(LOG_ERROR, "InitializeWorkerPool: Thread count must be between 1 and %d, got %d.",
+                 WORKER_POOL_MAX_THREADS, threadCount);
+        return false;
+    }
+
+    *pool = (struct WorkerPool){0};
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->jobStarted, NULL);
+    pthread_cond_init(&pool->jobFinished, NULL);
+    pool->isInitialized = true;
+
+    // The thread running a job works on it too
+    const int workersCount = threadCount - 1;
+    if (workersCount == 0) {
+        return true;
+    }
+
+    pool->workers = malloc(sizeof(pthread_t) * workersCount);
+    if (pool->workers == NULL) {
+        FlockLog(LOG_ERROR, "InitializeWorkerPool: Failed to allocate memory for %d threads.", workersCount);
+        DestroyWorkerPool(pool);
+        return false;
+    }
+
+    for (int i = 0; i < workersCount; i++) {
+        if (pthread_create(&pool->workers[i], NULL, WorkerPoolThread, pool) != 0) {
+            FlockLog(LOG_ERROR, "InitializeWorkerPool: Failed to create worker thread %d.", i);
+            DestroyWorkerPool(pool);
+            return false;
+        }
+        pool->workersCount++;
+    }
+
+    return true;
+}
+
+void RunWorkerPool(struct WorkerPool *pool, const WorkerPoolTask task, void *context, const int itemsCount) {
+    if (pool == NULL || task == NULL) {
+        FlockLog(LOG_ERROR, "RunWorkerPool: Recieved NULL pointer.");
+        return;
+    }
+
+    const int threadCount = pool->workersCount + 1;
+    if (pool->workersCount == 0 || itemsCount < WORKER_POOL_MIN_CHUNK_SIZE * 2) {
+        task(context, 0, itemsCount);
+        return;
+    }
+
+    int chunkSize = itemsCount / (threadCount * WORKER_POOL_CHUNKS_PER_THREAD);
+    if (chunkSize < WORKER_POOL_MIN_CHUNK_SIZE) {
+        chunkSize = WORKER_POOL_MIN_CHUNK_SIZE;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->task = task;
+    pool->context = context;
+    pool->itemsCount = itemsCount;
+    pool->chunkSize = chunkSize;
+    pool->nextItem = 0;
+    pool->busyWorkers = pool->workersCount;
+    pool->jobId++;
+    pthread_cond_broadcast(&pool->jobStarted);
+    pthread_mutex_unlock(&pool->mutex);
+
+    RunWorkerPoolChunks(pool);
+
+    // Every worker has to check in before the job can be replaced, even ones that woke up too late to get a chunk
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->busyWorkers > 0) {
+        pthread_cond_wait(&pool->jobFinished, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+int GetWorkerPoolThreadCount(const struct WorkerPool *pool) {
+    return pool->workersCount + 1;
+}
+
+void DestroyWorkerPool(struct WorkerPool *pool) {
+    if (pool == NULL) {
+        FlockLog(LOG_ERROR, "DestroyWorkerPool: Recieved NULL pointer to pool.");
+        return;
+    }
+    if (!pool->isInitialized) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->isShuttingDown = true;
+    pthread_cond_broadcast(&pool->jobStarted);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->workersCount; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+    free(pool->workers);
+
+    pthread_cond_destroy(&pool->jobFinished);
+    pthread_cond_destroy(&pool->jobStarted);
+    pthread_mutex_destroy(&pool->mutex);
+
+    *pool = (struct WorkerPool){0};
+}